@@ -0,0 +1,300 @@
+#include "engine/animation/AnimBlendSpace.h"
+#include <vector>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// triangle used while triangulating. indices >= sample count refer to super triangle vertices.
+struct BuildTriangle
+{
+    u16 v[3];
+
+    // circumcircle.
+    float cx, cy, radius_sq;
+};
+
+//---------------------------------------------------------------------------------------
+
+static bool MakeBuildTriangle( const float* xs, const float* ys, u16 a, u16 b, u16 c, BuildTriangle& out )
+{
+    float ax = xs[a], ay = ys[a];
+    float bx = xs[b], by = ys[b];
+    float cx = xs[c], cy = ys[c];
+
+    float d = 2.f * ( ax * (by - cy) + bx * (cy - ay) + cx * (ay - by) );
+
+    if( d == 0.f )
+        return false;
+
+    float a_sq = ax * ax + ay * ay;
+    float b_sq = bx * bx + by * by;
+    float c_sq = cx * cx + cy * cy;
+
+    out.v[0] = a;
+    out.v[1] = b;
+    out.v[2] = c;
+    out.cx = ( a_sq * (by - cy) + b_sq * (cy - ay) + c_sq * (ay - by) ) / d;
+    out.cy = ( a_sq * (cx - bx) + b_sq * (ax - cx) + c_sq * (bx - ax) ) / d;
+    out.radius_sq = (ax - out.cx) * (ax - out.cx) + (ay - out.cy) * (ay - out.cy);
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimBlendSpace::AnimBlendSpace( u16 sample_count )
+: m_samples(nullptr)
+, m_triangles(nullptr)
+, m_sample_count(sample_count)
+, m_triangle_count(0)
+{
+    if( m_sample_count > 0 )
+        m_samples = new Sample[m_sample_count];
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimBlendSpace::~AnimBlendSpace()
+{
+    delete [] m_samples;
+    delete [] m_triangles;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBlendSpace::SetSample( u16 idx, float x, float y, u16 node_index )
+{
+    ENGINE_ASSERT(idx < m_sample_count, "sample out of bounds");
+
+    m_samples[idx].x = x;
+    m_samples[idx].y = y;
+    m_samples[idx].node_index = node_index;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimBlendSpace::Triangulate()
+{
+    delete [] m_triangles;
+    m_triangles = nullptr;
+    m_triangle_count = 0;
+
+    if( m_sample_count < 3 )
+        return false;
+
+    // bowyer-watson. samples followed by 3 super triangle vertices.
+    u32 vertex_count = m_sample_count + 3;
+    std::vector<float> xs( vertex_count ), ys( vertex_count );
+
+    float min_x = m_samples[0].x, max_x = m_samples[0].x;
+    float min_y = m_samples[0].y, max_y = m_samples[0].y;
+
+    for( u16 i = 0; i < m_sample_count; ++i )
+    {
+        xs[i] = m_samples[i].x;
+        ys[i] = m_samples[i].y;
+
+        min_x = xs[i] < min_x ? xs[i] : min_x;
+        max_x = xs[i] > max_x ? xs[i] : max_x;
+        min_y = ys[i] < min_y ? ys[i] : min_y;
+        max_y = ys[i] > max_y ? ys[i] : max_y;
+    }
+
+    float extent = (max_x - min_x) > (max_y - min_y) ? (max_x - min_x) : (max_y - min_y);
+    extent = extent > 0.f ? extent : 1.f;
+
+    float mid_x = (min_x + max_x) * 0.5f;
+    float mid_y = (min_y + max_y) * 0.5f;
+
+    u16 super = m_sample_count;
+    xs[super + 0] = mid_x - 20.f * extent;  ys[super + 0] = mid_y - extent;
+    xs[super + 1] = mid_x;                  ys[super + 1] = mid_y + 20.f * extent;
+    xs[super + 2] = mid_x + 20.f * extent;  ys[super + 2] = mid_y - extent;
+
+    std::vector<BuildTriangle> triangles;
+    BuildTriangle root;
+    MakeBuildTriangle( &xs[0], &ys[0], super, super + 1, super + 2, root );
+    triangles.push_back( root );
+
+    std::vector<u16> edges;
+
+    for( u16 p = 0; p < m_sample_count; ++p )
+    {
+        edges.clear();
+
+        // remove triangles whose circumcircle contains the point, keep their edges.
+        for( size_t t = 0; t < triangles.size(); )
+        {
+            const BuildTriangle& tri = triangles[t];
+
+            float dx = xs[p] - tri.cx;
+            float dy = ys[p] - tri.cy;
+
+            if( dx * dx + dy * dy < tri.radius_sq * (1.f - 1e-5f) )
+            {
+                for( u32 e = 0; e < 3; ++e )
+                {
+                    edges.push_back( tri.v[e] );
+                    edges.push_back( tri.v[(e + 1) % 3] );
+                }
+
+                triangles[t] = triangles.back();
+                triangles.pop_back();
+            }
+            else
+                ++t;
+        }
+
+        // edges shared by two removed triangles are inside the cavity.
+        for( size_t a = 0; a < edges.size(); a += 2 )
+        {
+            bool shared = false;
+
+            for( size_t b = 0; b < edges.size(); b += 2 )
+            {
+                if( a != b && edges[a] == edges[b + 1] && edges[a + 1] == edges[b] )
+                {
+                    shared = true;
+                    break;
+                }
+            }
+
+            BuildTriangle tri;
+
+            if( !shared && MakeBuildTriangle( &xs[0], &ys[0], edges[a], edges[a + 1], p, tri ) )
+                triangles.push_back( tri );
+        }
+    }
+
+    // drop triangles connected to super triangle.
+    std::vector<Triangle> result;
+
+    for( size_t t = 0; t < triangles.size(); ++t )
+    {
+        const BuildTriangle& tri = triangles[t];
+
+        if( tri.v[0] < super && tri.v[1] < super && tri.v[2] < super )
+        {
+            Triangle out;
+            out.samples[0] = tri.v[0];
+            out.samples[1] = tri.v[1];
+            out.samples[2] = tri.v[2];
+            result.push_back( out );
+        }
+    }
+
+    if( result.empty() )
+        return false;
+
+    m_triangle_count = (u16)result.size();
+    m_triangles = new Triangle[m_triangle_count];
+
+    for( u16 t = 0; t < m_triangle_count; ++t )
+        m_triangles[t] = result[t];
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBlendSpace::Evaluate( float x, float y, u16 samples[3], float weights[3] ) const
+{
+    ENGINE_ASSERT(m_sample_count > 0, "empty blend space");
+
+    float best_distance_sq = -1.f;
+
+    for( u16 t = 0; t < m_triangle_count; ++t )
+    {
+        const Triangle& tri = m_triangles[t];
+
+        const Sample& a = m_samples[tri.samples[0]];
+        const Sample& b = m_samples[tri.samples[1]];
+        const Sample& c = m_samples[tri.samples[2]];
+
+        // barycentric coordinates.
+        float v0x = b.x - a.x, v0y = b.y - a.y;
+        float v1x = c.x - a.x, v1y = c.y - a.y;
+        float v2x = x - a.x, v2y = y - a.y;
+
+        float denom = v0x * v1y - v1x * v0y;
+        float wb = (v2x * v1y - v1x * v2y) / denom;
+        float wc = (v0x * v2y - v2x * v0y) / denom;
+        float wa = 1.f - wb - wc;
+
+        const float eps = -1e-5f;
+
+        if( wa >= eps && wb >= eps && wc >= eps )
+        {
+            samples[0] = tri.samples[0];
+            samples[1] = tri.samples[1];
+            samples[2] = tri.samples[2];
+
+            weights[0] = wa > 0.f ? wa : 0.f;
+            weights[1] = wb > 0.f ? wb : 0.f;
+            weights[2] = wc > 0.f ? wc : 0.f;
+
+            float sum = weights[0] + weights[1] + weights[2];
+            weights[0] /= sum;
+            weights[1] /= sum;
+            weights[2] /= sum;
+            return;
+        }
+
+        // outside - remember closest point on triangle edges.
+        for( u32 e = 0; e < 3; ++e )
+        {
+            const Sample& p0 = m_samples[tri.samples[e]];
+            const Sample& p1 = m_samples[tri.samples[(e + 1) % 3]];
+
+            float ex = p1.x - p0.x, ey = p1.y - p0.y;
+            float length_sq = ex * ex + ey * ey;
+            float s = length_sq > 0.f ? ((x - p0.x) * ex + (y - p0.y) * ey) / length_sq : 0.f;
+            s = s < 0.f ? 0.f : (s > 1.f ? 1.f : s);
+
+            float dx = p0.x + ex * s - x;
+            float dy = p0.y + ey * s - y;
+            float distance_sq = dx * dx + dy * dy;
+
+            if( best_distance_sq < 0.f || distance_sq < best_distance_sq )
+            {
+                best_distance_sq = distance_sq;
+
+                samples[0] = tri.samples[e];
+                samples[1] = tri.samples[(e + 1) % 3];
+                samples[2] = tri.samples[(e + 2) % 3];
+
+                weights[0] = 1.f - s;
+                weights[1] = s;
+                weights[2] = 0.f;
+            }
+        }
+    }
+
+    if( m_triangle_count > 0 )
+        return;
+
+    // no triangulation - nearest sample.
+    u16 nearest = 0;
+
+    for( u16 i = 0; i < m_sample_count; ++i )
+    {
+        float dx = m_samples[i].x - x;
+        float dy = m_samples[i].y - y;
+        float distance_sq = dx * dx + dy * dy;
+
+        if( best_distance_sq < 0.f || distance_sq < best_distance_sq )
+        {
+            best_distance_sq = distance_sq;
+            nearest = i;
+        }
+    }
+
+    samples[0] = samples[1] = samples[2] = nearest;
+    weights[0] = 1.f;
+    weights[1] = weights[2] = 0.f;
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
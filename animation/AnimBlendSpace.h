@@ -0,0 +1,67 @@
+#pragma once
+
+#include "engine/core/Types.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// 2D blend space. sample points in parameter space (i.e. speed/direction) are triangulated
+// at load time, so evaluation only blends three samples of the triangle containing the parameters.
+// blend space is read only after Triangulate() and may be shared by many blend trees.
+class AnimBlendSpace
+{
+public:
+    // sample point. node_index refers to subtree in the owning blend tree.
+    struct Sample
+    {
+        float x;
+        float y;
+        u16 node_index;
+    };
+
+    struct Triangle
+    {
+        u16 samples[3];
+    };
+
+public:
+    AnimBlendSpace( u16 sample_count );
+    ~AnimBlendSpace();
+
+    void SetSample( u16 idx, float x, float y, u16 node_index );
+
+    // delaunay triangulation of the samples. returns false if samples are collinear.
+    bool Triangulate();
+
+    inline u16 GetSampleCount() const { return m_sample_count; }
+
+    inline const Sample& GetSample( u16 idx ) const { ENGINE_ASSERT(idx < m_sample_count, "sample out of bounds"); return m_samples[idx]; }
+
+    inline u16 GetTriangleCount() const { return m_triangle_count; }
+
+    inline const Triangle& GetTriangle( u16 idx ) const { ENGINE_ASSERT(idx < m_triangle_count, "triangle out of bounds"); return m_triangles[idx]; }
+
+    // finds three samples around point (x, y) and their barycentric weights.
+    // points outside of the triangulation are clamped to the closest edge.
+    // if there are no triangles, nearest sample gets full weight (other weights are 0).
+    void Evaluate( float x, float y, u16 samples[3], float weights[3] ) const;
+
+    // bytes of blend space object and its arrays.
+    inline size_t GetMemoryUsage() const { return sizeof(AnimBlendSpace) + m_sample_count * sizeof(Sample) + m_triangle_count * sizeof(Triangle); }
+
+private:
+    // sample points.
+    Sample* m_samples;
+
+    // triangles referencing m_samples.
+    Triangle* m_triangles;
+
+    u16 m_sample_count;
+
+    u16 m_triangle_count;
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -1,262 +1,573 @@
-#include "engine/animation/AnimBlendTree.h"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-
-AnimBlendTree::Node::Node()
-: m_left_index(-1)
-, m_right_index(-1)
-, m_type(BlendNodeType::Undefined)
-, m_blend_factor(0.f)
-, m_factor_name(0)
-{
-    
-}
-
-//---------------------------------------------------------------------------------------
-
-AnimBlendTree::Node::Node( AnimationClip* clip, float globa_clock_ms, bool looped, float playback_rate )
-: m_left_index(-1)
-, m_right_index(-1)
-, m_type(BlendNodeType::Value)
-, m_blend_factor(1.f)
-, m_factor_name(0)
-{
-    m_animation = Animation(clip, globa_clock_ms, looped, playback_rate);
-}
-
-//---------------------------------------------------------------------------------------
-
-AnimBlendTree::Node::Node( BlendNodeType::Enum type, u16 left_index, u16 right_index, StringId factor_name, float factor_value )
-: m_left_index(left_index)
-, m_right_index(right_index)
-, m_type(type)
-, m_blend_factor(factor_value)
-, m_factor_name(factor_name)
-{
-    
-}
-
-//---------------------------------------------------------------------------------------
-//---------------------------------------------------------------------------------------
-
-AnimBlendTree::AnimBlendTree()
-: m_nodes(nullptr)
-, m_node_count(0)
-, m_capacity(0)
-{
-    
-}
-
-//---------------------------------------------------------------------------------------
-
-AnimBlendTree::AnimBlendTree( u16 capacity )
-: m_nodes(nullptr)
-, m_node_count(0)
-, m_capacity(capacity)
-{
-    m_nodes = new Node[m_capacity];
-}
-
-//---------------------------------------------------------------------------------------
-
-AnimBlendTree::~AnimBlendTree()
-{
-    delete [] m_nodes;
-}
-
-//---------------------------------------------------------------------------------------
-
-AnimBlendTree& AnimBlendTree::operator=( const AnimBlendTree& rhs )
-{
-    ENGINE_ASSERT(m_capacity >= rhs.GetCapacity(), "too many nodes to merge");
-    
-    m_node_count = rhs.m_node_count;
-    
-    for( u16 i = 0; i < rhs.m_node_count; ++i )
-        m_nodes[i] = rhs.m_nodes[i];
-    
-    return *this;
-}
-
-//---------------------------------------------------------------------------------------
-
-void AnimBlendTree::Clear()
-{
-    m_node_count = 0;
-}
-
-//---------------------------------------------------------------------------------------
-
-void AnimBlendTree::Resize( u16 capacity )
-{
-    u16 old_capacity = m_capacity;
-    Node* old_nodes = m_nodes;
-    m_nodes = nullptr;
-    
-    // create new nodes.
-    if( capacity > 0 )
-        m_nodes = new Node[capacity];
-    m_capacity = capacity;
-    
-    // save old nodes data.
-    u16 i = 0;
-    while( i < capacity && i < old_capacity )
-    {
-        m_nodes[i] = old_nodes[i];
-        i++;
-    }
-    
-    // remove old nodes.
-    delete [] old_nodes;
-}
-
-//---------------------------------------------------------------------------------------
-
-void AnimBlendTree::Start( float current_time_ms )
-{
-    for( u16 i = 0; i < m_node_count; ++i )
-    {
-        Animation& anim = m_nodes[i].GetAnimation();
-        
-        if( anim.IsValid() )
-            anim.SetStartTime(current_time_ms);
-    }
-}
-
-//---------------------------------------------------------------------------------------
-
-bool AnimBlendTree::SetNodeFactor( StringId factor_name, float value )
-{
-    for( u16 i = 0; i < m_node_count; ++i )
-    {
-        if( m_nodes[i].GetFactorName() == factor_name )
-        {
-            m_nodes[i].SetFactor(value);
-            return true;
-        }
-    }
-    
-    return false;
-}
-
-//---------------------------------------------------------------------------------------
-
-bool AnimBlendTree::GetNodeFactor( StringId factor_name, float& value ) const
-{
-    for( u16 i = 0; i < m_node_count; ++i )
-    {
-        if( m_nodes[i].GetFactorName() == factor_name )
-        {
-            value = m_nodes[i].GetFactor();
-            return true;
-        }
-    }
-    
-    return false;
-}
-
-//---------------------------------------------------------------------------------------
-
-float AnimBlendTree::GetLocalAnimationTime(float global_time) const
-{
-    for( u32 i = 0; i < m_node_count; ++i )
-    {
-        Node& node = m_nodes[i];
-        
-        const Animation& anim = node.GetAnimation();
-        
-        if( anim.IsValid() )
-            return anim.GetLocalAnimationTime(global_time);
-    }
-    
-    return 0.f;
-}
-
-//---------------------------------------------------------------------------------------
-
-bool AnimBlendTree::GetJointPose( u16 current_index, float clock_time_ms, s16 joint_idx, AnimationClip::JointPose& pose ) const
-{
-    const Node& node = m_nodes[current_index];
-    
-    switch( node.GetType() )
-    {
-        case BlendNodeType::Value:
-        {
-            ENGINE_ASSERT(node.GetAnimation().IsValid(), "invalid animation node");
-            
-            if( node.GetAnimation().HasJointPose(joint_idx) )
-            {
-                node.GetAnimation().GetJointPose( clock_time_ms, joint_idx, pose );
-                return true;
-            }
-        }
-        break;
-        case BlendNodeType::Lerp:
-        {
-            AnimationClip::JointPose pose_a, pose_b;
-            
-            bool has_left_subtree = GetJointPose( node.GetLeftIndex(), clock_time_ms, joint_idx, pose_a );
-            bool has_right_subtree = GetJointPose( node.GetRightIndex(), clock_time_ms, joint_idx, pose_b );
-            
-            if( has_right_subtree && has_left_subtree )
-                pose.MakeLerp(pose_a, pose_b, node.GetFactor());
-            else if( has_right_subtree )
-                pose = pose_a;
-            else if( has_left_subtree )
-                pose = pose_b;
-            else
-                return false;
-            
-            return true;
-        }
-        break;
-        case BlendNodeType::Additive:
-        {
-            AnimationClip::JointPose pose_b;
-            
-            bool has_left_subtree = GetJointPose( node.GetLeftIndex(), clock_time_ms, joint_idx, pose );
-            bool has_right_subtree = GetJointPose( node.GetRightIndex(), clock_time_ms, joint_idx, pose_b );
-            
-            ENGINE_ASSERT(has_left_subtree, "left subtree has to be valid for additive animation");
-            
-            if( has_right_subtree )
-                pose.AdditiveAdd(pose_b, node.GetFactor());
-            
-            return true;
-        }
-        break;
-        default:
-        ENGINE_ASSERT(0, "undefined node type");
-    }
-    
-    return false;
-}
-
-//---------------------------------------------------------------------------------------
-
-bool AnimBlendTree::GetJointPose( float global_time_ms, s16 joint_idx, AnimationClip::JointPose& pose ) const
-{
-    ENGINE_ASSERT(IsValid(), "animation tree not valid");
-    
-    return GetJointPose(0, global_time_ms, joint_idx, pose);
-}
-
-//---------------------------------------------------------------------------------------
-
-void AnimBlendTree::FixAnimationStartTime( float rewind_time_ms )
-{
-    for( u16 i = 0; i < m_node_count; ++i )
-    {
-        Animation& anim = m_nodes[i].GetAnimation();
-        
-        if( anim.IsValid() )
-            anim.SetStartTime( anim.GetStartTime() - rewind_time_ms );
-    }
-}
-    
-//---------------------------------------------------------------------------------------
-}; //namespace Engine
-//---------------------------------------------------------------------------------------
-
+#include "engine/animation/AnimBlendTree.h"
+#include "engine/animation/AnimBlendSpace.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+AnimBlendTree::Node::Node()
+: m_left_index(-1)
+, m_right_index(-1)
+, m_type(BlendNodeType::Undefined)
+, m_blend_factor(0.f)
+, m_factor_name(0)
+, m_factor_name_y(0)
+, m_blend_factor_y(0.f)
+, m_blend_space(nullptr)
+, m_weight(1.f)
+{
+    
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimBlendTree::Node::Node( AnimationClip* clip, float globa_clock_ms, bool looped, float playback_rate, bool mirrored )
+: m_left_index(-1)
+, m_right_index(-1)
+, m_type(BlendNodeType::Value)
+, m_blend_factor(1.f)
+, m_factor_name(0)
+, m_factor_name_y(0)
+, m_blend_factor_y(0.f)
+, m_blend_space(nullptr)
+, m_weight(1.f)
+{
+    m_animation = Animation(clip, globa_clock_ms, looped, playback_rate, mirrored);
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimBlendTree::Node::Node( BlendNodeType::Enum type, u16 left_index, u16 right_index, StringId factor_name, float factor_value )
+: m_left_index(left_index)
+, m_right_index(right_index)
+, m_type(type)
+, m_blend_factor(factor_value)
+, m_factor_name(factor_name)
+, m_factor_name_y(0)
+, m_blend_factor_y(0.f)
+, m_blend_space(nullptr)
+, m_weight(1.f)
+{
+    
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimBlendTree::Node::Node( const AnimBlendSpace* blend_space, StringId x_factor_name, float x_value, StringId y_factor_name, float y_value )
+: m_left_index(-1)
+, m_right_index(-1)
+, m_type(BlendNodeType::BlendSpace)
+, m_blend_factor(x_value)
+, m_factor_name(x_factor_name)
+, m_factor_name_y(y_factor_name)
+, m_blend_factor_y(y_value)
+, m_blend_space(blend_space)
+, m_weight(1.f)
+{
+    UpdateBlendSpaceWeights();
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBlendTree::Node::UpdateBlendSpaceWeights()
+{
+    if( !m_blend_space )
+        return;
+    
+    u16 samples[3];
+    m_blend_space->Evaluate( m_blend_factor, m_blend_factor_y, samples, m_active_weights );
+    
+    for( u32 i = 0; i < 3; ++i )
+        m_active_nodes[i] = m_blend_space->GetSample( samples[i] ).node_index;
+}
+
+//---------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------
+
+AnimBlendTree::AnimBlendTree()
+: m_nodes(nullptr)
+, m_node_count(0)
+, m_capacity(0)
+{
+    
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimBlendTree::AnimBlendTree( u16 capacity )
+: m_nodes(nullptr)
+, m_node_count(0)
+, m_capacity(capacity)
+{
+    m_nodes = new Node[m_capacity];
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimBlendTree::~AnimBlendTree()
+{
+    delete [] m_nodes;
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimBlendTree& AnimBlendTree::operator=( const AnimBlendTree& rhs )
+{
+    ENGINE_ASSERT(m_capacity >= rhs.GetCapacity(), "too many nodes to merge");
+    
+    m_node_count = rhs.m_node_count;
+    
+    for( u16 i = 0; i < rhs.m_node_count; ++i )
+        m_nodes[i] = rhs.m_nodes[i];
+    
+    return *this;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBlendTree::Clear()
+{
+    m_node_count = 0;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBlendTree::Resize( u16 capacity )
+{
+    u16 old_capacity = m_capacity;
+    Node* old_nodes = m_nodes;
+    m_nodes = nullptr;
+    
+    // create new nodes.
+    if( capacity > 0 )
+        m_nodes = new Node[capacity];
+    m_capacity = capacity;
+    
+    // save old nodes data.
+    u16 i = 0;
+    while( i < capacity && i < old_capacity )
+    {
+        m_nodes[i] = old_nodes[i];
+        i++;
+    }
+    
+    // remove old nodes.
+    delete [] old_nodes;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBlendTree::SetClip( AnimationClip* clip, bool looped, float playback_rate )
+{
+    ENGINE_ASSERT(m_capacity > 0, "tree has no capacity");
+    
+    m_nodes[0] = Node( clip, 0.f, looped, playback_rate );
+    m_node_count = 1;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBlendTree::Start( float current_time_ms )
+{
+    for( u16 i = 0; i < m_node_count; ++i )
+    {
+        Animation& anim = m_nodes[i].GetAnimation();
+        
+        if( anim.IsValid() )
+            anim.SetStartTime(current_time_ms);
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimBlendTree::SetNodeFactor( StringId factor_name, float value )
+{
+    for( u16 i = 0; i < m_node_count; ++i )
+    {
+        if( m_nodes[i].GetFactorName() == factor_name )
+        {
+            m_nodes[i].SetFactor(value);
+            return true;
+        }
+        
+        if( m_nodes[i].GetType() == BlendNodeType::BlendSpace && m_nodes[i].GetFactorNameY() == factor_name )
+        {
+            m_nodes[i].SetFactorY(value);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimBlendTree::GetNodeFactor( StringId factor_name, float& value ) const
+{
+    for( u16 i = 0; i < m_node_count; ++i )
+    {
+        if( m_nodes[i].GetFactorName() == factor_name )
+        {
+            value = m_nodes[i].GetFactor();
+            return true;
+        }
+        
+        if( m_nodes[i].GetType() == BlendNodeType::BlendSpace && m_nodes[i].GetFactorNameY() == factor_name )
+        {
+            value = m_nodes[i].GetFactorY();
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+//---------------------------------------------------------------------------------------
+
+float AnimBlendTree::GetLocalAnimationTime(float global_time) const
+{
+    for( u32 i = 0; i < m_node_count; ++i )
+    {
+        Node& node = m_nodes[i];
+        
+        const Animation& anim = node.GetAnimation();
+        
+        if( anim.IsValid() )
+            return anim.GetLocalAnimationTime(global_time);
+    }
+    
+    return 0.f;
+}
+
+//---------------------------------------------------------------------------------------
+
+const Animation* AnimBlendTree::GetFirstAnimation() const
+{
+    for( u16 i = 0; i < m_node_count; ++i )
+    {
+        if( m_nodes[i].GetAnimation().IsValid() )
+            return &m_nodes[i].GetAnimation();
+    }
+    
+    return nullptr;
+}
+
+//---------------------------------------------------------------------------------------
+
+u16 AnimBlendTree::GetFactors( float* values, u16 max_count ) const
+{
+    u16 count = 0;
+    
+    for( u16 i = 0; i < m_node_count; ++i )
+    {
+        const Node& node = m_nodes[i];
+        
+        if( node.GetType() == BlendNodeType::Lerp || node.GetType() == BlendNodeType::Additive || node.GetType() == BlendNodeType::BlendSpace )
+        {
+            if( count < max_count )
+                values[count] = node.GetFactor();
+            count++;
+        }
+        
+        if( node.GetType() == BlendNodeType::BlendSpace )
+        {
+            if( count < max_count )
+                values[count] = node.GetFactorY();
+            count++;
+        }
+    }
+    
+    return count;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBlendTree::SetFactors( const float* values, u16 count )
+{
+    u16 index = 0;
+    
+    for( u16 i = 0; i < m_node_count && index < count; ++i )
+    {
+        Node& node = m_nodes[i];
+        
+        if( node.GetType() == BlendNodeType::Lerp || node.GetType() == BlendNodeType::Additive )
+        {
+            node.SetFactor( values[index++] );
+        }
+        else if( node.GetType() == BlendNodeType::BlendSpace )
+        {
+            // blend space weights are updated by both setters, y is set first so x update sees final values.
+            if( index + 1 < count )
+                node.SetFactorY( values[index + 1] );
+            
+            node.SetFactor( values[index] );
+            index += 2;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimBlendTree::GetJointPose( u16 current_index, float clock_time_ms, s16 joint_idx, const Skeleton& skeleton, AnimationClip::JointPose& pose, u32& traits ) const
+{
+    const Node& node = m_nodes[current_index];
+    
+    switch( node.GetType() )
+    {
+        case BlendNodeType::Value:
+        {
+            ENGINE_ASSERT(node.GetAnimation().IsValid(), "invalid animation node");
+            
+            if( node.GetAnimation().HasJointPose(joint_idx, skeleton) )
+            {
+                node.GetAnimation().GetJointPose( clock_time_ms, joint_idx, skeleton, pose );
+                traits = node.GetAnimation().GetJointTraits( joint_idx, skeleton ) & ClipTraits::BlendMask;
+                return true;
+            }
+        }
+        break;
+        case BlendNodeType::Lerp:
+        {
+            AnimationClip::JointPose pose_a, pose_b;
+            u32 traits_a = 0, traits_b = 0;
+            
+            bool has_left_subtree = false;
+            bool has_right_subtree = false;
+            
+            // pruned side contributes nothing, other side is used as is.
+            if( IsWeighted( node.GetLeftIndex() ) )
+                has_left_subtree = GetJointPose( node.GetLeftIndex(), clock_time_ms, joint_idx, skeleton, pose_a, traits_a );
+            
+            if( IsWeighted( node.GetRightIndex() ) )
+                has_right_subtree = GetJointPose( node.GetRightIndex(), clock_time_ms, joint_idx, skeleton, pose_b, traits_b );
+            
+            if( has_right_subtree && has_left_subtree )
+            {
+                traits = traits_a & traits_b;
+                pose.MakeLerp(pose_a, pose_b, node.GetFactor(), traits);
+            }
+            else if( has_right_subtree )
+            {
+                traits = traits_b;
+                pose = pose_b;
+            }
+            else if( has_left_subtree )
+            {
+                traits = traits_a;
+                pose = pose_a;
+            }
+            else
+                return false;
+            
+            return true;
+        }
+        break;
+        case BlendNodeType::Additive:
+        {
+            AnimationClip::JointPose pose_b;
+            u32 traits_b = 0;
+            
+            bool has_left_subtree = GetJointPose( node.GetLeftIndex(), clock_time_ms, joint_idx, skeleton, pose, traits );
+            bool has_right_subtree = false;
+            
+            if( IsWeighted( node.GetRightIndex() ) )
+                has_right_subtree = GetJointPose( node.GetRightIndex(), clock_time_ms, joint_idx, skeleton, pose_b, traits_b );
+            
+            ENGINE_ASSERT(has_left_subtree, "left subtree has to be valid for additive animation");
+            
+            // channels identity in additive pose are not touched.
+            if( has_right_subtree )
+            {
+                pose.AdditiveAdd(pose_b, node.GetFactor(), traits_b);
+                traits &= traits_b;
+            }
+            
+            return true;
+        }
+        break;
+        case BlendNodeType::BlendSpace:
+        {
+            // only samples of the active triangle are evaluated. running weight normalization
+            // handles samples missing the joint.
+            AnimationClip::JointPose sample_pose;
+            u32 sample_traits = 0;
+            float total_weight = 0.f;
+            
+            for( u32 i = 0; i < 3; ++i )
+            {
+                float weight = node.GetActiveWeight(i);
+                
+                if( weight <= 0.f || !IsWeighted( node.GetActiveNode(i) ) )
+                    continue;
+                
+                if( GetJointPose( node.GetActiveNode(i), clock_time_ms, joint_idx, skeleton, sample_pose, sample_traits ) )
+                {
+                    total_weight += weight;
+                    
+                    if( total_weight == weight )
+                    {
+                        pose = sample_pose;
+                        traits = sample_traits;
+                    }
+                    else
+                    {
+                        traits &= sample_traits;
+                        pose.MakeLerp(pose, sample_pose, weight / total_weight, traits);
+                    }
+                }
+            }
+            
+            return total_weight > 0.f;
+        }
+        break;
+        default:
+        ENGINE_ASSERT(0, "undefined node type");
+    }
+    
+    return false;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimBlendTree::GetJointPose( float global_time_ms, s16 joint_idx, const Skeleton& skeleton, AnimationClip::JointPose& pose, u32& traits ) const
+{
+    ENGINE_ASSERT(IsValid(), "animation tree not valid");
+    
+    return GetJointPose(0, global_time_ms, joint_idx, skeleton, pose, traits);
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBlendTree::UpdateWeights( u16 current_index, float weight, float epsilon )
+{
+    Node& node = m_nodes[current_index];
+    node.SetWeight( weight );
+    
+    switch( node.GetType() )
+    {
+        case BlendNodeType::Lerp:
+        {
+            float factor = node.GetFactor();
+            
+            float left_weight = weight * (1.f - factor);
+            float right_weight = weight * factor;
+            
+            if( left_weight > epsilon || left_weight >= right_weight )
+                UpdateWeights( node.GetLeftIndex(), left_weight, epsilon );
+            
+            if( right_weight > epsilon || right_weight > left_weight )
+                UpdateWeights( node.GetRightIndex(), right_weight, epsilon );
+        }
+        break;
+        case BlendNodeType::Additive:
+        {
+            // base pose is always needed.
+            UpdateWeights( node.GetLeftIndex(), weight, epsilon );
+            
+            float additive_weight = weight * node.GetFactor();
+            
+            if( additive_weight > epsilon )
+                UpdateWeights( node.GetRightIndex(), additive_weight, epsilon );
+        }
+        break;
+        case BlendNodeType::BlendSpace:
+        {
+            u32 heaviest = 0;
+            
+            for( u32 i = 1; i < 3; ++i )
+            {
+                if( node.GetActiveWeight(i) > node.GetActiveWeight(heaviest) )
+                    heaviest = i;
+            }
+            
+            for( u32 i = 0; i < 3; ++i )
+            {
+                float sample_weight = weight * node.GetActiveWeight(i);
+                
+                if( sample_weight > epsilon || i == heaviest )
+                    UpdateWeights( node.GetActiveNode(i), sample_weight, epsilon );
+            }
+        }
+        break;
+        default:
+        break;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBlendTree::UpdateWeights( float weight, float epsilon )
+{
+    if( !IsValid() )
+        return;
+    
+    // nodes not reached from the root stay pruned.
+    for( u16 i = 0; i < m_node_count; ++i )
+        m_nodes[i].SetWeight( 0.f );
+    
+    UpdateWeights( 0, weight, epsilon );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBlendTree::FixAnimationStartTime( float rewind_time_ms )
+{
+    for( u16 i = 0; i < m_node_count; ++i )
+    {
+        Animation& anim = m_nodes[i].GetAnimation();
+        
+        if( anim.IsValid() )
+            anim.RewindStartTime( rewind_time_ms );
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBlendTree::UpdateCursors( float global_time_ms )
+{
+    for( u16 i = 0; i < m_node_count; ++i )
+    {
+        Animation& anim = m_nodes[i].GetAnimation();
+        
+        if( anim.IsValid() )
+            anim.UpdateCursor( global_time_ms );
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimBlendTree::IsStatic( float global_time_ms ) const
+{
+    for( u16 i = 0; i < m_node_count; ++i )
+    {
+        const Animation& anim = m_nodes[i].GetAnimation();
+        
+        if( anim.IsValid() && !anim.IsStatic( global_time_ms ) )
+            return false;
+    }
+    
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBlendTree::CollectEvents( float prev_global_time_ms, float global_time_ms, float weight, u16 layer, AnimEventBuffer& events )
+{
+    // propagate current factors, so each clip fires at its share of the tree weight. zero epsilon prunes
+    // only unreachable and zero weighted branches, weights are propagated again before pose evaluation.
+    UpdateWeights( weight, 0.f );
+    
+    for( u16 i = 0; i < m_node_count; ++i )
+    {
+        Animation& anim = m_nodes[i].GetAnimation();
+        float node_weight = m_nodes[i].GetWeight();
+        
+        if( anim.IsValid() && node_weight > 0.f )
+            anim.CollectEvents( prev_global_time_ms, global_time_ms, node_weight, layer, events );
+    }
+}
+    
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
+
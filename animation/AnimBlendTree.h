@@ -1,122 +1,217 @@
-#pragma once
-
-#include "engine/animation/Animation.h"
-#include <vector>
-
-#include "rapidxml/rapidxml.hpp"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-
-class AnimationClip;
-    
-namespace BlendNodeType{
-    enum Enum{
-        Undefined = -1,
-        Value,
-        Lerp,
-        Additive
-    };
-}
-
-//---------------------------------------------------------------------------------------
-
-class AnimBlendTree
-{
-public:
-    // single animation node is a part of a blend tree.
-    // value node stores animation data.
-    // other nodes store left, right child indexes and named blend factor.
-    class Node
-    {
-    public:
-        Node();
-        Node( AnimationClip* clip, float globa_clock_ms, bool looped, float playback_rate );
-        Node( BlendNodeType::Enum type, u16 left_index, u16 right_index, StringId factor_name, float factor_value );
-        
-        inline BlendNodeType::Enum GetType() const { return m_type; }
-        
-        inline u16 GetLeftIndex() const { return m_left_index; }
-        
-        inline u16 GetRightIndex() const { return m_right_index; }
-        
-        inline StringId GetFactorName() const { return m_factor_name; }
-        
-        inline float GetFactor() const { return m_blend_factor; }
-        
-        inline void SetFactor( float value ) { m_blend_factor = value; }
-        
-        inline const Animation& GetAnimation() const { return m_animation; }
-        
-        inline Animation& GetAnimation() { return m_animation; }
-    private:
-        // left tree node.
-        u16 m_left_index;
-        
-        // right tree node.
-        u16 m_right_index;
-        
-        // type of node.
-        BlendNodeType::Enum m_type;
-        
-        // current blend factor. valid if Lerp, Additive or CrossFade node.
-        float m_blend_factor;
-        
-        // name of blend node.
-        StringId m_factor_name;
-        
-        // animation. valid if Value node.
-        Animation m_animation;
-    };
-    
-public:
-    AnimBlendTree();
-    AnimBlendTree( u16 capacity );
-    ~AnimBlendTree();
-    
-    AnimBlendTree& operator=( const AnimBlendTree& rhs );
-    
-    inline u16 GetCount() const { return m_node_count; }
-    
-    inline u16 GetCapacity() const { return m_capacity; }
-    
-    inline bool IsValid() const { return m_node_count > 0; }
-    
-    void Clear();
-    
-    void Resize( u16 capacity );
-    
-    void Start( float current_time_ms );
-    
-    bool SetNodeFactor( StringId factor_name, float value );
-    
-    bool GetNodeFactor( StringId factor_name, float& value ) const;
-    
-    // returns local animation time of first animation in the tree.
-    float GetLocalAnimationTime(float global_time) const;
-    
-    // returns true if pose has been calculated for this subtree.
-    bool GetJointPose( float global_time_ms, s16 joint_idx, AnimationClip::JointPose& pose ) const;
-    
-    // used to prevent timer overflow.
-    void FixAnimationStartTime( float rewind_time_ms );
-    
-    friend u16 read_blend_tree( AnimBlendTree& tree, rapidxml::xml_node<>* node );
-private:
-    // called recursivly to get final joint pose.
-    bool GetJointPose( u16 current_index, float clock_time_ms, s16 joint_idx, AnimationClip::JointPose& pose ) const;
-    
-    // capacity size array of nodes.
-    Node* m_nodes;
-    
-    // current numder of nodes.
-    u16 m_node_count;
-    
-    // maximum number of nodes.
-    u16 m_capacity;
-};
-
-//---------------------------------------------------------------------------------------
-} // namespace Engine
+#pragma once
+
+#include "engine/animation/Animation.h"
+#include <vector>
+
+#include "rapidxml/rapidxml.hpp"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class AnimationClip;
+class AnimBlendSpace;
+    
+namespace BlendNodeType{
+    enum Enum{
+        Undefined = -1,
+        Value,
+        Lerp,
+        Additive,
+        BlendSpace
+    };
+}
+
+//---------------------------------------------------------------------------------------
+
+class AnimBlendTree
+{
+public:
+    // single animation node is a part of a blend tree.
+    // value node stores animation data.
+    // other nodes store left, right child indexes and named blend factor.
+    // blend space node stores two named factors and samples only three nodes around them.
+    class Node
+    {
+    public:
+        Node();
+        Node( AnimationClip* clip, float globa_clock_ms, bool looped, float playback_rate, bool mirrored = false );
+        Node( BlendNodeType::Enum type, u16 left_index, u16 right_index, StringId factor_name, float factor_value );
+        Node( const AnimBlendSpace* blend_space, StringId x_factor_name, float x_value, StringId y_factor_name, float y_value );
+        
+        inline BlendNodeType::Enum GetType() const { return m_type; }
+        
+        inline u16 GetLeftIndex() const { return m_left_index; }
+        
+        inline u16 GetRightIndex() const { return m_right_index; }
+        
+        inline StringId GetFactorName() const { return m_factor_name; }
+        
+        inline float GetFactor() const { return m_blend_factor; }
+        
+        inline void SetFactor( float value ) { m_blend_factor = value; UpdateBlendSpaceWeights(); }
+        
+        // blend space y factor.
+        inline StringId GetFactorNameY() const { return m_factor_name_y; }
+        
+        inline float GetFactorY() const { return m_blend_factor_y; }
+        
+        inline void SetFactorY( float value ) { m_blend_factor_y = value; UpdateBlendSpaceWeights(); }
+        
+        inline const AnimBlendSpace* GetBlendSpace() const { return m_blend_space; }
+        
+        // tree node index and weight of one of three blend space samples selected by current factors.
+        inline u16 GetActiveNode( u32 idx ) const { return m_active_nodes[idx]; }
+        
+        inline float GetActiveWeight( u32 idx ) const { return m_active_weights[idx]; }
+        
+        // effective weight of the node in layer pose. 0 if node is pruned.
+        inline float GetWeight() const { return m_weight; }
+        
+        inline void SetWeight( float weight ) { m_weight = weight; }
+        
+        inline const Animation& GetAnimation() const { return m_animation; }
+        
+        inline Animation& GetAnimation() { return m_animation; }
+    private:
+        // finds blend space triangle for current factors. does nothing for other node types.
+        void UpdateBlendSpaceWeights();
+        
+    private:
+        // left tree node.
+        u16 m_left_index;
+        
+        // right tree node.
+        u16 m_right_index;
+        
+        // type of node.
+        BlendNodeType::Enum m_type;
+        
+        // current blend factor. valid if Lerp, Additive or CrossFade node.
+        float m_blend_factor;
+        
+        // name of blend node.
+        StringId m_factor_name;
+        
+        // animation. valid if Value node.
+        Animation m_animation;
+        
+        // second factor name and value. valid if BlendSpace node.
+        StringId m_factor_name_y;
+        float m_blend_factor_y;
+        
+        // shared sample/triangle data. valid if BlendSpace node.
+        const AnimBlendSpace* m_blend_space;
+        
+        // samples of the triangle containing current factors.
+        u16 m_active_nodes[3];
+        float m_active_weights[3];
+        
+        // effective weight propagated from the root by UpdateWeights (1 until first propagation).
+        float m_weight;
+    };
+    
+public:
+    AnimBlendTree();
+    AnimBlendTree( u16 capacity );
+    ~AnimBlendTree();
+    
+    AnimBlendTree& operator=( const AnimBlendTree& rhs );
+    
+    inline u16 GetCount() const { return m_node_count; }
+    
+    inline u16 GetCapacity() const { return m_capacity; }
+    
+    inline bool IsValid() const { return m_node_count > 0; }
+    
+    inline const Node& GetNode( u16 idx ) const { ENGINE_ASSERT(idx < m_node_count, "node out of bounds"); return m_nodes[idx]; }
+    
+    // bytes of node array (capacity sized).
+    inline size_t GetMemoryUsage() const { return (size_t)m_capacity * sizeof(Node); }
+    
+    void Clear();
+    
+    void Resize( u16 capacity );
+    
+    // makes tree a single clip node (capacity has to be at least 1).
+    void SetClip( AnimationClip* clip, bool looped, float playback_rate );
+    
+    void Start( float current_time_ms );
+    
+    bool SetNodeFactor( StringId factor_name, float value );
+    
+    bool GetNodeFactor( StringId factor_name, float& value ) const;
+    
+    // returns local animation time of first animation in the tree.
+    float GetLocalAnimationTime(float global_time) const;
+    
+    // first animation node of the tree (null if there is none). all animations share its start time.
+    const Animation* GetFirstAnimation() const;
+    
+    // writes factors of Lerp/Additive nodes and x, y factors of BlendSpace nodes in node order.
+    // returns number of factors (values beyond max_count are not written).
+    u16 GetFactors( float* values, u16 max_count ) const;
+    
+    // sets factors in GetFactors order.
+    void SetFactors( const float* values, u16 count );
+    
+    // returns true if pose has been calculated for this subtree.
+    // traits are ClipTraits::BlendMask bits shared by all clips contributing to the pose.
+    // skeleton provides mirror table of mirrored clip nodes.
+    bool GetJointPose( float global_time_ms, s16 joint_idx, const Skeleton& skeleton, AnimationClip::JointPose& pose, u32& traits ) const;
+    
+    // propagates weights top-down from the root. subtrees with weight <= epsilon get 0 weight
+    // and are skipped by GetJointPose. heavier child of a node is never pruned.
+    void UpdateWeights( float weight, float epsilon );
+    
+    // effective weight of the root node.
+    inline float GetWeight() const { return m_node_count > 0 ? m_nodes[0].GetWeight() : 0.f; }
+    
+    // used to prevent timer overflow.
+    void FixAnimationStartTime( float rewind_time_ms );
+    
+    // moves sample cursors of all clips in the tree to given global time.
+    void UpdateCursors( float global_time_ms );
+    
+    // true if none of the tree animations changes pose after given global time.
+    bool IsStatic( float global_time_ms ) const;
+    
+    // adds events of all clips in the tree passed between two global times. events are weighted by the
+    // effective clip weight, clips with zero weight fire nothing.
+    void CollectEvents( float prev_global_time_ms, float global_time_ms, float weight, u16 layer, AnimEventBuffer& events );
+    
+    friend u16 read_blend_tree( AnimBlendTree& tree, rapidxml::xml_node<>* node, std::vector<AnimBlendSpace*>& blend_spaces );
+private:
+    // called recursivly to get final joint pose.
+    bool GetJointPose( u16 current_index, float clock_time_ms, s16 joint_idx, const Skeleton& skeleton, AnimationClip::JointPose& pose, u32& traits ) const;
+    
+    // called recursivly to propagate weights.
+    void UpdateWeights( u16 current_index, float weight, float epsilon );
+    
+    // returns false (and counts pruned evaluation) if node has been pruned.
+    inline bool IsWeighted( u16 index ) const;
+    
+    // capacity size array of nodes.
+    Node* m_nodes;
+    
+    // current numder of nodes.
+    u16 m_node_count;
+    
+    // maximum number of nodes.
+    u16 m_capacity;
+};
+
+//---------------------------------------------------------------------------------------
+
+inline bool AnimBlendTree::IsWeighted( u16 index ) const
+{
+    if( m_nodes[index].GetWeight() > 0.f )
+        return true;
+    
+    ANIM_STAT_ADD(pruned_evaluations, 1);
+    return false;
+}
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
 //---------------------------------------------------------------------------------------
\ No newline at end of file
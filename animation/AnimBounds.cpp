@@ -0,0 +1,397 @@
+#include "engine/animation/AnimBounds.h"
+#include "engine/animation/AnimHierarchy.h"
+#include "engine/animation/Skeleton.h"
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <xmmintrin.h>
+    #define ANIM_BOUNDS_SSE 1
+#endif
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+template<typename T>
+static void ResizeArray( T*& array, u32 count, u32 capacity )
+{
+    T* new_array = capacity > 0 ? new T[capacity] : nullptr;
+
+    if( array && count > 0 )
+        memcpy( new_array, array, (count < capacity ? count : capacity) * sizeof(T) );
+
+    delete [] array;
+    array = new_array;
+}
+
+//---------------------------------------------------------------------------------------
+
+template<typename T>
+static inline void CopyArray( T* array, const T* source, u32 count )
+{
+    if( count > 0 )
+        memcpy( array, source, count * sizeof(T) );
+}
+
+//---------------------------------------------------------------------------------------
+
+// transforms joint space point by joint world matrix (translation in elements 3, 7, 11).
+static inline void TransformPoint( const Matrix4x4& m, const Vec3& p, float* out_x, float* out_y, float* out_z, u32 idx )
+{
+    const float* e = m.matrix;
+    out_x[idx] = e[0] * p.x + e[1] * p.y + e[2] * p.z + e[3];
+    out_y[idx] = e[4] * p.x + e[5] * p.y + e[6] * p.z + e[7];
+    out_z[idx] = e[8] * p.x + e[9] * p.y + e[10] * p.z + e[11];
+}
+
+//---------------------------------------------------------------------------------------
+// AnimBounds
+//---------------------------------------------------------------------------------------
+
+AnimBounds::AnimBounds()
+: controller(nullptr)
+, m_count(0)
+, m_capacity(0)
+{
+    for( u32 i = 0; i < 3; ++i )
+    {
+        model_min[i] = model_max[i] = nullptr;
+        world_min[i] = world_max[i] = nullptr;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimBounds::~AnimBounds()
+{
+    Resize( 0 );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBounds::Resize( u32 capacity )
+{
+    ResizeArray( controller, m_count, capacity );
+
+    for( u32 i = 0; i < 3; ++i )
+    {
+        ResizeArray( model_min[i], m_count, capacity );
+        ResizeArray( model_max[i], m_count, capacity );
+        ResizeArray( world_min[i], m_count, capacity );
+        ResizeArray( world_max[i], m_count, capacity );
+    }
+
+    m_capacity = capacity;
+
+    if( m_count > capacity )
+        m_count = capacity;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBounds::SetCount( u32 count )
+{
+    if( count > m_capacity )
+        Resize( count );
+
+    m_count = count;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBounds::Calculate( u32 idx, Handle h, const AnimHierarchy& hierarchy, float padding )
+{
+    ENGINE_ASSERT(idx < m_count, "bounds index out of bounds");
+
+    controller[idx] = h;
+
+    // model-space bounds are relative to the root joint (same as skinning palette).
+    Matrix4x4 inv_root = hierarchy.GetNode(0).GetWorldTransformation();
+    inv_root.InverseIt();
+    const float* r = inv_root.matrix;
+
+    float wmin[4], wmax[4], mmin[4], mmax[4];
+
+#if ANIM_BOUNDS_SSE
+    // inverse root matrix columns.
+    const __m128 c0 = _mm_set_ps( 0.f, r[8], r[4], r[0] );
+    const __m128 c1 = _mm_set_ps( 0.f, r[9], r[5], r[1] );
+    const __m128 c2 = _mm_set_ps( 0.f, r[10], r[6], r[2] );
+    const __m128 c3 = _mm_set_ps( 0.f, r[11], r[7], r[3] );
+
+    __m128 world_lo = _mm_set1_ps( std::numeric_limits<float>::max() );
+    __m128 world_hi = _mm_set1_ps( -std::numeric_limits<float>::max() );
+    __m128 model_lo = world_lo;
+    __m128 model_hi = world_hi;
+
+    for( u16 j = 0; j < hierarchy.GetNodeCount(); ++j )
+    {
+        const float* m = hierarchy.GetNode(j).GetWorldTransformation().matrix;
+
+        __m128 p = _mm_set_ps( 0.f, m[11], m[7], m[3] );
+        world_lo = _mm_min_ps( world_lo, p );
+        world_hi = _mm_max_ps( world_hi, p );
+
+        __m128 pm = _mm_add_ps( _mm_mul_ps( c0, _mm_set1_ps( m[3] ) ), _mm_mul_ps( c1, _mm_set1_ps( m[7] ) ) );
+        pm = _mm_add_ps( pm, _mm_add_ps( _mm_mul_ps( c2, _mm_set1_ps( m[11] ) ), c3 ) );
+        model_lo = _mm_min_ps( model_lo, pm );
+        model_hi = _mm_max_ps( model_hi, pm );
+    }
+
+    __m128 pad = _mm_set1_ps( padding );
+    _mm_storeu_ps( wmin, _mm_sub_ps( world_lo, pad ) );
+    _mm_storeu_ps( wmax, _mm_add_ps( world_hi, pad ) );
+    _mm_storeu_ps( mmin, _mm_sub_ps( model_lo, pad ) );
+    _mm_storeu_ps( mmax, _mm_add_ps( model_hi, pad ) );
+#else
+    for( u32 i = 0; i < 3; ++i )
+    {
+        wmin[i] = mmin[i] = std::numeric_limits<float>::max();
+        wmax[i] = mmax[i] = -std::numeric_limits<float>::max();
+    }
+
+    for( u16 j = 0; j < hierarchy.GetNodeCount(); ++j )
+    {
+        const float* m = hierarchy.GetNode(j).GetWorldTransformation().matrix;
+        float p[3] = { m[3], m[7], m[11] };
+
+        for( u32 i = 0; i < 3; ++i )
+        {
+            float pm = r[i*4 + 0] * p[0] + r[i*4 + 1] * p[1] + r[i*4 + 2] * p[2] + r[i*4 + 3];
+
+            wmin[i] = p[i] < wmin[i] ? p[i] : wmin[i];
+            wmax[i] = p[i] > wmax[i] ? p[i] : wmax[i];
+            mmin[i] = pm < mmin[i] ? pm : mmin[i];
+            mmax[i] = pm > mmax[i] ? pm : mmax[i];
+        }
+    }
+
+    for( u32 i = 0; i < 3; ++i )
+    {
+        wmin[i] -= padding; wmax[i] += padding;
+        mmin[i] -= padding; mmax[i] += padding;
+    }
+#endif
+
+    for( u32 i = 0; i < 3; ++i )
+    {
+        world_min[i][idx] = wmin[i];
+        world_max[i][idx] = wmax[i];
+        model_min[i][idx] = mmin[i];
+        model_max[i][idx] = mmax[i];
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBounds::SetUnion( u32 idx, Handle h, const AnimBounds& source, u32 first, u32 second, float padding )
+{
+    ENGINE_ASSERT(idx < m_count, "bounds index out of bounds");
+    ENGINE_ASSERT(first < source.m_count && second < source.m_count, "source bounds index out of bounds");
+
+    controller[idx] = h;
+
+    for( u32 i = 0; i < 3; ++i )
+    {
+        world_min[i][idx] = std::min( source.world_min[i][first], source.world_min[i][second] ) - padding;
+        world_max[i][idx] = std::max( source.world_max[i][first], source.world_max[i][second] ) + padding;
+        model_min[i][idx] = std::min( source.model_min[i][first], source.model_min[i][second] ) - padding;
+        model_max[i][idx] = std::max( source.model_max[i][first], source.model_max[i][second] ) + padding;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBounds::CopyFrom( const AnimBounds& source )
+{
+    SetCount( source.m_count );
+    CopyArray( controller, source.controller, m_count );
+
+    for( u32 i = 0; i < 3; ++i )
+    {
+        CopyArray( model_min[i], source.model_min[i], m_count );
+        CopyArray( model_max[i], source.model_max[i], m_count );
+        CopyArray( world_min[i], source.world_min[i], m_count );
+        CopyArray( world_max[i], source.world_max[i], m_count );
+    }
+}
+
+//---------------------------------------------------------------------------------------
+// AnimHitShapes
+//---------------------------------------------------------------------------------------
+
+AnimHitShapes::AnimHitShapes()
+: capsule_controller(nullptr)
+, capsule_joint(nullptr)
+, capsule_radius(nullptr)
+, box_controller(nullptr)
+, box_joint(nullptr)
+, m_capsule_count(0)
+, m_capsule_capacity(0)
+, m_box_count(0)
+, m_box_capacity(0)
+{
+    for( u32 i = 0; i < 3; ++i )
+    {
+        capsule_a[i] = capsule_b[i] = nullptr;
+        box_center[i] = box_axis_x[i] = box_axis_y[i] = box_axis_z[i] = nullptr;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimHitShapes::~AnimHitShapes()
+{
+    m_capsule_count = m_box_count = 0;
+    ReserveCapsules( 0 );
+    ReserveBoxes( 0 );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimHitShapes::ReserveCapsules( u32 capacity )
+{
+    ResizeArray( capsule_controller, m_capsule_count, capacity );
+    ResizeArray( capsule_joint, m_capsule_count, capacity );
+    ResizeArray( capsule_radius, m_capsule_count, capacity );
+
+    for( u32 i = 0; i < 3; ++i )
+    {
+        ResizeArray( capsule_a[i], m_capsule_count, capacity );
+        ResizeArray( capsule_b[i], m_capsule_count, capacity );
+    }
+
+    m_capsule_capacity = capacity;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimHitShapes::ReserveBoxes( u32 capacity )
+{
+    ResizeArray( box_controller, m_box_count, capacity );
+    ResizeArray( box_joint, m_box_count, capacity );
+
+    for( u32 i = 0; i < 3; ++i )
+    {
+        ResizeArray( box_center[i], m_box_count, capacity );
+        ResizeArray( box_axis_x[i], m_box_count, capacity );
+        ResizeArray( box_axis_y[i], m_box_count, capacity );
+        ResizeArray( box_axis_z[i], m_box_count, capacity );
+    }
+
+    m_box_capacity = capacity;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimHitShapes::SetCount( u32 capsule_count, u32 box_count )
+{
+    if( capsule_count > m_capsule_capacity )
+        ReserveCapsules( capsule_count );
+
+    if( box_count > m_box_capacity )
+        ReserveBoxes( box_count );
+
+    m_capsule_count = capsule_count;
+    m_box_count = box_count;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimHitShapes::CopyFrom( const AnimHitShapes& source )
+{
+    SetCount( source.m_capsule_count, source.m_box_count );
+
+    CopyArray( capsule_controller, source.capsule_controller, m_capsule_count );
+    CopyArray( capsule_joint, source.capsule_joint, m_capsule_count );
+    CopyArray( capsule_radius, source.capsule_radius, m_capsule_count );
+    CopyArray( box_controller, source.box_controller, m_box_count );
+    CopyArray( box_joint, source.box_joint, m_box_count );
+
+    for( u32 i = 0; i < 3; ++i )
+    {
+        CopyArray( capsule_a[i], source.capsule_a[i], m_capsule_count );
+        CopyArray( capsule_b[i], source.capsule_b[i], m_capsule_count );
+        CopyArray( box_center[i], source.box_center[i], m_box_count );
+        CopyArray( box_axis_x[i], source.box_axis_x[i], m_box_count );
+        CopyArray( box_axis_y[i], source.box_axis_y[i], m_box_count );
+        CopyArray( box_axis_z[i], source.box_axis_z[i], m_box_count );
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimHitShapes::CountShapes( const Skeleton& skeleton, u32& capsule_count, u32& box_count )
+{
+    capsule_count = 0;
+    box_count = 0;
+
+    for( u32 i = 0; i < skeleton.GetHitShapeCount(); ++i )
+    {
+        if( skeleton.GetHitShape(i).type == HitShapeType::Capsule )
+            capsule_count++;
+        else
+            box_count++;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimHitShapes::Calculate( u32 first_capsule, u32 first_box, Handle controller, const Skeleton& skeleton, const AnimHierarchy& hierarchy )
+{
+    u32 idx_capsule = first_capsule;
+    u32 idx_box = first_box;
+
+    for( u32 i = 0; i < skeleton.GetHitShapeCount(); ++i )
+    {
+        const SkeletonHitShape& shape = skeleton.GetHitShape(i);
+        ENGINE_ASSERT(shape.joint_index < hierarchy.GetNodeCount(), "hit shape joint out of bounds");
+
+        const Matrix4x4& world = hierarchy.GetNode( shape.joint_index ).GetWorldTransformation();
+        const float* m = world.matrix;
+
+        switch( shape.type )
+        {
+            case HitShapeType::Capsule:
+            {
+                u32 idx = idx_capsule++;
+                ENGINE_ASSERT(idx < m_capsule_count, "capsule index out of bounds");
+
+                capsule_controller[idx] = controller;
+                capsule_joint[idx] = (u16)shape.joint_index;
+
+                TransformPoint( world, shape.point_a, capsule_a[0], capsule_a[1], capsule_a[2], idx );
+                TransformPoint( world, shape.point_b, capsule_b[0], capsule_b[1], capsule_b[2], idx );
+
+                // joint transformation uses uniform scale - length of any axis.
+                float scale = sqrtf( m[0] * m[0] + m[4] * m[4] + m[8] * m[8] );
+                capsule_radius[idx] = shape.radius * scale;
+            }
+            break;
+            case HitShapeType::Box:
+            {
+                u32 idx = idx_box++;
+                ENGINE_ASSERT(idx < m_box_count, "box index out of bounds");
+
+                box_controller[idx] = controller;
+                box_joint[idx] = (u16)shape.joint_index;
+
+                TransformPoint( world, shape.point_a, box_center[0], box_center[1], box_center[2], idx );
+
+                for( u32 r = 0; r < 3; ++r )
+                {
+                    box_axis_x[r][idx] = m[r*4 + 0] * shape.half_extents.x;
+                    box_axis_y[r][idx] = m[r*4 + 1] * shape.half_extents.y;
+                    box_axis_z[r][idx] = m[r*4 + 2] * shape.half_extents.z;
+                }
+            }
+            break;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
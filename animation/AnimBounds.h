@@ -0,0 +1,114 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/core/ObjectArray.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class Skeleton;
+class AnimHierarchy;
+
+// per-controller axis aligned boxes enclosing animated joints.
+// compact structure-of-arrays suitable for broadphase culling.
+class AnimBounds
+{
+public:
+    AnimBounds();
+    ~AnimBounds();
+
+    void Resize( u32 capacity );
+
+    inline void Clear() { m_count = 0; }
+
+    // sets number of valid entries, grows arrays if needed.
+    void SetCount( u32 count );
+
+    // calculates bounds of controller joints into given entry. hierarchy global transformations have to be up to date.
+    // padding enlarges boxes to account for skin around the joints.
+    void Calculate( u32 idx, Handle controller, const AnimHierarchy& hierarchy, float padding );
+
+    // sets entry to union of two source entries enlarged by padding (used for pre-baked bounds).
+    void SetUnion( u32 idx, Handle controller, const AnimBounds& source, u32 first, u32 second, float padding );
+
+    // copies valid entries of source (grows arrays if needed).
+    void CopyFrom( const AnimBounds& source );
+
+    inline u32 GetCount() const { return m_count; }
+
+public:
+    // controller owning the bounds.
+    Handle* controller;
+
+    // min/max x, y, z relative to the root joint.
+    float* model_min[3];
+    float* model_max[3];
+
+    // min/max x, y, z in hierarchy world-space.
+    float* world_min[3];
+    float* world_max[3];
+
+private:
+    u32 m_count;
+    u32 m_capacity;
+};
+
+//---------------------------------------------------------------------------------------
+
+// world-space hit shapes generated from SkeletonHitShape definitions.
+class AnimHitShapes
+{
+public:
+    AnimHitShapes();
+    ~AnimHitShapes();
+
+    inline void Clear() { m_capsule_count = 0; m_box_count = 0; }
+
+    // sets number of valid capsules and boxes, grows arrays if needed.
+    void SetCount( u32 capsule_count, u32 box_count );
+
+    // calculates world-space hit shapes of controller skeleton into entries starting at first_capsule and first_box.
+    void Calculate( u32 first_capsule, u32 first_box, Handle controller, const Skeleton& skeleton, const AnimHierarchy& hierarchy );
+
+    // copies valid capsules and boxes of source (grows arrays if needed).
+    void CopyFrom( const AnimHitShapes& source );
+
+    // number of capsules and boxes defined in skeleton.
+    static void CountShapes( const Skeleton& skeleton, u32& capsule_count, u32& box_count );
+
+    inline u32 GetCapsuleCount() const { return m_capsule_count; }
+
+    inline u32 GetBoxCount() const { return m_box_count; }
+
+public:
+    // capsules.
+    Handle* capsule_controller;
+    u16* capsule_joint;
+    float* capsule_a[3];
+    float* capsule_b[3];
+    float* capsule_radius;
+
+    // oriented boxes. axes are scaled by half extents.
+    Handle* box_controller;
+    u16* box_joint;
+    float* box_center[3];
+    float* box_axis_x[3];
+    float* box_axis_y[3];
+    float* box_axis_z[3];
+
+private:
+    void ReserveCapsules( u32 capacity );
+    void ReserveBoxes( u32 capacity );
+
+private:
+    u32 m_capsule_count;
+    u32 m_capsule_capacity;
+
+    u32 m_box_count;
+    u32 m_box_capacity;
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
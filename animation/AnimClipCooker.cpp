@@ -0,0 +1,834 @@
+#include "engine/animation/AnimClipCooker.h"
+#include "engine/animation/AnimWorkerPool.h"
+#include "engine/animation/AnimTrace.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+ClipCookSettings::ClipCookSettings()
+: frames_per_second(0.f)
+, looped(false)
+, reference(nullptr)
+, reference_frame(-1)
+, curve_translation_error(0.f)
+, curve_rotation_error(0.f)
+, trait_epsilon(1e-6f)
+{
+    
+}
+
+//---------------------------------------------------------------------------------------
+
+// offsets of clip arrays relative to the end of clip header.
+struct ClipLayout
+{
+    size_t poses;
+    size_t curve_keys;
+    size_t remap;
+    size_t curve_key_frames;
+    size_t events;
+    size_t curve_joint_keys;
+    size_t size;
+};
+
+//---------------------------------------------------------------------------------------
+
+static size_t AlignUp( size_t value, size_t alignment )
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+//---------------------------------------------------------------------------------------
+
+static ClipLayout GetLayout( s16 skeleton_joint_count, s16 animated_joint_count, u32 frame_count, u32 event_count, u32 curve_key_count )
+{
+    ClipLayout layout;
+    
+    // dense frames are not stored for curve clips.
+    size_t pose_count = curve_key_count > 0 ? 0 : (size_t)animated_joint_count * frame_count;
+    size_t joint_key_count = curve_key_count > 0 ? (size_t)animated_joint_count + 1 : 0;
+    
+    // offsets are aligned relative to block start (header size keeps poses 16 byte aligned).
+    size_t header = sizeof(AnimationClip);
+    
+    layout.poses = AlignUp( header, 16 ) - header;
+    layout.curve_keys = AlignUp( header + layout.poses + pose_count * sizeof(AnimationClip::JointPose), 16 ) - header;
+    layout.remap = layout.curve_keys + (size_t)curve_key_count * sizeof(AnimationClip::CurveKey);
+    layout.curve_key_frames = layout.remap + (size_t)skeleton_joint_count * sizeof(s16);
+    layout.events = AlignUp( header + layout.curve_key_frames + (size_t)curve_key_count * sizeof(u16), 4 ) - header;
+    layout.curve_joint_keys = layout.events + (size_t)event_count * sizeof(AnimationClip::Event);
+    layout.size = header + layout.curve_joint_keys + joint_key_count * sizeof(u32);
+    
+    return layout;
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimationClip* AnimClipCooker::Allocate( s16 skeleton_joint_count, s16 animated_joint_count, u32 frame_count, u32 event_count, u32 curve_key_count )
+{
+    ClipLayout layout = GetLayout( skeleton_joint_count, animated_joint_count, frame_count, event_count, curve_key_count );
+    
+    u8* data = new u8[layout.size];
+    memset( data, 0, layout.size );
+    
+    AnimationClip* clip = (AnimationClip*)data;
+    u8* arrays = data + sizeof(AnimationClip);
+    
+    clip->m_magic = AnimationClip::Magic;
+    clip->m_version = AnimationClip::Version;
+    clip->m_name = 0;
+    clip->m_skeleton_joint_count = skeleton_joint_count;
+    clip->m_animated_joint_count = animated_joint_count;
+    clip->m_frames_per_ms = 0.f;
+    clip->m_frame_count = frame_count;
+    clip->m_joint_poses = (AnimationClip::JointPose*)( arrays + layout.poses );
+    clip->m_joint_remap = (s16*)( arrays + layout.remap );
+    clip->m_event_count = event_count;
+    clip->m_events = event_count > 0 ? (AnimationClip::Event*)( arrays + layout.events ) : nullptr;
+    clip->m_curve_key_count = curve_key_count;
+    clip->m_curve_keys = curve_key_count > 0 ? (AnimationClip::CurveKey*)( arrays + layout.curve_keys ) : nullptr;
+    clip->m_curve_key_frames = curve_key_count > 0 ? (u16*)( arrays + layout.curve_key_frames ) : nullptr;
+    clip->m_curve_joint_keys = curve_key_count > 0 ? (u32*)( arrays + layout.curve_joint_keys ) : nullptr;
+    clip->m_traits = ClipTraits::None;
+    clip->m_translation_joint = -1;
+    
+    return clip;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimClipCooker::Free( AnimationClip* clip )
+{
+    delete [] (u8*)clip;
+}
+
+//---------------------------------------------------------------------------------------
+
+size_t AnimClipCooker::GetDataSize( const AnimationClip& clip )
+{
+    return GetLayout( clip.m_skeleton_joint_count, clip.m_animated_joint_count, clip.m_frame_count, clip.m_event_count, clip.m_curve_key_count ).size;
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimationClip* AnimClipCooker::Load( const char* path )
+{
+    FILE* file = fopen( path, "rb" );
+    
+    if( !file )
+        return nullptr;
+    
+    fseek( file, 0, SEEK_END );
+    long file_size = ftell( file );
+    fseek( file, 0, SEEK_SET );
+    
+    if( file_size < (long)sizeof(AnimationClip) )
+    {
+        fclose( file );
+        return nullptr;
+    }
+    
+    u8* data = new u8[file_size];
+    size_t read = fread( data, 1, file_size, file );
+    fclose( file );
+    
+    AnimationClip* clip = (AnimationClip*)data;
+    
+    // reject files of other layout versions and files whose arrays point outside of the file.
+    if( read != (size_t)file_size
+       || !clip->IsCurrentVersion()
+       || clip->m_skeleton_joint_count < 0
+       || clip->m_animated_joint_count < 0
+       || GetDataSize( *clip ) > (size_t)file_size )
+    {
+        Free( clip );
+        return nullptr;
+    }
+    
+    size_t array_size = file_size - sizeof(AnimationClip);
+    size_t poses_size = clip->HasCurves() ? 0 : (size_t)clip->m_animated_joint_count * clip->m_frame_count * sizeof(AnimationClip::JointPose);
+    size_t remap_size = (size_t)clip->m_skeleton_joint_count * sizeof(s16);
+    size_t events_size = (size_t)clip->m_event_count * sizeof(AnimationClip::Event);
+    size_t curve_keys_size = (size_t)clip->m_curve_key_count * sizeof(AnimationClip::CurveKey);
+    size_t curve_frames_size = (size_t)clip->m_curve_key_count * sizeof(u16);
+    size_t curve_joints_size = ((size_t)clip->m_animated_joint_count + 1) * sizeof(u32);
+    
+    if( (size_t)clip->m_joint_poses + poses_size > array_size
+       || (size_t)clip->m_joint_remap + remap_size > array_size
+       || (clip->m_event_count > 0 && (size_t)clip->m_events + events_size > array_size)
+       || (clip->HasCurves() && ( (size_t)clip->m_curve_keys + curve_keys_size > array_size
+                               || (size_t)clip->m_curve_key_frames + curve_frames_size > array_size
+                               || (size_t)clip->m_curve_joint_keys + curve_joints_size > array_size )) )
+    {
+        Free( clip );
+        return nullptr;
+    }
+    
+    clip->FixPointers();
+    return clip;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimClipCooker::Save( const AnimationClip& clip, const char* path )
+{
+    // repack, so the output layout does not depend on the source file.
+    AnimationClip* copy = Allocate( clip.m_skeleton_joint_count, clip.m_animated_joint_count, clip.m_frame_count, clip.m_event_count, clip.m_curve_key_count );
+    
+    copy->m_name = clip.m_name;
+    copy->m_frames_per_ms = clip.m_frames_per_ms;
+    copy->m_traits = clip.m_traits;
+    copy->m_translation_joint = clip.m_translation_joint;
+    
+    if( clip.HasCurves() )
+    {
+        memcpy( copy->m_curve_keys, clip.m_curve_keys, clip.m_curve_key_count * sizeof(AnimationClip::CurveKey) );
+        memcpy( copy->m_curve_key_frames, clip.m_curve_key_frames, clip.m_curve_key_count * sizeof(u16) );
+        memcpy( copy->m_curve_joint_keys, clip.m_curve_joint_keys, ((size_t)clip.m_animated_joint_count + 1) * sizeof(u32) );
+    }
+    else
+    {
+        memcpy( copy->m_joint_poses, clip.m_joint_poses, (size_t)clip.m_animated_joint_count * clip.m_frame_count * sizeof(AnimationClip::JointPose) );
+    }
+    
+    memcpy( copy->m_joint_remap, clip.m_joint_remap, (size_t)clip.m_skeleton_joint_count * sizeof(s16) );
+    
+    if( clip.m_event_count > 0 )
+        memcpy( copy->m_events, clip.m_events, clip.m_event_count * sizeof(AnimationClip::Event) );
+    
+    size_t size = GetDataSize( *copy );
+    copy->BreakPointers();
+    
+    bool result = false;
+    FILE* file = fopen( path, "wb" );
+    
+    if( file )
+    {
+        result = fwrite( copy, 1, size, file ) == size;
+        result = (fclose( file ) == 0) && result;
+    }
+    
+    Free( copy );
+    return result;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimClipCooker::Validate( const AnimationClip& clip )
+{
+    if( clip.m_frame_count == 0 || !(clip.m_frames_per_ms > 0.f) )
+        return false;
+    
+    if( clip.m_skeleton_joint_count <= 0 || clip.m_animated_joint_count < 0 || clip.m_animated_joint_count > clip.m_skeleton_joint_count )
+        return false;
+    
+    // every animated joint has to be referenced by exactly one skeleton joint.
+    u8* referenced = new u8[clip.m_animated_joint_count + 1];
+    memset( referenced, 0, clip.m_animated_joint_count + 1 );
+    
+    bool valid = true;
+    s16 remapped_count = 0;
+    
+    for( s16 i = 0; i < clip.m_skeleton_joint_count && valid; ++i )
+    {
+        s16 idx = clip.m_joint_remap[i];
+        
+        if( idx == -1 )
+            continue;
+        
+        if( idx < 0 || idx >= clip.m_animated_joint_count || referenced[idx] )
+            valid = false;
+        else
+        {
+            referenced[idx] = 1;
+            remapped_count++;
+        }
+    }
+    
+    delete [] referenced;
+    
+    if( !valid || remapped_count != clip.m_animated_joint_count )
+        return false;
+    
+    // every joint curve covers whole clip with increasing key frames.
+    if( clip.HasCurves() )
+    {
+        if( clip.m_frame_count > 0x10000 || clip.m_curve_joint_keys[0] != 0 || clip.m_curve_joint_keys[clip.m_animated_joint_count] != clip.m_curve_key_count )
+            return false;
+        
+        for( s16 j = 0; j < clip.m_animated_joint_count; ++j )
+        {
+            u32 first = clip.m_curve_joint_keys[j];
+            u32 end = clip.m_curve_joint_keys[j + 1];
+            
+            if( end <= first || end > clip.m_curve_key_count )
+                return false;
+            
+            if( clip.m_curve_key_frames[first] != 0 || (end - first > 1 && clip.m_curve_key_frames[end - 1] != clip.m_frame_count - 1) )
+                return false;
+            
+            for( u32 k = first + 1; k < end; ++k )
+            {
+                if( clip.m_curve_key_frames[k] <= clip.m_curve_key_frames[k - 1] )
+                    return false;
+            }
+        }
+    }
+    
+    // events sorted and inside the clip.
+    float duration = clip.GetDuration( true );
+    
+    for( u32 i = 0; i < clip.m_event_count; ++i )
+    {
+        if( clip.m_events[i].time_ms < 0.f || clip.m_events[i].time_ms > duration )
+            return false;
+        
+        if( i > 0 && clip.m_events[i].time_ms < clip.m_events[i-1].time_ms )
+            return false;
+    }
+    
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimationClip* AnimClipCooker::Resample( const AnimationClip& clip, float frames_per_second, bool looped )
+{
+    if( clip.HasCurves() )
+        return nullptr;
+    
+    float frames_per_ms = frames_per_second * 0.001f;
+    u32 frame_count = 1;
+    
+    if( looped )
+    {
+        // looped duration includes the interval from the last frame back to frame 0.
+        float duration_ms = clip.GetDuration( true );
+        frame_count = (u32)( duration_ms * frames_per_ms + 0.5f );
+        
+        if( frame_count < 1 )
+            frame_count = 1;
+        
+        frames_per_ms = frame_count / duration_ms;
+    }
+    else if( clip.m_frame_count > 1 )
+    {
+        // span between first and last frame stays the same.
+        float span_ms = clip.GetDuration( false );
+        frame_count = (u32)( span_ms * frames_per_ms + 0.5f ) + 1;
+        
+        if( frame_count < 2 )
+            frame_count = 2;
+        
+        frames_per_ms = (frame_count - 1) / span_ms;
+    }
+    
+    AnimationClip* out = Allocate( clip.m_skeleton_joint_count, clip.m_animated_joint_count, frame_count, clip.m_event_count, 0 );
+    
+    out->m_name = clip.m_name;
+    out->m_frames_per_ms = frames_per_ms;
+    out->m_traits = clip.m_traits;
+    out->m_translation_joint = clip.m_translation_joint;
+    
+    memcpy( out->m_joint_remap, clip.m_joint_remap, (size_t)clip.m_skeleton_joint_count * sizeof(s16) );
+    
+    // event times are kept, except those past the new clip end.
+    float max_event_time = out->GetDuration( true );
+    
+    for( u32 i = 0; i < clip.m_event_count; ++i )
+    {
+        out->m_events[i] = clip.m_events[i];
+        
+        if( out->m_events[i].time_ms > max_event_time )
+            out->m_events[i].time_ms = max_event_time;
+    }
+    
+    u32 joint_count = clip.m_animated_joint_count;
+    
+    for( u32 f = 0; f < frame_count; ++f )
+    {
+        // source frame sample.
+        float sample = 0.f;
+        
+        if( looped )
+            sample = (float)f * clip.m_frame_count / frame_count;
+        else if( frame_count > 1 )
+            sample = (float)f * (clip.m_frame_count - 1) / (frame_count - 1);
+        
+        u32 lower = (u32)Math::Floor<float>( sample );
+        u32 upper = lower + 1;
+        
+        if( looped )
+        {
+            // last interval blends back to the first frame.
+            if( lower >= clip.m_frame_count )
+                lower = clip.m_frame_count - 1;
+            
+            if( upper >= clip.m_frame_count )
+                upper = 0;
+        }
+        else if( lower >= clip.m_frame_count - 1 )
+        {
+            lower = clip.m_frame_count - 1;
+            upper = lower;
+        }
+        
+        float factor = sample - (float)lower;
+        
+        const AnimationClip::JointPose* lower_poses = clip.m_joint_poses + lower * joint_count;
+        const AnimationClip::JointPose* upper_poses = clip.m_joint_poses + upper * joint_count;
+        AnimationClip::JointPose* out_poses = out->m_joint_poses + f * joint_count;
+        
+        for( u32 j = 0; j < joint_count; ++j )
+            out_poses[j].MakeLerp( lower_poses[j], upper_poses[j], factor );
+    }
+    
+    return out;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimClipCooker::MakeAdditive( AnimationClip& clip, const AnimationClip& reference, u32 reference_frame )
+{
+    if( clip.HasCurves() || reference.HasCurves() )
+        return false;
+    
+    if( clip.m_skeleton_joint_count != reference.m_skeleton_joint_count || reference_frame >= reference.m_frame_count )
+        return false;
+    
+    const AnimationClip::JointPose* reference_poses = reference.m_joint_poses + reference_frame * reference.m_animated_joint_count;
+    
+    for( u32 f = 0; f < clip.m_frame_count; ++f )
+    {
+        AnimationClip::JointPose* poses = clip.m_joint_poses + f * clip.m_animated_joint_count;
+        
+        for( s16 i = 0; i < clip.m_skeleton_joint_count; ++i )
+        {
+            s16 idx = clip.m_joint_remap[i];
+            s16 reference_idx = reference.m_joint_remap[i];
+            
+            if( idx != -1 && reference_idx != -1 )
+                poses[idx] -= reference_poses[reference_idx];
+        }
+    }
+    
+    clip.m_traits = ClipTraits::Additive;
+    clip.m_translation_joint = -1;
+    
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimClipCooker::DetectTraits( AnimationClip& clip, float epsilon )
+{
+    if( clip.HasCurves() )
+        return;
+    
+    bool additive = (clip.m_traits & ClipTraits::Additive) != 0;
+    float identity_scale = additive ? 0.f : 1.f;
+    
+    bool identity_scales = true;
+    bool identity_translations = additive;
+    s16 translation_joint = -1;
+    u32 animated_translations = 0;
+    
+    for( s16 j = 0; j < clip.m_animated_joint_count; ++j )
+    {
+        const AnimationClip::JointPose& first = clip.m_joint_poses[j];
+        
+        bool static_translation = true;
+        
+        for( u32 f = 0; f < clip.m_frame_count; ++f )
+        {
+            const AnimationClip::JointPose& pose = clip.m_joint_poses[f * clip.m_animated_joint_count + j];
+            
+            if( fabsf( pose.scale - identity_scale ) > epsilon )
+                identity_scales = false;
+            
+            // additive translation has to be 0, regular one just constant.
+            Vec3 reference = additive ? Vec3( 0.f, 0.f, 0.f ) : first.translation;
+            
+            if( fabsf( pose.translation.x - reference.x ) > epsilon
+               || fabsf( pose.translation.y - reference.y ) > epsilon
+               || fabsf( pose.translation.z - reference.z ) > epsilon )
+                static_translation = false;
+        }
+        
+        if( !static_translation )
+        {
+            translation_joint = j;
+            animated_translations++;
+        }
+    }
+    
+    u32 traits = additive ? ClipTraits::Additive : ClipTraits::None;
+    
+    if( identity_scales )
+        traits |= ClipTraits::IdentityScale;
+    
+    // rotation only clip or clip with a single translated joint (root motion).
+    if( animated_translations <= 1 )
+    {
+        traits |= ClipTraits::StaticTranslation;
+        
+        if( identity_translations )
+            traits |= ClipTraits::IdentityTranslation;
+        
+        clip.m_translation_joint = translation_joint;
+    }
+    else
+    {
+        clip.m_translation_joint = -1;
+    }
+    
+    clip.m_traits = traits;
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimationClip* AnimClipCooker::Decode( const AnimationClip& clip )
+{
+    AnimationClip* out = Allocate( clip.m_skeleton_joint_count, clip.m_animated_joint_count, clip.m_frame_count, clip.m_event_count, 0 );
+    
+    out->m_name = clip.m_name;
+    out->m_frames_per_ms = clip.m_frames_per_ms;
+    out->m_traits = clip.m_traits;
+    out->m_translation_joint = clip.m_translation_joint;
+    
+    memcpy( out->m_joint_remap, clip.m_joint_remap, (size_t)clip.m_skeleton_joint_count * sizeof(s16) );
+    
+    if( clip.m_event_count > 0 )
+        memcpy( out->m_events, clip.m_events, clip.m_event_count * sizeof(AnimationClip::Event) );
+    
+    for( u32 f = 0; f < clip.m_frame_count; ++f )
+    {
+        AnimationClip::SampleCursor cursor;
+        cursor.local_time_ms = f / clip.m_frames_per_ms;
+        cursor.lower_frame = f;
+        cursor.upper_frame = f;
+        cursor.factor = 0.f;
+        
+        for( s16 i = 0; i < clip.m_skeleton_joint_count; ++i )
+        {
+            if( clip.HasJointPose(i) )
+                clip.GetJointPose( cursor, i, out->m_joint_poses[f * clip.m_animated_joint_count + clip.m_joint_remap[i]] );
+        }
+    }
+    
+    return out;
+}
+
+//---------------------------------------------------------------------------------------
+
+// dense joint channels used by curve fitting. rotations are made hemisphere continuous.
+struct CurveFitTrack
+{
+    std::vector<float> translation_scale;
+    std::vector<float> rotation;
+    std::vector<float> translation_scale_tangent;
+    std::vector<float> rotation_tangent;
+};
+
+//---------------------------------------------------------------------------------------
+
+static void MakeCurveKey( const CurveFitTrack& track, u32 frame, AnimationClip::CurveKey& key )
+{
+    for( u32 c = 0; c < 4; ++c )
+    {
+        key.translation_scale[c] = track.translation_scale[frame * 4 + c];
+        key.rotation[c] = track.rotation[frame * 4 + c];
+        key.translation_scale_tangent[c] = track.translation_scale_tangent[frame * 4 + c];
+        key.rotation_tangent[c] = track.rotation_tangent[frame * 4 + c];
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimationClip* AnimClipCooker::FitCurves( const AnimationClip& clip, float translation_error, float rotation_error )
+{
+    if( clip.HasCurves() || clip.m_frame_count == 0 || clip.m_frame_count > 0x10000 )
+        return nullptr;
+    
+    u32 frame_count = clip.m_frame_count;
+    u32 joint_count = clip.m_animated_joint_count;
+    
+    std::vector<u16> key_frames;
+    std::vector<AnimationClip::CurveKey> keys;
+    std::vector<u32> joint_keys( joint_count + 1, 0 );
+    
+    CurveFitTrack track;
+    track.translation_scale.resize( frame_count * 4 );
+    track.rotation.resize( frame_count * 4 );
+    track.translation_scale_tangent.resize( frame_count * 4 );
+    track.rotation_tangent.resize( frame_count * 4 );
+    
+    std::vector<u8> is_key( frame_count );
+    std::vector<u32> segments;
+    
+    for( u32 j = 0; j < joint_count; ++j )
+    {
+        for( u32 f = 0; f < frame_count; ++f )
+        {
+            const AnimationClip::JointPose& pose = clip.m_joint_poses[f * joint_count + j];
+            const float* q = (const float*)&pose.rotation;
+            
+            float* ts = &track.translation_scale[f * 4];
+            float* r = &track.rotation[f * 4];
+            
+            ts[0] = pose.translation.x;
+            ts[1] = pose.translation.y;
+            ts[2] = pose.translation.z;
+            ts[3] = pose.scale;
+            
+            float length = sqrtf( q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3] );
+            float sign = 1.f;
+            
+            // q and -q are the same rotation, keep neighbours on the same hemisphere.
+            if( f > 0 )
+            {
+                const float* prev = &track.rotation[(f - 1) * 4];
+                sign = prev[0] * q[0] + prev[1] * q[1] + prev[2] * q[2] + prev[3] * q[3] < 0.f ? -1.f : 1.f;
+            }
+            
+            for( u32 c = 0; c < 4; ++c )
+                r[c] = sign * q[c] / length;
+        }
+        
+        // catmull-rom style tangents per frame (one sided at clip ends).
+        for( u32 f = 0; f < frame_count; ++f )
+        {
+            u32 prev = f > 0 ? f - 1 : f;
+            u32 next = f + 1 < frame_count ? f + 1 : f;
+            float span = next > prev ? (float)(next - prev) : 1.f;
+            
+            for( u32 c = 0; c < 4; ++c )
+            {
+                track.translation_scale_tangent[f * 4 + c] = (track.translation_scale[next * 4 + c] - track.translation_scale[prev * 4 + c]) / span;
+                track.rotation_tangent[f * 4 + c] = (track.rotation[next * 4 + c] - track.rotation[prev * 4 + c]) / span;
+            }
+        }
+        
+        // split segments at the worst frame until all frames are within error bounds.
+        std::fill( is_key.begin(), is_key.end(), 0 );
+        is_key[0] = 1;
+        is_key[frame_count - 1] = 1;
+        
+        segments.clear();
+        
+        if( frame_count > 2 )
+        {
+            segments.push_back( 0 );
+            segments.push_back( frame_count - 1 );
+        }
+        
+        while( !segments.empty() )
+        {
+            u32 b = segments.back(); segments.pop_back();
+            u32 a = segments.back(); segments.pop_back();
+            
+            AnimationClip::CurveKey key_a, key_b;
+            MakeCurveKey( track, a, key_a );
+            MakeCurveKey( track, b, key_b );
+            
+            u32 worst = 0;
+            float worst_error = 1.f;
+            
+            for( u32 f = a + 1; f < b; ++f )
+            {
+                AnimationClip::JointPose pose;
+                AnimationClip::EvaluateCurve( key_a, (float)a, key_b, (float)b, (float)f, pose );
+                
+                const float* ts = &track.translation_scale[f * 4];
+                const float* r = &track.rotation[f * 4];
+                const float* q = (const float*)&pose.rotation;
+                
+                float dx = pose.translation.x - ts[0];
+                float dy = pose.translation.y - ts[1];
+                float dz = pose.translation.z - ts[2];
+                
+                float dot = fabsf( q[0] * r[0] + q[1] * r[1] + q[2] * r[2] + q[3] * r[3] );
+                float angle = 2.f * acosf( dot < 1.f ? dot : 1.f );
+                
+                // errors relative to bounds, > 1 means the frame is out of bounds.
+                float error = sqrtf( dx * dx + dy * dy + dz * dz ) / translation_error;
+                float scale_error = fabsf( pose.scale - ts[3] ) / translation_error;
+                float rotation_error_ratio = angle / rotation_error;
+                
+                error = scale_error > error ? scale_error : error;
+                error = rotation_error_ratio > error ? rotation_error_ratio : error;
+                
+                if( error > worst_error )
+                {
+                    worst_error = error;
+                    worst = f;
+                }
+            }
+            
+            if( worst > 0 )
+            {
+                is_key[worst] = 1;
+                
+                if( worst - a > 1 )
+                {
+                    segments.push_back( a );
+                    segments.push_back( worst );
+                }
+                
+                if( b - worst > 1 )
+                {
+                    segments.push_back( worst );
+                    segments.push_back( b );
+                }
+            }
+        }
+        
+        joint_keys[j] = (u32)keys.size();
+        
+        for( u32 f = 0; f < frame_count; ++f )
+        {
+            if( is_key[f] )
+            {
+                AnimationClip::CurveKey key;
+                MakeCurveKey( track, f, key );
+                
+                keys.push_back( key );
+                key_frames.push_back( (u16)f );
+            }
+        }
+    }
+    
+    joint_keys[joint_count] = (u32)keys.size();
+    
+    if( keys.empty() )
+        return nullptr;
+    
+    AnimationClip* out = Allocate( clip.m_skeleton_joint_count, clip.m_animated_joint_count, frame_count, clip.m_event_count, (u32)keys.size() );
+    
+    out->m_name = clip.m_name;
+    out->m_frames_per_ms = clip.m_frames_per_ms;
+    out->m_traits = clip.m_traits;
+    out->m_translation_joint = clip.m_translation_joint;
+    
+    memcpy( out->m_joint_remap, clip.m_joint_remap, (size_t)clip.m_skeleton_joint_count * sizeof(s16) );
+    
+    if( clip.m_event_count > 0 )
+        memcpy( out->m_events, clip.m_events, clip.m_event_count * sizeof(AnimationClip::Event) );
+    
+    memcpy( out->m_curve_keys, &keys[0], keys.size() * sizeof(AnimationClip::CurveKey) );
+    memcpy( out->m_curve_key_frames, &key_frames[0], key_frames.size() * sizeof(u16) );
+    memcpy( out->m_curve_joint_keys, &joint_keys[0], joint_keys.size() * sizeof(u32) );
+    
+    return out;
+}
+
+//---------------------------------------------------------------------------------------
+
+ClipCookResult::Enum AnimClipCooker::Cook( const char* source_path, const char* output_path, const ClipCookSettings& settings )
+{
+    AnimationClip* clip = Load( source_path );
+    
+    if( !clip )
+        return ClipCookResult::ReadFailed;
+    
+    if( !Validate( *clip ) )
+    {
+        Free( clip );
+        return ClipCookResult::InvalidClip;
+    }
+    
+    // additive baking and resampling work on dense frames.
+    if( clip->HasCurves() && (settings.reference || settings.frames_per_second > 0.f) )
+    {
+        AnimationClip* decoded = Decode( *clip );
+        Free( clip );
+        clip = decoded;
+    }
+    
+    // additive is baked at source frame rate, so whole-clip reference matches frame by frame.
+    if( settings.reference )
+    {
+        bool baked = Validate( *settings.reference );
+        
+        if( baked )
+        {
+            if( settings.reference_frame >= 0 )
+                baked = MakeAdditive( *clip, *settings.reference, (u32)settings.reference_frame );
+            else
+                baked = (*clip -= *settings.reference);
+        }
+        
+        if( !baked )
+        {
+            Free( clip );
+            return ClipCookResult::ReferenceMismatch;
+        }
+    }
+    
+    if( settings.frames_per_second > 0.f && settings.frames_per_second * 0.001f != clip->m_frames_per_ms )
+    {
+        AnimationClip* resampled = Resample( *clip, settings.frames_per_second, settings.looped );
+        Free( clip );
+        clip = resampled;
+    }
+    
+    // traits are detected on final frames (curve clips keep traits they were cooked with).
+    DetectTraits( *clip, settings.trait_epsilon );
+    
+    // curve fitting is the last step, it works on final frame data.
+    if( settings.curve_translation_error > 0.f && settings.curve_rotation_error > 0.f && !clip->HasCurves() )
+    {
+        AnimationClip* curves = FitCurves( *clip, settings.curve_translation_error, settings.curve_rotation_error );
+        
+        if( curves )
+        {
+            Free( clip );
+            clip = curves;
+        }
+    }
+    
+    bool saved = Save( *clip, output_path );
+    Free( clip );
+    
+    return saved ? ClipCookResult::Ok : ClipCookResult::WriteFailed;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimClipCooker::CookBatch( ClipCookJob* jobs, u32 job_count, const ClipCookSettings& settings, AnimWorkerPool& pool )
+{
+    // clips differ in size a lot, single clip batches keep workers evenly loaded.
+    pool.ParallelFor( job_count, 1, [&]( u32 begin, u32 end, u32 worker )
+    {
+        for( u32 i = begin; i < end; ++i )
+        {
+            ANIM_TRACE_SCOPE( "CookClip", worker, i );
+            jobs[i].result = Cook( jobs[i].source_path, jobs[i].output_path, settings );
+        }
+    });
+}
+
+//---------------------------------------------------------------------------------------
+
+const char* AnimClipCooker::GetResultName( ClipCookResult::Enum result )
+{
+    static const char* s_names[ClipCookResult::Count] = {
+        "ok",
+        "read failed",
+        "invalid clip",
+        "reference mismatch",
+        "write failed"
+    };
+    
+    return result < ClipCookResult::Count ? s_names[result] : "unknown";
+}
+
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/animation/AnimationClip.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class AnimWorkerPool;
+
+// enumerates results of cooking a single clip.
+namespace ClipCookResult{
+    enum Enum{
+        Ok,
+        ReadFailed,
+        InvalidClip,
+        ReferenceMismatch,
+        WriteFailed,
+        Count
+    };
+}
+
+//---------------------------------------------------------------------------------------
+
+// options shared by all clips of a batch.
+struct ClipCookSettings
+{
+    ClipCookSettings();
+    
+    // output frame rate. 0 keeps source frame rate.
+    float frames_per_second;
+    
+    // clips are played looped, resampling preserves looped duration instead of first to last frame span.
+    bool looped;
+    
+    // clips are baked as additive against this clip (null for non-additive output).
+    const AnimationClip* reference;
+    
+    // reference frame used for every frame of the source clip. -1 subtracts reference clip frame by frame.
+    s32 reference_frame;
+    
+    // maximum translation/scale error and rotation error (radians) of fitted curves.
+    // clips are written as dense frames if any of them is 0.
+    float curve_translation_error;
+    float curve_rotation_error;
+    
+    // maximum deviation of a channel treated as constant by clip traits.
+    float trait_epsilon;
+};
+
+//---------------------------------------------------------------------------------------
+
+// single clip to cook.
+struct ClipCookJob
+{
+    // source clip binary.
+    const char* source_path;
+    
+    // cooked clip binary.
+    const char* output_path;
+    
+    // filled by CookBatch.
+    ClipCookResult::Enum result;
+};
+
+//---------------------------------------------------------------------------------------
+
+// offline clip processing used by content build. clips are kept in the same relocatable
+// format runtime loads (header followed by data, pointers stored as offsets).
+class AnimClipCooker
+{
+public:
+    // loads relocatable clip binary. returned clip has fixed pointers and must be released with Free.
+    static AnimationClip* Load( const char* path );
+    
+    // writes clip as relocatable binary.
+    static bool Save( const AnimationClip& clip, const char* path );
+    
+    // allocates clip with all arrays in a single block. arrays are left uninitialized.
+    // clip stores curves instead of dense frames if curve_key_count > 0.
+    static AnimationClip* Allocate( s16 skeleton_joint_count, s16 animated_joint_count, u32 frame_count, u32 event_count, u32 curve_key_count );
+    
+    static void Free( AnimationClip* clip );
+    
+    // size of clip block (header + arrays).
+    static size_t GetDataSize( const AnimationClip& clip );
+    
+    // checks joint remap table and array sizes. returns false if runtime would read out of bounds.
+    static bool Validate( const AnimationClip& clip );
+    
+    // fits hermite curves to dense clip, keeping the minimal set of keys (greedy split at the
+    // worst frame) under error bounds. returns null for curve clips.
+    static AnimationClip* FitCurves( const AnimationClip& clip, float translation_error, float rotation_error );
+    
+    // converts curve clip to dense frames.
+    static AnimationClip* Decode( const AnimationClip& clip );
+    
+    // resamples clip to a new frame rate. duration of given playback mode is preserved (looped clips wrap
+    // the last interval back to frame 0), events past the other mode's duration are clamped to it.
+    // returns null for curve clips.
+    static AnimationClip* Resample( const AnimationClip& clip, float frames_per_second, bool looped );
+    
+    // detects ClipTraits of dense clip (channels constant within epsilon). additive flag has to be set already.
+    static void DetectTraits( AnimationClip& clip, float epsilon );
+    
+    // bakes clip as additive (clip - reference) against a single reference frame. dense clips only.
+    static bool MakeAdditive( AnimationClip& clip, const AnimationClip& reference, u32 reference_frame );
+    
+    // loads, processes and writes single clip.
+    static ClipCookResult::Enum Cook( const char* source_path, const char* output_path, const ClipCookSettings& settings );
+    
+    // cooks all jobs spread across pool workers (one clip per batch).
+    static void CookBatch( ClipCookJob* jobs, u32 job_count, const ClipCookSettings& settings, AnimWorkerPool& pool );
+    
+    static const char* GetResultName( ClipCookResult::Enum result );
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/core/StringId.h"
+#include "engine/core/ObjectArray.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class AnimStates;
+class AnimationClip;
+
+// enumerates externally driven animation calls (recorded and replayed by AnimRecorder/AnimReplay).
+namespace AnimCommandType{
+    enum Enum{
+        CreateController,
+        DestroyController,
+        SetStateData,
+        Play,
+        Transition,
+        Stop,
+        Pause,
+        Resume,
+        SetNodeFactor,
+        SetBlendFactor,
+        SetLayerType,
+        Update,
+        // appended, so ids of older logs stay valid.
+        PlayClip,
+        Count
+    };
+}
+
+//---------------------------------------------------------------------------------------
+
+// layer call queued in AnimCommandBuffer.
+struct AnimCommand
+{
+    Handle controller;
+
+    // command buffer index and position within the buffer. commands of a controller are applied in this order.
+    u32 sequence;
+    u16 buffer;
+
+    u16 layer;
+
+    AnimCommandType::Enum type;
+
+    // state, transition or node factor name.
+    StringId name;
+
+    // blend time or factor value.
+    float value;
+
+    // SetLayerType layer type.
+    u32 layer_type;
+
+    // SetStateData state data.
+    AnimStates* state_data;
+    
+    // PlayClip clip, local start time and looping.
+    AnimationClip* clip;
+    float time_ms;
+    bool looped;
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
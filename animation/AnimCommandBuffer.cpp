@@ -0,0 +1,155 @@
+#include "engine/animation/AnimCommandBuffer.h"
+#include <thread>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+AnimCommandBuffer::AnimCommandBuffer( u16 index )
+: m_write_side(0)
+, m_writing(false)
+, m_sequence(0)
+, m_index(index)
+{
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimCommand AnimCommandBuffer::MakeCommand( AnimCommandType::Enum type, Handle h, u16 layer )
+{
+    AnimCommand command;
+    command.controller = h;
+    command.sequence = m_sequence++;
+    command.buffer = m_index;
+    command.layer = layer;
+    command.type = type;
+    command.name = 0;
+    command.value = 0.f;
+    command.layer_type = 0;
+    command.state_data = nullptr;
+    command.clip = nullptr;
+    command.time_ms = 0.f;
+    command.looped = false;
+    
+    return command;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimCommandBuffer::Push( const AnimCommand& command )
+{
+    // writing flag is raised before the side is read, Flip waits for it after switching sides.
+    m_writing.store( true );
+    m_commands[m_write_side.load()].push_back( command );
+    m_writing.store( false );
+}
+
+//---------------------------------------------------------------------------------------
+
+std::vector<AnimCommand>& AnimCommandBuffer::Flip()
+{
+    u32 read_side = m_write_side.load();
+    m_write_side.store( read_side ^ 1 );
+    
+    // command being written may still target the old side.
+    while( m_writing.load() )
+        std::this_thread::yield();
+    
+    return m_commands[read_side];
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimCommandBuffer::SetStateData( Handle h, u16 layer, AnimStates* data )
+{
+    AnimCommand command = MakeCommand( AnimCommandType::SetStateData, h, layer );
+    command.state_data = data;
+    Push( command );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimCommandBuffer::Play( Handle h, u16 layer, StringId state_name, float blend_ms )
+{
+    AnimCommand command = MakeCommand( AnimCommandType::Play, h, layer );
+    command.name = state_name;
+    command.value = blend_ms;
+    Push( command );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimCommandBuffer::Transition( Handle h, u16 layer, StringId transition_name )
+{
+    AnimCommand command = MakeCommand( AnimCommandType::Transition, h, layer );
+    command.name = transition_name;
+    Push( command );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimCommandBuffer::Stop( Handle h, u16 layer )
+{
+    AnimCommand command = MakeCommand( AnimCommandType::Stop, h, layer );
+    Push( command );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimCommandBuffer::Pause( Handle h, u16 layer )
+{
+    AnimCommand command = MakeCommand( AnimCommandType::Pause, h, layer );
+    Push( command );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimCommandBuffer::Resume( Handle h, u16 layer )
+{
+    AnimCommand command = MakeCommand( AnimCommandType::Resume, h, layer );
+    Push( command );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimCommandBuffer::SetNodeFactor( Handle h, u16 layer, StringId factor_name, float value )
+{
+    AnimCommand command = MakeCommand( AnimCommandType::SetNodeFactor, h, layer );
+    command.name = factor_name;
+    command.value = value;
+    Push( command );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimCommandBuffer::SetBlendFactor( Handle h, u16 layer, float value )
+{
+    AnimCommand command = MakeCommand( AnimCommandType::SetBlendFactor, h, layer );
+    command.value = value;
+    Push( command );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimCommandBuffer::SetLayerType( Handle h, u16 layer, LayerType::Enum type )
+{
+    AnimCommand command = MakeCommand( AnimCommandType::SetLayerType, h, layer );
+    command.layer_type = (u32)type;
+    Push( command );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimCommandBuffer::PlayClip( Handle h, u16 layer, AnimationClip* clip, float local_time_ms, float blend_ms, bool looped )
+{
+    AnimCommand command = MakeCommand( AnimCommandType::PlayClip, h, layer );
+    command.clip = clip;
+    command.time_ms = local_time_ms;
+    command.value = blend_ms;
+    command.looped = looped;
+    Push( command );
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/animation/AnimCommand.h"
+#include "engine/animation/AnimLayer.h"
+#include <vector>
+#include <atomic>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// layer calls queued by a single thread and applied by AnimationSystem::Update. queueing does not lock and
+// may run concurrently with frame stages. every thread uses its own buffer (created by AnimationSystem).
+class AnimCommandBuffer
+{
+public:
+    AnimCommandBuffer( u16 index );
+    
+    void SetStateData( Handle h, u16 layer, AnimStates* data );
+    void Play( Handle h, u16 layer, StringId state_name, float blend_ms );
+    void Transition( Handle h, u16 layer, StringId transition_name );
+    void Stop( Handle h, u16 layer );
+    void Pause( Handle h, u16 layer );
+    void Resume( Handle h, u16 layer );
+    void SetNodeFactor( Handle h, u16 layer, StringId factor_name, float value );
+    void SetBlendFactor( Handle h, u16 layer, float value );
+    void SetLayerType( Handle h, u16 layer, LayerType::Enum type );
+    void PlayClip( Handle h, u16 layer, AnimationClip* clip, float local_time_ms, float blend_ms, bool looped );
+    
+    // index of buffer in owning system (orders commands of different buffers).
+    inline u16 GetIndex() const { return m_index; }
+    
+    friend class AnimationSystem;
+private:
+    // command with common fields set and empty payload.
+    AnimCommand MakeCommand( AnimCommandType::Enum type, Handle h, u16 layer );
+    
+    void Push( const AnimCommand& command );
+    
+    // switches writing to the other side and returns commands queued so far. called by the system only.
+    std::vector<AnimCommand>& Flip();
+    
+private:
+    // commands are written to one side while the system reads the other one.
+    std::vector<AnimCommand> m_commands[2];
+    
+    // side written by the owning thread.
+    std::atomic<u32> m_write_side;
+    
+    // set while a command is being written.
+    std::atomic<bool> m_writing;
+    
+    // position of the next command.
+    u32 m_sequence;
+    
+    u16 m_index;
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -1,103 +1,356 @@
-#include "engine/animation/AnimController.h"
-#include "engine/animation/Skeleton.h"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-
-AnimController::AnimController()
-: m_skeleton(nullptr)
-, m_hierarchy(nullptr)
-, m_skinning_palette(nullptr)
-, m_layers(nullptr)
-, m_layer_count(0)
-{
-    
-}
-    
-//---------------------------------------------------------------------------------------
-    
-void AnimController::Initialize(Skeleton *skeleton, u32 layer_count)
-{
-    m_skeleton = skeleton;
-    
-    m_layers = new AnimLayer[layer_count];
-    m_layer_count = layer_count;
-    
-    m_hierarchy = AnimHierarchy::CreateFromSkeleton(m_skeleton);
-    
-    m_skinning_palette = new Matrix4x4[m_skeleton->GetJointCount()];
-}
-    
-//---------------------------------------------------------------------------------------
-    
-void AnimController::Release()
-{
-    delete m_hierarchy;
-    
-    m_skeleton = nullptr;
-    
-    delete [] m_layers;
-    m_layer_count = 0;
-    
-    delete [] m_skinning_palette;
-    m_skinning_palette = nullptr;
-}
-    
-//---------------------------------------------------------------------------------------
-    
-void AnimController::Update( float delta_ms )
-{
-    for( u32 i = 0 ; i < m_layer_count; ++i )
-        m_layers[i].Update( delta_ms );
-}
-    
-//---------------------------------------------------------------------------------------
-    
-AnimLayer& AnimController::GetLayer( u16 index )
-{
-    ENGINE_ASSERT(index < m_layer_count, "layer out of bounds");
-    return m_layers[index];
-}
-    
-//---------------------------------------------------------------------------------------
-    
-void AnimController::GetJointPose( u16 joint_idx, AnimationClip::JointPose& output_pose )
-{
-    // layer 0 has to produce full skeletal pose. 
-    if( m_layer_count > 0 && m_layers[0].Active() )
-    {
-        m_layers[0].GetJointPose(joint_idx, output_pose);
-        
-        AnimationClip::JointPose layer_pose;
-        
-        // blend all other layers on top layer 0.
-        for( u32 i = 1; i < m_layer_count; ++i )
-        {
-            AnimLayer& layer = m_layers[i];
-            
-            if( layer.Active() )
-            {
-                bool layer_has_pose = layer.GetJointPose(joint_idx, layer_pose);
-                
-                if( layer_has_pose )
-                {
-                    switch( layer.GetType() )
-                    {
-                        case LayerType::Lerp:
-                            output_pose.MakeLerp(output_pose, layer_pose, layer.GetBlendFactor());
-                            break;
-                        case LayerType::Additive:
-                            output_pose.AdditiveAdd(layer_pose, layer.GetBlendFactor());
-                            break;
-                    }
-                }
-            }
-        }
-    }
-}
-    
-//---------------------------------------------------------------------------------------
-}; //namespace Engine
-//---------------------------------------------------------------------------------------
-
+#include "engine/animation/AnimController.h"
+#include "engine/animation/Skeleton.h"
+#include <string.h>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+AnimController::AnimController()
+: m_skeleton(nullptr)
+, m_hierarchy(nullptr)
+, m_skinning_palette(nullptr)
+, m_owns_palette(false)
+, m_output_palette(nullptr)
+, m_palette_offset((u32)-1)
+, m_target_palette(nullptr)
+, m_target_offset((u32)-1)
+, m_back_palette(nullptr)
+, m_handle((Handle)-1)
+, m_budget_bytes(0)
+, m_budget_states(nullptr)
+, m_recorder(nullptr)
+, m_events(nullptr)
+, m_prune_epsilon(0.f)
+, m_baking_allowed(true)
+, m_baked(nullptr)
+, m_baked_time(0.f)
+, m_sleeping(false)
+, m_static(false)
+, m_layers(nullptr)
+, m_layer_count(0)
+{
+    
+}
+    
+//---------------------------------------------------------------------------------------
+    
+void AnimController::Initialize(Skeleton *skeleton, u32 layer_count)
+{
+    m_skeleton = skeleton;
+    
+    m_layers = new AnimLayer[layer_count];
+    m_layer_count = layer_count;
+    
+    m_budget_states = new const AnimStates*[layer_count];
+    memset( m_budget_states, 0, layer_count * sizeof(const AnimStates*) );
+    
+    m_hierarchy = AnimHierarchy::CreateFromSkeleton(m_skeleton);
+    
+    m_skinning_palette = new Matrix4x4[m_skeleton->GetJointCount()];
+    m_owns_palette = true;
+    
+    m_output_palette = m_skinning_palette;
+    m_palette_offset = (u32)-1;
+    
+    m_target_palette = m_skinning_palette;
+    m_target_offset = (u32)-1;
+    
+    m_events = new AnimEventBuffer();
+    
+    m_sleeping = false;
+    m_static = false;
+}
+    
+//---------------------------------------------------------------------------------------
+    
+void AnimController::Release()
+{
+    delete m_hierarchy;
+    
+    m_skeleton = nullptr;
+    m_recorder = nullptr;
+    
+    delete [] m_layers;
+    m_layer_count = 0;
+    
+    delete [] m_budget_states;
+    m_budget_states = nullptr;
+    m_budget_bytes = 0;
+    
+    if( m_owns_palette )
+        delete [] m_skinning_palette;
+    
+    m_skinning_palette = nullptr;
+    m_owns_palette = false;
+    
+    delete [] m_back_palette;
+    m_back_palette = nullptr;
+    
+    m_output_palette = nullptr;
+    m_palette_offset = (u32)-1;
+    
+    m_target_palette = nullptr;
+    m_target_offset = (u32)-1;
+    
+    delete m_events;
+    m_events = nullptr;
+    
+    m_baked = nullptr;
+}
+    
+//---------------------------------------------------------------------------------------
+    
+void AnimController::SetHandle( Handle h )
+{
+    m_handle = h;
+    
+    for( u32 i = 0; i < m_layer_count; ++i )
+        m_layers[i].SetOwner( h, (u16)i );
+}
+    
+//---------------------------------------------------------------------------------------
+    
+void AnimController::SetRecorder( AnimRecorder* recorder )
+{
+    m_recorder = recorder;
+    
+    for( u32 i = 0; i < m_layer_count; ++i )
+        m_layers[i].SetRecorder( recorder );
+}
+    
+//---------------------------------------------------------------------------------------
+    
+void AnimController::Update( float delta_ms )
+{
+    m_events->Clear();
+    
+    for( u32 i = 0 ; i < m_layer_count; ++i )
+        m_layers[i].Update( delta_ms, m_events );
+    
+    m_static = IsStatic();
+    
+    // static controller falls asleep with the next update, so layer calls made before it have to wake it too.
+    if( m_static )
+    {
+        for( u32 i = 0; i < m_layer_count; ++i )
+            m_layers[i].SetSleeping( true );
+    }
+}
+    
+//---------------------------------------------------------------------------------------
+    
+AnimLayer& AnimController::GetLayer( u16 index )
+{
+    ENGINE_ASSERT(index < m_layer_count, "layer out of bounds");
+    return m_layers[index];
+}
+    
+//---------------------------------------------------------------------------------------
+    
+void AnimController::UpdateWeights( float epsilon )
+{
+    m_prune_epsilon = epsilon;
+    
+    for( u32 i = 0; i < m_layer_count; ++i )
+    {
+        AnimLayer& layer = m_layers[i];
+        
+        // layer 0 always produces full pose.
+        if( layer.Active() )
+            layer.UpdateWeights( i == 0 ? 1.f : layer.GetBlendFactor(), epsilon );
+    }
+}
+    
+//---------------------------------------------------------------------------------------
+    
+void AnimController::GetJointPose( u16 joint_idx, AnimationClip::JointPose& output_pose )
+{
+    // layer 0 has to produce full skeletal pose. 
+    if( m_layer_count > 0 && m_layers[0].Active() )
+    {
+        u32 traits = 0;
+        m_layers[0].GetJointPose(joint_idx, *m_skeleton, output_pose, traits);
+        
+        AnimationClip::JointPose layer_pose;
+        u32 layer_traits = 0;
+        
+        // blend all other layers on top layer 0.
+        for( u32 i = 1; i < m_layer_count; ++i )
+        {
+            AnimLayer& layer = m_layers[i];
+            
+            if( layer.Active() && layer.GetBlendFactor() <= m_prune_epsilon )
+            {
+                ANIM_STAT_ADD(pruned_evaluations, 1);
+            }
+            else if( layer.Active() )
+            {
+                bool layer_has_pose = layer.GetJointPose(joint_idx, *m_skeleton, layer_pose, layer_traits);
+                
+                if( layer_has_pose )
+                {
+                    switch( layer.GetType() )
+                    {
+                        case LayerType::Lerp:
+                            // channels shared by both poses stay shared by the blend.
+                            traits &= layer_traits;
+                            output_pose.MakeLerp(output_pose, layer_pose, layer.GetBlendFactor(), traits);
+                            break;
+                        case LayerType::Additive:
+                            // layer traits mark identity channels of the additive pose. only those channels are
+                            // left unchanged, so output keeps its traits for them and loses the others.
+                            output_pose.AdditiveAdd(layer_pose, layer.GetBlendFactor(), layer_traits);
+                            traits &= layer_traits & ClipTraits::BlendMask;
+                            break;
+                    }
+                }
+            }
+        }
+    }
+}
+    
+//---------------------------------------------------------------------------------------
+
+bool AnimController::GetBakeableClip( const AnimationClip*& clip, float& local_time_ms )
+{
+    if( !m_baking_allowed || m_layer_count == 0 || !m_layers[0].Active() )
+        return false;
+    
+    // layers on top would change the pose.
+    for( u32 i = 1; i < m_layer_count; ++i )
+    {
+        if( m_layers[i].Active() )
+            return false;
+    }
+    
+    const Animation* animation = m_layers[0].GetSingleAnimation();
+    
+    // baked palettes are keyed by clip, mirrored pose is not baked.
+    if( !animation || !animation->IsLooped() || animation->IsMirrored() )
+        return false;
+    
+    clip = animation->GetClip();
+    local_time_ms = animation->GetLocalAnimationTime( m_layers[0].GetClock() );
+    
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimController::Relocate( AnimTransformation* nodes, Matrix4x4* palette )
+{
+    m_hierarchy->Relocate( nodes );
+    
+    memcpy( palette, m_skinning_palette, m_skeleton->GetJointCount() * sizeof(Matrix4x4) );
+    
+    if( m_output_palette == m_skinning_palette )
+        m_output_palette = palette;
+    
+    if( m_target_palette == m_skinning_palette )
+        m_target_palette = palette;
+    
+    if( m_owns_palette )
+        delete [] m_skinning_palette;
+    
+    m_skinning_palette = palette;
+    m_owns_palette = false;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimController::SetWakeList( AnimWakeList* wake_list )
+{
+    for( u32 i = 0; i < m_layer_count; ++i )
+        m_layers[i].SetWakeList( wake_list );
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimController::IsStatic()
+{
+    for( u32 i = 0; i < m_layer_count; ++i )
+    {
+        if( !m_layers[i].IsStatic() )
+            return false;
+    }
+    
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+Matrix4x4* AnimController::GetOwnPalette( bool pipelined )
+{
+    if( !pipelined || m_output_palette != m_skinning_palette )
+        return m_skinning_palette;
+    
+    if( !m_back_palette )
+        m_back_palette = new Matrix4x4[m_skeleton->GetJointCount()];
+    
+    return m_back_palette;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimController::Sleep( bool pipelined )
+{
+    // palette buffer regions are reused by later frames.
+    if( m_output_palette != m_skinning_palette && m_output_palette != m_back_palette )
+    {
+        Matrix4x4* palette = GetOwnPalette( pipelined );
+        memcpy( palette, m_output_palette, m_skeleton->GetJointCount() * sizeof(Matrix4x4) );
+        SetTargetPalette( palette, (u32)-1, !pipelined );
+    }
+    
+    // events of the last update are not fired again.
+    m_events->Clear();
+    
+    m_sleeping = true;
+    
+    for( u32 i = 0; i < m_layer_count; ++i )
+        m_layers[i].SetSleeping( true );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimController::Wake()
+{
+    m_sleeping = false;
+    m_static = false;
+    
+    for( u32 i = 0; i < m_layer_count; ++i )
+        m_layers[i].SetSleeping( false );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimController::GetMemoryUsage( AnimControllerMemory& memory ) const
+{
+    memory.Reset();
+    memory.handle = m_handle;
+    
+    memory.layers = sizeof(AnimController) + m_layer_count * sizeof(AnimLayer);
+    
+    for( u32 i = 0; i < m_layer_count; ++i )
+        memory.trees += m_layers[i].GetTreeMemoryUsage();
+    
+    if( m_hierarchy )
+        memory.hierarchy = m_hierarchy->GetMemoryUsage();
+    
+    if( m_skinning_palette )
+        memory.palette = m_skeleton->GetJointCount() * sizeof(Matrix4x4);
+    
+    if( m_back_palette )
+        memory.palette += m_skeleton->GetJointCount() * sizeof(Matrix4x4);
+    
+    if( m_events )
+        memory.events = m_events->GetMemoryUsage();
+    
+    memory.total = memory.layers + memory.trees + memory.hierarchy + memory.palette + memory.events;
+}
+    
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
+
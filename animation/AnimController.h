@@ -1,88 +1,249 @@
-#pragma once
-
-#include "engine/core/Types.h"
-#include "engine/core/StringId.h"
-#include "engine/core/ObjectArray.h"
-#include "engine/math/Matrix4x4.h"
-#include "engine/animation/AnimationClip.h"
-#include "engine/animation/AnimLayer.h"
-#include "engine/animation/AnimHierarchy.h"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-    
-class Skeleton;
-
-class AnimController : public IObject
-{
-public:
-    AnimController();
-    
-    // creates hierarchy and allocates matrix palette based on skeleton.
-    void Initialize( Skeleton* skeleton, u32 layer_count );
-    
-    // destroys hierarchy and matrix palette.
-    void Release();
-    
-    // updates all the layers.
-    void Update( float delta_ms );
-    
-    // layer accessor.
-    AnimLayer& GetLayer( u16 index );
-    
-    // skeleton getter.
-    inline Skeleton* GetSkeleton();
-    
-    // hierarchy getter.
-    inline AnimHierarchy* GetHierarchy();
-    
-    // skinning palette getter.
-    inline Matrix4x4* GetSkinningPalette();
-    
-    // extracts a pose for a given joint in its current animation state.
-    void GetJointPose( u16 joint_idx, AnimationClip::JointPose& pose );
-    
-private:
-    // single animation layer supported now.
-    AnimLayer* m_layers;
-    
-    // number of layers in controller.
-    u32 m_layer_count;
-    
-    // animation skeleton.
-    Skeleton* m_skeleton;
-    
-    // local/global animation hierarchy.
-    AnimHierarchy* m_hierarchy;
-    
-    // skinning matrix palette used in shader. may be changed to dual quaternion representation in the future.
-    Matrix4x4* m_skinning_palette;
-};
-    
-//---------------------------------------------------------------------------------------
-    
-inline Skeleton* AnimController::GetSkeleton()
-{
-    return m_skeleton;
-}
-
-//---------------------------------------------------------------------------------------
-
-inline AnimHierarchy* AnimController::GetHierarchy()
-{
-    return m_hierarchy;
-}
-
-//---------------------------------------------------------------------------------------
-
-inline Matrix4x4* AnimController::GetSkinningPalette()
-{
-    return m_skinning_palette;
-}
-
-//---------------------------------------------------------------------------------------
-} // namespace Engine
-//---------------------------------------------------------------------------------------
-
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/core/StringId.h"
+#include "engine/core/ObjectArray.h"
+#include "engine/math/Matrix4x4.h"
+#include "engine/animation/AnimationClip.h"
+#include "engine/animation/AnimLayer.h"
+#include "engine/animation/AnimHierarchy.h"
+#include "engine/animation/AnimMemory.h"
+#include "engine/animation/AnimPaletteCache.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+    
+class Skeleton;
+class AnimRecorder;
+
+class AnimController : public IObject
+{
+public:
+    AnimController();
+    
+    // creates hierarchy and allocates matrix palette based on skeleton.
+    void Initialize( Skeleton* skeleton, u32 layer_count );
+    
+    // destroys hierarchy and matrix palette.
+    void Release();
+    
+    // updates all the layers.
+    void Update( float delta_ms );
+    
+    // clip events fired during the last update.
+    inline const AnimEventBuffer& GetEvents() const { return *m_events; }
+    
+    // layer accessor.
+    AnimLayer& GetLayer( u16 index );
+    
+    // number of layers in controller.
+    inline u32 GetLayerCount() const { return m_layer_count; }
+    
+    // skeleton getter.
+    inline Skeleton* GetSkeleton();
+    
+    // hierarchy getter.
+    inline AnimHierarchy* GetHierarchy();
+    
+    // skinning palette getter. points into AnimPaletteBuffer if the last palette pass used one.
+    inline Matrix4x4* GetSkinningPalette();
+    
+    // byte offset of the skinning palette in AnimPaletteBuffer. -1 if controller's own palette is used.
+    inline u32 GetPaletteOffset() const;
+    
+    // handle of the controller in AnimationSystem.
+    inline Handle GetHandle() const;
+    
+    // recorder of externally driven calls (null if not recording).
+    inline AnimRecorder* GetRecorder() const { return m_recorder; }
+    
+    // propagates layer and blend tree weights. layers and subtrees with weight <= epsilon
+    // are skipped by GetJointPose until next call. called once per frame.
+    void UpdateWeights( float epsilon );
+    
+    // extracts a pose for a given joint in its current animation state.
+    void GetJointPose( u16 joint_idx, AnimationClip::JointPose& pose );
+    
+    // memory owned by the controller (shared skeleton and state data are not included).
+    void GetMemoryUsage( AnimControllerMemory& memory ) const;
+    
+    // controllers allowed to bake (default) use cached palettes while they play a single looped
+    // clip on layer 0 with no other active layers (if enabled in AnimationSystem).
+    inline void SetBakingAllowed( bool allowed ) { m_baking_allowed = allowed; }
+    
+    inline bool IsBakingAllowed() const { return m_baking_allowed; }
+    
+    // true if palette comes from palette cache this frame (hierarchy is not updated then).
+    inline bool IsBaked() const { return m_baked != nullptr; }
+    
+    // sleeping controllers are not updated or evaluated and keep their last palette. they wake on any layer call
+    // changing their state.
+    inline bool IsSleeping() const { return m_sleeping; }
+    
+    friend class AnimationSystem;
+private:
+    // sets published skinning palette.
+    inline void SetOutputPalette( Matrix4x4* palette, u32 offset );
+    
+    // sets palette written by the palette generation pass. it becomes the skinning palette immediately if
+    // publish is set, otherwise with PublishPalette at the end of pipelined frame.
+    inline void SetTargetPalette( Matrix4x4* palette, u32 offset, bool publish );
+    
+    inline Matrix4x4* GetTargetPalette() { return m_target_palette; }
+    
+    inline void PublishPalette() { SetOutputPalette( m_target_palette, m_target_offset ); }
+    
+    // own palette the palette generation pass writes to. pipelined frames alternate between two own
+    // palettes (second one allocated on first use), so the published palette is not overwritten.
+    Matrix4x4* GetOwnPalette( bool pipelined );
+    
+    // sets controller handle, passed down to the layers.
+    void SetHandle( Handle h );
+    
+    // sets recorder of layer calls, passed down to the layers.
+    void SetRecorder( AnimRecorder* recorder );
+    
+    // returns clip and its local time if controller can use baked palettes.
+    bool GetBakeableClip( const AnimationClip*& clip, float& local_time_ms );
+    
+    // moves hierarchy nodes and skinning palette to memory owned by AnimationSystem (joint count entries each).
+    void Relocate( AnimTransformation* nodes, Matrix4x4* palette );
+    
+    // sets wake list of sleeping controller, passed down to the layers.
+    void SetWakeList( AnimWakeList* wake_list );
+    
+    // true if no layer pose changes with time.
+    bool IsStatic();
+    
+    // keeps last palette in controller's own palette and stops updates until Wake.
+    // palette is published at the end of the frame if pipelined.
+    void Sleep( bool pipelined );
+    
+    void Wake();
+    
+private:
+    // single animation layer supported now.
+    AnimLayer* m_layers;
+    
+    // number of layers in controller.
+    u32 m_layer_count;
+    
+    // animation skeleton.
+    Skeleton* m_skeleton;
+    
+    // local/global animation hierarchy.
+    AnimHierarchy* m_hierarchy;
+    
+    // skinning matrix palette used in shader. may be changed to dual quaternion representation in the future.
+    Matrix4x4* m_skinning_palette;
+    
+    // m_skinning_palette was allocated by the controller (not relocated).
+    bool m_owns_palette;
+    
+    // palette written by the last palette generation pass (m_skinning_palette or external buffer memory).
+    Matrix4x4* m_output_palette;
+    
+    // byte offset of m_output_palette in external palette buffer.
+    u32 m_palette_offset;
+    
+    // palette written by the last palette generation pass and its offset (published as m_output_palette).
+    Matrix4x4* m_target_palette;
+    u32 m_target_offset;
+    
+    // second own palette used by pipelined frames (null until needed).
+    Matrix4x4* m_back_palette;
+    
+    // controller handle in AnimationSystem.
+    Handle m_handle;
+    
+    // bytes counted in AnimationSystem instance memory total (measured on creation and budget checks).
+    size_t m_budget_bytes;
+    
+    // per-layer state data counted in AnimationSystem asset memory total.
+    const AnimStates** m_budget_states;
+    
+    // records layer calls if set.
+    AnimRecorder* m_recorder;
+    
+    // clip events fired during the last update.
+    AnimEventBuffer* m_events;
+    
+    // layers with blend factor <= epsilon are not evaluated.
+    float m_prune_epsilon;
+    
+    // controller may use baked palettes.
+    bool m_baking_allowed;
+    
+    // palette cache entry used this frame (null if palettes are generated).
+    const AnimPaletteCache::Entry* m_baked;
+    
+    // clip local time of baked palette.
+    float m_baked_time;
+    
+    // controller is not updated or evaluated.
+    bool m_sleeping;
+    
+    // pose did not change with the last update, controller falls asleep with the next one.
+    bool m_static;
+};
+    
+//---------------------------------------------------------------------------------------
+    
+inline Skeleton* AnimController::GetSkeleton()
+{
+    return m_skeleton;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline AnimHierarchy* AnimController::GetHierarchy()
+{
+    return m_hierarchy;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline Matrix4x4* AnimController::GetSkinningPalette()
+{
+    return m_output_palette;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline u32 AnimController::GetPaletteOffset() const
+{
+    return m_palette_offset;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline Handle AnimController::GetHandle() const
+{
+    return m_handle;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline void AnimController::SetOutputPalette( Matrix4x4* palette, u32 offset )
+{
+    m_output_palette = palette;
+    m_palette_offset = offset;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline void AnimController::SetTargetPalette( Matrix4x4* palette, u32 offset, bool publish )
+{
+    m_target_palette = palette;
+    m_target_offset = offset;
+    
+    if( publish )
+        SetOutputPalette( palette, offset );
+}
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
+
 //---------------------------------------------------------------------------------------
\ No newline at end of file
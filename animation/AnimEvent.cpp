@@ -0,0 +1,41 @@
+#include "engine/animation/AnimEvent.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+AnimEventBuffer::AnimEventBuffer()
+: m_events(nullptr)
+, m_count(0)
+, m_capacity(0)
+{
+
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimEventBuffer::~AnimEventBuffer()
+{
+    delete [] m_events;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimEventBuffer::Grow()
+{
+    u32 capacity = m_capacity > 0 ? m_capacity * 2 : 8;
+
+    AnimEvent* events = new AnimEvent[capacity];
+
+    for( u32 i = 0; i < m_count; ++i )
+        events[i] = m_events[i];
+
+    delete [] m_events;
+
+    m_events = events;
+    m_capacity = capacity;
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
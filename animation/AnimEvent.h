@@ -0,0 +1,67 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/core/StringId.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// clip event fired during the last update.
+struct AnimEvent
+{
+    // event name (i.e. footstep, hit frame).
+    StringId name;
+
+    // event time within the clip in milliseconds.
+    float time_ms;
+
+    // weight of the tree playing the clip (layer blend factor * cross-fade weight).
+    float weight;
+
+    // layer the event was fired on.
+    u16 layer;
+};
+
+//---------------------------------------------------------------------------------------
+
+// events fired by a controller during a single update.
+class AnimEventBuffer
+{
+public:
+    AnimEventBuffer();
+    ~AnimEventBuffer();
+
+    inline void Clear() { m_count = 0; }
+
+    inline void Add( const AnimEvent& e );
+
+    inline u32 GetCount() const { return m_count; }
+
+    inline const AnimEvent& Get( u32 idx ) const { ENGINE_ASSERT(idx < m_count, "event out of bounds"); return m_events[idx]; }
+
+    // bytes of buffer object and its (capacity sized) event array.
+    inline size_t GetMemoryUsage() const { return sizeof(AnimEventBuffer) + m_capacity * sizeof(AnimEvent); }
+
+private:
+    void Grow();
+
+private:
+    AnimEvent* m_events;
+    u32 m_count;
+    u32 m_capacity;
+};
+
+//---------------------------------------------------------------------------------------
+
+inline void AnimEventBuffer::Add( const AnimEvent& e )
+{
+    if( m_count == m_capacity )
+        Grow();
+
+    m_events[m_count++] = e;
+}
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,286 @@
+#include "engine/animation/AnimInstanceBatch.h"
+#include "engine/animation/AnimHierarchy.h"
+#include "engine/animation/Skeleton.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <xmmintrin.h>
+    #define ANIM_INSTANCE_BATCH_SSE 1
+#endif
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// lane operations. layout code below is shared by SSE and scalar builds.
+#if ANIM_INSTANCE_BATCH_SSE
+static_assert( AnimInstanceBatch::Lanes == 4, "SSE lanes hold 4 floats" );
+
+typedef __m128 LaneFloat;
+
+static inline LaneFloat LaneLoad( const float* p ) { return _mm_loadu_ps( p ); }
+static inline void LaneStore( float* p, LaneFloat v ) { _mm_storeu_ps( p, v ); }
+static inline LaneFloat LaneSet( float f ) { return _mm_set1_ps( f ); }
+static inline LaneFloat LaneAdd( LaneFloat a, LaneFloat b ) { return _mm_add_ps( a, b ); }
+static inline LaneFloat LaneMul( LaneFloat a, LaneFloat b ) { return _mm_mul_ps( a, b ); }
+#else
+struct LaneFloat
+{
+    float v[AnimInstanceBatch::Lanes];
+};
+
+static inline LaneFloat LaneLoad( const float* p ) { LaneFloat r; for( u32 l = 0; l < AnimInstanceBatch::Lanes; ++l ) r.v[l] = p[l]; return r; }
+static inline void LaneStore( float* p, const LaneFloat& v ) { for( u32 l = 0; l < AnimInstanceBatch::Lanes; ++l ) p[l] = v.v[l]; }
+static inline LaneFloat LaneSet( float f ) { LaneFloat r; for( u32 l = 0; l < AnimInstanceBatch::Lanes; ++l ) r.v[l] = f; return r; }
+static inline LaneFloat LaneAdd( const LaneFloat& a, const LaneFloat& b ) { LaneFloat r; for( u32 l = 0; l < AnimInstanceBatch::Lanes; ++l ) r.v[l] = a.v[l] + b.v[l]; return r; }
+static inline LaneFloat LaneMul( const LaneFloat& a, const LaneFloat& b ) { LaneFloat r; for( u32 l = 0; l < AnimInstanceBatch::Lanes; ++l ) r.v[l] = a.v[l] * b.v[l]; return r; }
+#endif
+
+static const u32 LaneStride = AnimInstanceBatch::Lanes;
+static const u32 JointStride = 12 * AnimInstanceBatch::Lanes;
+
+//---------------------------------------------------------------------------------------
+
+// transposes top three rows of lane matrices into AoSoA joint block.
+static inline void GatherLanes( const Matrix4x4* const* m, float* out )
+{
+#if ANIM_INSTANCE_BATCH_SSE
+    for( u32 r = 0; r < 3; ++r )
+    {
+        __m128 r0 = _mm_loadu_ps( m[0]->matrix + 4 * r );
+        __m128 r1 = _mm_loadu_ps( m[1]->matrix + 4 * r );
+        __m128 r2 = _mm_loadu_ps( m[2]->matrix + 4 * r );
+        __m128 r3 = _mm_loadu_ps( m[3]->matrix + 4 * r );
+        _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+
+        _mm_storeu_ps( out + (4 * r + 0) * LaneStride, r0 );
+        _mm_storeu_ps( out + (4 * r + 1) * LaneStride, r1 );
+        _mm_storeu_ps( out + (4 * r + 2) * LaneStride, r2 );
+        _mm_storeu_ps( out + (4 * r + 3) * LaneStride, r3 );
+    }
+#else
+    for( u32 e = 0; e < 12; ++e )
+    {
+        for( u32 l = 0; l < AnimInstanceBatch::Lanes; ++l )
+            out[e * LaneStride + l] = m[l]->matrix[e];
+    }
+#endif
+}
+
+//---------------------------------------------------------------------------------------
+
+// writes AoSoA joint block back to the first count lane matrices.
+static inline void ScatterLanes( const float* in, Matrix4x4* const* m, u32 count )
+{
+#if ANIM_INSTANCE_BATCH_SSE
+    for( u32 r = 0; r < 3; ++r )
+    {
+        __m128 c0 = _mm_loadu_ps( in + (4 * r + 0) * LaneStride );
+        __m128 c1 = _mm_loadu_ps( in + (4 * r + 1) * LaneStride );
+        __m128 c2 = _mm_loadu_ps( in + (4 * r + 2) * LaneStride );
+        __m128 c3 = _mm_loadu_ps( in + (4 * r + 3) * LaneStride );
+        _MM_TRANSPOSE4_PS( c0, c1, c2, c3 );
+
+        const __m128 rows[4] = { c0, c1, c2, c3 };
+
+        for( u32 l = 0; l < count; ++l )
+            _mm_storeu_ps( m[l]->matrix + 4 * r, rows[l] );
+    }
+#else
+    for( u32 e = 0; e < 12; ++e )
+    {
+        for( u32 l = 0; l < count; ++l )
+            m[l]->matrix[e] = in[e * LaneStride + l];
+    }
+#endif
+
+    for( u32 l = 0; l < count; ++l )
+    {
+        float* bottom = m[l]->matrix + 12;
+        bottom[0] = bottom[1] = bottom[2] = 0.f;
+        bottom[3] = 1.f;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+// c = a * b for every lane (affine, row-major with translation in the last column).
+static inline void MultiplyLanes( const float* a, const float* b, float* c )
+{
+    LaneFloat b_rows[12];
+
+    for( u32 e = 0; e < 12; ++e )
+        b_rows[e] = LaneLoad( b + e * LaneStride );
+
+    for( u32 r = 0; r < 3; ++r )
+    {
+        LaneFloat a0 = LaneLoad( a + (4 * r + 0) * LaneStride );
+        LaneFloat a1 = LaneLoad( a + (4 * r + 1) * LaneStride );
+        LaneFloat a2 = LaneLoad( a + (4 * r + 2) * LaneStride );
+        LaneFloat a3 = LaneLoad( a + (4 * r + 3) * LaneStride );
+
+        for( u32 col = 0; col < 4; ++col )
+        {
+            LaneFloat v = LaneAdd( LaneAdd( LaneMul( a0, b_rows[col] ), LaneMul( a1, b_rows[4 + col] ) ), LaneMul( a2, b_rows[8 + col] ) );
+
+            // bottom row of b is 0 0 0 1.
+            if( col == 3 )
+                v = LaneAdd( v, a3 );
+
+            LaneStore( c + (4 * r + col) * LaneStride, v );
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+// c = a * m for every lane, m is the same matrix for all lanes.
+static inline void MultiplyLanes( const float* a, const Matrix4x4& m, float* c )
+{
+    LaneFloat b_rows[12];
+
+    for( u32 e = 0; e < 12; ++e )
+        b_rows[e] = LaneSet( m.matrix[e] );
+
+    for( u32 r = 0; r < 3; ++r )
+    {
+        LaneFloat a0 = LaneLoad( a + (4 * r + 0) * LaneStride );
+        LaneFloat a1 = LaneLoad( a + (4 * r + 1) * LaneStride );
+        LaneFloat a2 = LaneLoad( a + (4 * r + 2) * LaneStride );
+        LaneFloat a3 = LaneLoad( a + (4 * r + 3) * LaneStride );
+
+        for( u32 col = 0; col < 4; ++col )
+        {
+            LaneFloat v = LaneAdd( LaneAdd( LaneMul( a0, b_rows[col] ), LaneMul( a1, b_rows[4 + col] ) ), LaneMul( a2, b_rows[8 + col] ) );
+
+            if( col == 3 )
+                v = LaneAdd( v, a3 );
+
+            LaneStore( c + (4 * r + col) * LaneStride, v );
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimInstanceBatch::AnimInstanceBatch()
+: m_world(nullptr)
+, m_capacity(0)
+{
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimInstanceBatch::~AnimInstanceBatch()
+{
+    delete [] m_world;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimInstanceBatch::Reserve( u32 joint_count )
+{
+    if( joint_count <= m_capacity )
+        return;
+
+    delete [] m_world;
+    m_world = new float[joint_count * JointStride];
+    m_capacity = joint_count;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimInstanceBatch::CalculateGlobalPose( AnimHierarchy* const* hierarchies, u32 count )
+{
+    ENGINE_ASSERT(count > 0 && count <= Lanes, "invalid lane count");
+
+    u16 joint_count = hierarchies[0]->GetNodeCount();
+    Reserve( joint_count );
+
+    // unused lanes repeat the first hierarchy and are not written back.
+    AnimHierarchy* lanes[Lanes];
+
+    for( u32 l = 0; l < Lanes; ++l )
+    {
+        lanes[l] = hierarchies[l < count ? l : 0];
+        ENGINE_ASSERT(lanes[l]->GetNodeCount() == joint_count, "lane hierarchies differ");
+    }
+
+    const Matrix4x4* local[Lanes];
+    Matrix4x4* world[Lanes];
+    float local_block[JointStride];
+
+    for( u16 j = 0; j < joint_count; ++j )
+    {
+        for( u32 l = 0; l < Lanes; ++l )
+        {
+            local[l] = &lanes[l]->GetNode(j).GetLocalTransformation();
+            world[l] = &lanes[l]->GetNode(j).m_world_trans;
+        }
+
+        // parent is always evaluated before its children.
+        float* world_block = m_world + j * JointStride;
+        u16 parent = lanes[0]->GetNode(j).GetParentIndex();
+
+        if( parent != AnimTransformation::InvalidIndex )
+        {
+            GatherLanes( local, local_block );
+            MultiplyLanes( m_world + parent * JointStride, local_block, world_block );
+        }
+        else
+        {
+            GatherLanes( local, world_block );
+        }
+
+        ScatterLanes( world_block, world, count );
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimInstanceBatch::GenerateMatrixPalettes( const AnimHierarchy* const* hierarchies, u32 count, const Skeleton& skeleton, Matrix4x4* const* palettes )
+{
+    ENGINE_ASSERT(count > 0 && count <= Lanes, "invalid lane count");
+
+    const AnimHierarchy* lanes[Lanes];
+
+    for( u32 l = 0; l < Lanes; ++l )
+        lanes[l] = hierarchies[l < count ? l : 0];
+
+    // inverse of root world transformation (model-space palette), once per lane.
+    Matrix4x4 inv_root[Lanes];
+    const Matrix4x4* matrices[Lanes];
+
+    for( u32 l = 0; l < Lanes; ++l )
+    {
+        inv_root[l] = lanes[l]->GetNode(0).GetWorldTransformation();
+        inv_root[l].InverseIt();
+        matrices[l] = &inv_root[l];
+    }
+
+    float inv_root_block[JointStride];
+    float world_block[JointStride];
+    float model_block[JointStride];
+    GatherLanes( matrices, inv_root_block );
+
+    Matrix4x4* out[Lanes];
+
+    for( u16 j = 0; j < lanes[0]->GetNodeCount(); ++j )
+    {
+        for( u32 l = 0; l < Lanes; ++l )
+            matrices[l] = &lanes[l]->GetNode(j).GetWorldTransformation();
+
+        for( u32 l = 0; l < count; ++l )
+            out[l] = palettes[l] + j;
+
+        // K = (Bj_M)^-1 * Cj_M, inverse bind pose is shared by all lanes.
+        GatherLanes( matrices, world_block );
+        MultiplyLanes( inv_root_block, world_block, model_block );
+        MultiplyLanes( model_block, skeleton.GetInvBindPose(j), world_block );
+
+        ScatterLanes( world_block, out, count );
+    }
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
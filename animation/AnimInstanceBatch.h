@@ -0,0 +1,48 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/math/Matrix4x4.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class Skeleton;
+class AnimHierarchy;
+
+// evaluates up to Lanes hierarchies of the same skeleton in lockstep. joint matrices are stored
+// lane-interleaved (AoSoA): element e of joint j for lane l is at [(j * 12 + e) * Lanes + l], so
+// every SIMD operation processes the same joint of all lanes and they share the parent chain.
+// only top three rows are stored, all matrices are expected to be affine (bottom row 0 0 0 1).
+// batch owns scratch memory and is not thread safe, workers use their own batch.
+class AnimInstanceBatch
+{
+public:
+    static const u32 Lanes = 4;
+
+public:
+    AnimInstanceBatch();
+    ~AnimInstanceBatch();
+
+    // global transformations of count (<= Lanes) hierarchies, written back to hierarchy nodes.
+    void CalculateGlobalPose( AnimHierarchy* const* hierarchies, u32 count );
+
+    // K = (Bj_M)^-1 * Cj_M of count (<= Lanes) hierarchies. palettes[l] receives palette of lane l.
+    void GenerateMatrixPalettes( const AnimHierarchy* const* hierarchies, u32 count, const Skeleton& skeleton, Matrix4x4* const* palettes );
+
+    // bytes of batch object and its scratch memory.
+    inline size_t GetMemoryUsage() const { return sizeof(AnimInstanceBatch) + m_capacity * 12 * Lanes * sizeof(float); }
+
+private:
+    void Reserve( u32 joint_count );
+
+private:
+    // world matrices of all lanes (capacity joints).
+    float* m_world;
+
+    u32 m_capacity;
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
@@ -0,0 +1,84 @@
+#include "engine/animation/AnimJointQuery.h"
+#include "engine/animation/Skeleton.h"
+#include <string.h>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+AnimJointQuery::AnimJointQuery( const Skeleton* skeleton, const u16* joints, u32 joint_count )
+: m_skeleton(skeleton)
+, m_joints(nullptr)
+, m_joint_count(joint_count)
+, m_plan(nullptr)
+, m_plan_count(0)
+{
+    u32 skeleton_joint_count = skeleton->GetJointCount();
+
+    m_joints = new u16[joint_count > 0 ? joint_count : 1];
+
+    // mark requested joints and walk up to the root.
+    bool* used = new bool[skeleton_joint_count];
+    memset( used, 0, skeleton_joint_count * sizeof(bool) );
+
+    for( u32 i = 0; i < joint_count; ++i )
+    {
+        ENGINE_ASSERT(joints[i] < skeleton_joint_count, "joint out of bounds");
+        m_joints[i] = joints[i];
+
+        u32 joint = joints[i];
+
+        while( joint < skeleton_joint_count && !used[joint] )
+        {
+            used[joint] = true;
+
+            u32 parent = skeleton->GetJoint(joint).GetParentIndex();
+            ENGINE_ASSERT(parent == (u32)-1 || parent < joint, "parent joints have to precede children");
+
+            joint = parent;
+        }
+    }
+
+    for( u32 i = 0; i < skeleton_joint_count; ++i )
+        m_plan_count += used[i] ? 1 : 0;
+
+    // index order keeps parents before children.
+    m_plan = new u16[m_plan_count > 0 ? m_plan_count : 1];
+
+    u32 plan_idx = 0;
+    for( u32 i = 0; i < skeleton_joint_count; ++i )
+    {
+        if( used[i] )
+            m_plan[plan_idx++] = (u16)i;
+    }
+
+    delete [] used;
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimJointQuery::~AnimJointQuery()
+{
+    delete [] m_joints;
+    delete [] m_plan;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimJointQuery::Matches( const Skeleton* skeleton, const u16* joints, u32 joint_count ) const
+{
+    if( m_skeleton != skeleton || m_joint_count != joint_count )
+        return false;
+
+    for( u32 i = 0; i < joint_count; ++i )
+    {
+        if( m_joints[i] != joints[i] )
+            return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
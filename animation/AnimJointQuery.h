@@ -0,0 +1,50 @@
+#pragma once
+
+#include "engine/core/Types.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class Skeleton;
+
+// evaluation plan of a set of skeleton joints. plan contains requested joints and all their
+// ancestors in hierarchy order, so only those joints are sampled and transformed.
+// plan is read only after creation and can be used from multiple threads.
+class AnimJointQuery
+{
+public:
+    AnimJointQuery( const Skeleton* skeleton, const u16* joints, u32 joint_count );
+    ~AnimJointQuery();
+
+    // true if created for the same skeleton and joint list.
+    bool Matches( const Skeleton* skeleton, const u16* joints, u32 joint_count ) const;
+
+    inline const Skeleton* GetSkeleton() const { return m_skeleton; }
+
+    // requested joints (in request order).
+    inline u32 GetJointCount() const { return m_joint_count; }
+
+    inline u16 GetJoint( u32 idx ) const { ENGINE_ASSERT(idx < m_joint_count, "joint out of bounds"); return m_joints[idx]; }
+
+    // joints to evaluate (requested joints and their ancestors, parents first).
+    inline u32 GetPlanCount() const { return m_plan_count; }
+
+    inline u16 GetPlanJoint( u32 idx ) const { ENGINE_ASSERT(idx < m_plan_count, "joint out of bounds"); return m_plan[idx]; }
+
+private:
+    // skeleton the plan was built for.
+    const Skeleton* m_skeleton;
+
+    // requested joints.
+    u16* m_joints;
+    u32 m_joint_count;
+
+    // sorted joint indices of requested joints and their ancestors.
+    u16* m_plan;
+    u32 m_plan_count;
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
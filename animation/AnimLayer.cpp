@@ -1,231 +1,448 @@
-#include "engine/animation/AnimLayer.h"
-#include "engine/animation/AnimStates.h"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-
-AnimLayer::AnimLayer()
-: m_state_data(nullptr)
-, m_paused(false)
-, m_global_clock(0.f)
-, m_type(LayerType::Lerp)
-, m_blend_factor(1.f)
-, m_current_state(0)
-{
-    
-}
-
-//---------------------------------------------------------------------------------------
-
-AnimLayer::~AnimLayer()
-{
-}
-    
-//---------------------------------------------------------------------------------------
-
-void AnimLayer::SetStateData( AnimStates* data )
-{
-    m_state_data = data;
-    
-    u16 max_node_count = 0;
-    if( data )
-        max_node_count = data->GetMaxNodeCount();
-
-    m_current_tree.Resize(max_node_count);
-    m_previous_tree.Resize(max_node_count);
-}
-    
-//---------------------------------------------------------------------------------------
-
-bool AnimLayer::Play( StringId state_name, float blend_ms )
-{
-    if( !m_state_data )
-        return false;
-    
-    const AnimStates::State* state = m_state_data->FindState( state_name );
-    
-    if( !state )
-        return false;
-    
-    const AnimBlendTree& tree = state->GetBlendTree();
-    
-    if( !tree.IsValid() )
-        return false;
-    
-    bool res = Play( tree, blend_ms, m_global_clock );
-    
-    if( res )
-        m_current_state = state_name;
-    
-    return res;
-}
-
-//---------------------------------------------------------------------------------------
-
-bool AnimLayer::Transition( StringId transition_name )
-{
-    if( !m_state_data )
-        return false;
-    
-    const AnimStates::State* current = m_state_data->FindState( m_current_state );
-    
-    if( !current )
-        return false;
-    
-    const AnimStates::Transition* transition = current->FindTransition( transition_name );
-    
-    if( !transition )
-        return false;
-    
-    const AnimStates::State* destination = transition->GetDestinationState();
-    ENGINE_ASSERT(destination, "invalid destination");
-    
-    float start_time = m_global_clock;
-    
-    if( transition->IsSynced() )
-    {
-        start_time = m_global_clock - m_current_tree.GetLocalAnimationTime( m_global_clock );
-    }
-    
-    const AnimBlendTree& tree = destination->GetBlendTree();
-    
-    if( !tree.IsValid() )
-        return false;
-    
-    bool res = Play( tree, transition->GetBlendTime(), start_time );
-    
-    if( res )
-        m_current_state = destination->GetName();
-    
-    return res;
-}
-
-//---------------------------------------------------------------------------------------
-    
-bool AnimLayer::Play( const AnimBlendTree& tree, float blend_ms, float start_time_ms )
-{
-    ENGINE_ASSERT(tree.IsValid(), "invalid tree specified");
-    
-    if( blend_ms > 0.f && m_current_tree.IsValid() )
-    {
-        if( m_previous_tree.IsValid() )
-            m_previous_tree.Clear();
-        
-        // todo: more blend types.
-        m_crossfade_type = BlendType::Linear;
-        m_crossfade_duration = blend_ms;
-        m_crossfade_timer = 0.f;
-        
-        m_previous_tree = m_current_tree;
-        
-        m_current_tree = tree;
-    }
-    else
-    {
-        m_current_tree.Clear();
-        m_current_tree = tree;
-    }
-    
-    m_current_tree.Start( start_time_ms );
-    
-    return true;
-}
-    
-//---------------------------------------------------------------------------------------
-    
-void AnimLayer::Stop()
-{
-    m_previous_tree.Clear();
-    
-    m_crossfade_duration = 0.f;
-    m_crossfade_timer = 0.f;
-    m_crossfade_type = BlendType::None;
-    
-    m_current_tree.Clear();
-
-    m_paused = false;
-}
-    
-//---------------------------------------------------------------------------------------
-    
-bool AnimLayer::GetJointPose( u32 joint_idx, AnimationClip::JointPose& pose )
-{
-    bool res = m_current_tree.GetJointPose( m_global_clock, joint_idx, pose );
-    
-    if( res && m_previous_tree.IsValid() )
-    {
-        // blend in factor (blend out should be 1.f - factor).
-        float factor = m_crossfade_timer / m_crossfade_duration;
-        
-        // get previous animation tree pose.
-        AnimationClip::JointPose previous_pose;
-        m_previous_tree.GetJointPose( m_global_clock, joint_idx, previous_pose);
-        
-        // lerp with new pose.
-        pose.MakeLerp(previous_pose, pose, factor);
-    }
-    
-    return res;
-}
-    
-//---------------------------------------------------------------------------------------
-
-void AnimLayer::Update( float fDeltaMs )
-{
-    if( !Paused() )
-    {
-        m_global_clock += fDeltaMs;
-        
-        // update crossfade.
-        if( m_crossfade_type != BlendType::None )
-        {
-            m_crossfade_timer += fDeltaMs;
-            
-            // check if crossfade ended.
-            if( m_crossfade_timer >= m_crossfade_duration )
-            {
-                // remove previous tree.
-                // glitch happens here if already blending with previous tree.
-                m_previous_tree.Clear();
-                
-                // reset crossfade data.
-                m_crossfade_type = BlendType::None;
-                m_crossfade_duration = 0.f;
-                m_crossfade_timer = 0.f;
-            }
-        }
-        
-        // prevent float overflow.
-        const float max_clock_value = std::numeric_limits<float>::max() * 0.5f;        
-        if( m_global_clock > max_clock_value )
-        {
-            m_global_clock -= max_clock_value;
-            
-            if( m_current_tree.IsValid() )
-                m_current_tree.FixAnimationStartTime( max_clock_value );
-            
-            if( m_previous_tree.IsValid() )
-                m_previous_tree.FixAnimationStartTime( max_clock_value );
-        }
-    }
-}
-
-//---------------------------------------------------------------------------------------
-
-bool AnimLayer::SetNodeFactor( StringId name, float value )
-{
-    return m_current_tree.SetNodeFactor( name, value );
-}
-
-//---------------------------------------------------------------------------------------
-
-bool AnimLayer::GetNodeFactor( StringId name, float& value ) const
-{
-    return m_current_tree.GetNodeFactor( name, value );
-}
-
-//---------------------------------------------------------------------------------------
-}; //namespace Engine
-//---------------------------------------------------------------------------------------
-
+#include "engine/animation/AnimLayer.h"
+#include "engine/animation/AnimStates.h"
+#include "engine/animation/AnimRecorder.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+AnimLayer::AnimLayer()
+: m_owner((Handle)-1)
+, m_index(0)
+, m_recorder(nullptr)
+, m_wake_list(nullptr)
+, m_sleeping(false)
+, m_state_data(nullptr)
+, m_paused(false)
+, m_global_clock(0.f)
+, m_type(LayerType::Lerp)
+, m_blend_factor(1.f)
+, m_current_state(0)
+, m_previous_state(0)
+{
+    
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimLayer::~AnimLayer()
+{
+}
+    
+//---------------------------------------------------------------------------------------
+
+void AnimLayer::SetOwner( Handle controller, u16 index )
+{
+    m_owner = controller;
+    m_index = index;
+}
+    
+//---------------------------------------------------------------------------------------
+
+void AnimLayer::SetStateData( AnimStates* data )
+{
+    if( m_recorder )
+        m_recorder->RecordSetStateData( m_owner, m_index, data );
+    
+    Wake();
+    
+    m_state_data = data;
+    
+    u16 max_node_count = 0;
+    if( data )
+        max_node_count = data->GetMaxNodeCount();
+
+    m_current_tree.Resize(max_node_count);
+    m_previous_tree.Resize(max_node_count);
+}
+    
+//---------------------------------------------------------------------------------------
+
+bool AnimLayer::Play( StringId state_name, float blend_ms )
+{
+    if( m_recorder )
+        m_recorder->RecordPlay( m_owner, m_index, state_name, blend_ms );
+    
+    Wake();
+    
+    if( !m_state_data )
+        return false;
+    
+    const AnimStates::State* state = m_state_data->FindState( state_name );
+    
+    if( !state )
+        return false;
+    
+    const AnimBlendTree& tree = state->GetBlendTree();
+    
+    if( !tree.IsValid() )
+        return false;
+    
+    bool res = Play( tree, blend_ms, m_global_clock );
+    
+    if( res )
+        m_current_state = state_name;
+    
+    return res;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimLayer::Transition( StringId transition_name )
+{
+    if( m_recorder )
+        m_recorder->RecordTransition( m_owner, m_index, transition_name );
+    
+    Wake();
+    
+    if( !m_state_data )
+        return false;
+    
+    const AnimStates::State* current = m_state_data->FindState( m_current_state );
+    
+    if( !current )
+        return false;
+    
+    const AnimStates::Transition* transition = current->FindTransition( transition_name );
+    
+    if( !transition )
+        return false;
+    
+    const AnimStates::State* destination = transition->GetDestinationState();
+    ENGINE_ASSERT(destination, "invalid destination");
+    
+    float start_time = m_global_clock;
+    
+    if( transition->IsSynced() )
+    {
+        start_time = m_global_clock - m_current_tree.GetLocalAnimationTime( m_global_clock );
+    }
+    
+    const AnimBlendTree& tree = destination->GetBlendTree();
+    
+    if( !tree.IsValid() )
+        return false;
+    
+    bool res = Play( tree, transition->GetBlendTime(), start_time );
+    
+    if( res )
+        m_current_state = destination->GetName();
+    
+    return res;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimLayer::PlayClip( AnimationClip* clip, float local_time_ms, float blend_ms, bool looped )
+{
+    if( m_recorder )
+        m_recorder->RecordPlayClip( m_owner, m_index, clip ? clip->GetName() : 0, local_time_ms, blend_ms, looped );
+    
+    Wake();
+    
+    if( !clip )
+        return false;
+    
+    // layers without state data have no tree nodes yet.
+    if( m_current_tree.GetCapacity() == 0 )
+    {
+        m_current_tree.Resize(1);
+        m_previous_tree.Resize(1);
+    }
+    
+    if( m_clip_tree.GetCapacity() == 0 )
+        m_clip_tree.Resize(1);
+    
+    m_clip_tree.SetClip( clip, looped, 1.f );
+    
+    bool res = Play( m_clip_tree, blend_ms, m_global_clock - local_time_ms );
+    
+    if( res )
+        m_current_state = 0;
+    
+    return res;
+}
+
+//---------------------------------------------------------------------------------------
+    
+bool AnimLayer::Play( const AnimBlendTree& tree, float blend_ms, float start_time_ms )
+{
+    ENGINE_ASSERT(tree.IsValid(), "invalid tree specified");
+    
+    if( blend_ms > 0.f && m_current_tree.IsValid() )
+    {
+        if( m_previous_tree.IsValid() )
+            m_previous_tree.Clear();
+        
+        // todo: more blend types.
+        m_crossfade_type = BlendType::Linear;
+        m_crossfade_duration = blend_ms;
+        m_crossfade_timer = 0.f;
+        
+        m_previous_tree = m_current_tree;
+        m_previous_state = m_current_state;
+        
+        m_current_tree = tree;
+    }
+    else
+    {
+        m_current_tree.Clear();
+        m_current_tree = tree;
+    }
+    
+    m_current_tree.Start( start_time_ms );
+    
+    return true;
+}
+    
+//---------------------------------------------------------------------------------------
+    
+void AnimLayer::Pause()
+{
+    if( m_recorder )
+        m_recorder->RecordPause( m_owner, m_index );
+    
+    Wake();
+    
+    m_paused = true;
+}
+    
+//---------------------------------------------------------------------------------------
+    
+void AnimLayer::Resume()
+{
+    if( m_recorder )
+        m_recorder->RecordResume( m_owner, m_index );
+    
+    Wake();
+    
+    m_paused = false;
+}
+    
+//---------------------------------------------------------------------------------------
+    
+void AnimLayer::Stop()
+{
+    if( m_recorder )
+        m_recorder->RecordStop( m_owner, m_index );
+    
+    Wake();
+    
+    m_previous_tree.Clear();
+    
+    m_crossfade_duration = 0.f;
+    m_crossfade_timer = 0.f;
+    m_crossfade_type = BlendType::None;
+    
+    m_current_tree.Clear();
+
+    m_paused = false;
+}
+    
+//---------------------------------------------------------------------------------------
+    
+bool AnimLayer::GetJointPose( u32 joint_idx, const Skeleton& skeleton, AnimationClip::JointPose& pose, u32& traits )
+{
+    // cross-fade has just started, new tree does not contribute yet.
+    if( m_previous_tree.IsValid() && m_current_tree.GetWeight() <= 0.f )
+    {
+        ANIM_STAT_ADD(pruned_evaluations, 1);
+        return m_previous_tree.GetJointPose( m_global_clock, joint_idx, skeleton, pose, traits );
+    }
+    
+    bool res = m_current_tree.GetJointPose( m_global_clock, joint_idx, skeleton, pose, traits );
+    
+    if( res && m_previous_tree.IsValid() && m_previous_tree.GetWeight() <= 0.f )
+    {
+        ANIM_STAT_ADD(pruned_evaluations, 1);
+    }
+    else if( res && m_previous_tree.IsValid() )
+    {
+        // blend in factor (blend out should be 1.f - factor).
+        float factor = m_crossfade_timer / m_crossfade_duration;
+        
+        // get previous animation tree pose.
+        AnimationClip::JointPose previous_pose;
+        u32 previous_traits = 0;
+        
+        // previous tree may miss the joint, current pose is used as is then.
+        if( m_previous_tree.GetJointPose( m_global_clock, joint_idx, skeleton, previous_pose, previous_traits ) )
+        {
+            // lerp with new pose.
+            traits &= previous_traits;
+            pose.MakeLerp(previous_pose, pose, factor, traits);
+        }
+    }
+    
+    return res;
+}
+    
+//---------------------------------------------------------------------------------------
+
+bool AnimLayer::IsStatic()
+{
+    if( !Active() || Paused() )
+        return true;
+    
+    return !IsCrossfading() && m_current_tree.IsStatic( m_global_clock );
+}
+
+//---------------------------------------------------------------------------------------
+
+const Animation* AnimLayer::GetSingleAnimation() const
+{
+    if( m_previous_tree.IsValid() || m_current_tree.GetCount() != 1 )
+        return nullptr;
+    
+    const AnimBlendTree::Node& node = m_current_tree.GetNode(0);
+    
+    return node.GetType() == BlendNodeType::Value ? &node.GetAnimation() : nullptr;
+}
+
+//---------------------------------------------------------------------------------------
+
+const AnimationClip* AnimLayer::GetFirstClip() const
+{
+    for( u16 i = 0; i < m_current_tree.GetCount(); ++i )
+    {
+        const AnimBlendTree::Node& node = m_current_tree.GetNode(i);
+        
+        if( node.GetType() == BlendNodeType::Value )
+            return node.GetAnimation().GetClip();
+    }
+    
+    return nullptr;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimLayer::UpdateWeights( float weight, float epsilon )
+{
+    if( m_previous_tree.IsValid() )
+    {
+        float factor = m_crossfade_timer / m_crossfade_duration;
+        
+        float current_weight = weight * factor;
+        float previous_weight = weight * (1.f - factor);
+        
+        // at least one of the trees has to be evaluated.
+        m_current_tree.UpdateWeights( current_weight > epsilon || current_weight >= previous_weight ? current_weight : 0.f, epsilon );
+        m_previous_tree.UpdateWeights( previous_weight > epsilon || previous_weight > current_weight ? previous_weight : 0.f, epsilon );
+    }
+    else
+    {
+        m_current_tree.UpdateWeights( weight, epsilon );
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimLayer::Update( float fDeltaMs, AnimEventBuffer* events )
+{
+    if( !Paused() )
+    {
+        float prev_clock = m_global_clock;
+        m_global_clock += fDeltaMs;
+        
+        // fire events before cross-fade ends and previous tree gets removed.
+        if( events )
+        {
+            float current_weight = m_blend_factor;
+            
+            if( m_previous_tree.IsValid() )
+            {
+                float factor = Math::Clamp<float>( (m_crossfade_timer + fDeltaMs) / m_crossfade_duration, 0.f, 1.f );
+                
+                m_previous_tree.CollectEvents( prev_clock, m_global_clock, m_blend_factor * (1.f - factor), m_index, *events );
+                current_weight *= factor;
+            }
+            
+            if( m_current_tree.IsValid() )
+                m_current_tree.CollectEvents( prev_clock, m_global_clock, current_weight, m_index, *events );
+        }
+        
+        // update crossfade.
+        if( m_crossfade_type != BlendType::None )
+        {
+            m_crossfade_timer += fDeltaMs;
+            
+            // check if crossfade ended.
+            if( m_crossfade_timer >= m_crossfade_duration )
+            {
+                // remove previous tree.
+                // glitch happens here if already blending with previous tree.
+                m_previous_tree.Clear();
+                
+                // reset crossfade data.
+                m_crossfade_type = BlendType::None;
+                m_crossfade_duration = 0.f;
+                m_crossfade_timer = 0.f;
+            }
+        }
+        
+        // prevent float overflow.
+        const float max_clock_value = std::numeric_limits<float>::max() * 0.5f;        
+        if( m_global_clock > max_clock_value )
+        {
+            m_global_clock -= max_clock_value;
+            
+            if( m_current_tree.IsValid() )
+                m_current_tree.FixAnimationStartTime( max_clock_value );
+            
+            if( m_previous_tree.IsValid() )
+                m_previous_tree.FixAnimationStartTime( max_clock_value );
+        }
+        
+        // clip sample positions are computed once here instead of per joint.
+        m_current_tree.UpdateCursors( m_global_clock );
+        m_previous_tree.UpdateCursors( m_global_clock );
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimLayer::SetNodeFactor( StringId name, float value )
+{
+    if( m_recorder )
+        m_recorder->RecordSetNodeFactor( m_owner, m_index, name, value );
+    
+    Wake();
+    
+    return m_current_tree.SetNodeFactor( name, value );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimLayer::SetBlendFactor( float f )
+{
+    if( m_recorder )
+        m_recorder->RecordSetBlendFactor( m_owner, m_index, f );
+    
+    Wake();
+    
+    m_blend_factor = f;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimLayer::SetType( LayerType::Enum t )
+{
+    if( m_recorder )
+        m_recorder->RecordSetLayerType( m_owner, m_index, (u32)t );
+    
+    Wake();
+    
+    m_type = t;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimLayer::GetNodeFactor( StringId name, float& value ) const
+{
+    return m_current_tree.GetNodeFactor( name, value );
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
+
@@ -1,118 +1,189 @@
-#pragma once
-
-#include "engine/animation/AnimationClip.h"
-#include "engine/animation/AnimBlendTree.h"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-    
-class AnimStates;
-    
-//---------------------------------------------------------------------------------------
-
-// enumerates type of animation layer.
-// defines how a layer pose gets blended with previously generated pose.
-namespace LayerType{
-    enum Enum{
-        Additive,
-        Lerp
-    };
-}
-
-// enumerates type of cross fade.
-// deines how blend factor changes during animation cross fade.
-namespace BlendType{
-    enum Enum{
-        None = -1,
-        Linear,
-        EaseIn, //todo: support
-        EaseOut //todo: support
-    };
-}
-
-//---------------------------------------------------------------------------------------
-    
-class AnimLayer
-{
-public:
-    AnimLayer();
-    ~AnimLayer();
-    
-    // looks for named state in state data and transitions with specified blend time.
-    bool Play( StringId state_name, float blend_ms );
-    
-    // looks for named transition in state data and transitions to specified blend tree.
-    bool Transition( StringId transition_name );
-    
-    inline void Pause() { m_paused = true; }
-    
-    inline void Resume() { m_paused = false; }
-    
-    void Stop();
-    
-    inline bool Active() { return m_current_tree.IsValid(); }
-    
-    bool Paused() const { return m_paused; }
-    
-    bool GetJointPose( u32 joint_idx, AnimationClip::JointPose& pose );
-    
-    void Update( float fDeltaMs );
-    
-    inline LayerType::Enum GetType() const { return m_type; }
-    
-    inline void SetType( LayerType::Enum t ) { m_type = t; }
-    
-    bool SetNodeFactor( StringId name, float value );
-    
-    bool GetNodeFactor( StringId name, float& value ) const;
-    
-    inline float GetBlendFactor() const { return m_blend_factor; }
-    
-    inline void SetBlendFactor( float f ) { m_blend_factor = f; }
-    
-    void SetStateData( AnimStates* data );
-    
-private:
-    bool Play( const AnimBlendTree& tree, float blend_ms, float start_time_ms );
-    
-private:
-    // layer state and transition data.
-    AnimStates* m_state_data;
-    
-    // current state played.
-    StringId m_current_state;
-    
-    // layer timer.
-    float m_global_clock;
-    
-    // layer animation pause state.
-    bool m_paused;
-    
-    // root node of animation blend tree.
-    AnimBlendTree m_current_tree;
-    
-    // used while cross-blending.
-    AnimBlendTree m_previous_tree;
-    
-private:
-    // type of layer, used while blending layers.
-    LayerType::Enum m_type;
-    
-    // layer blend factor (used when blending between layers occur).
-    float m_blend_factor;
-    
-private:
-    // duration of tree cross fading.
-    float m_crossfade_duration;
-    
-    // crossfade timer.
-    float m_crossfade_timer;
-    
-    // type of current crossfade.
-    BlendType::Enum m_crossfade_type;
-};
-
-//---------------------------------------------------------------------------------------
-} // namespace Engine
+#pragma once
+
+#include "engine/animation/AnimationClip.h"
+#include "engine/animation/AnimBlendTree.h"
+#include "engine/core/ObjectArray.h"
+#include <vector>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+    
+class AnimStates;
+class AnimRecorder;
+
+// handles of sleeping controllers woken by layer calls (owned by AnimationSystem).
+typedef std::vector<Handle> AnimWakeList;
+    
+//---------------------------------------------------------------------------------------
+
+// enumerates type of animation layer.
+// defines how a layer pose gets blended with previously generated pose.
+namespace LayerType{
+    enum Enum{
+        Additive,
+        Lerp
+    };
+}
+
+// enumerates type of cross fade.
+// deines how blend factor changes during animation cross fade.
+namespace BlendType{
+    enum Enum{
+        None = -1,
+        Linear,
+        EaseIn, //todo: support
+        EaseOut //todo: support
+    };
+}
+
+//---------------------------------------------------------------------------------------
+    
+class AnimLayer
+{
+public:
+    AnimLayer();
+    ~AnimLayer();
+    
+    // looks for named state in state data and transitions with specified blend time.
+    bool Play( StringId state_name, float blend_ms );
+    
+    // looks for named transition in state data and transitions to specified blend tree.
+    bool Transition( StringId transition_name );
+    
+    // plays clip outside of state data from given local time (i.e. motion matching result). layer leaves
+    // its current state, so transitions are not available until the next Play.
+    bool PlayClip( AnimationClip* clip, float local_time_ms, float blend_ms, bool looped );
+    
+    void Pause();
+    
+    void Resume();
+    
+    void Stop();
+    
+    inline bool Active() { return m_current_tree.IsValid(); }
+    
+    bool Paused() const { return m_paused; }
+    
+    // true if previous tree is still blended out.
+    inline bool IsCrossfading() const { return m_previous_tree.IsValid(); }
+    
+    // layer timer (global time of layer animations).
+    inline float GetClock() const { return m_global_clock; }
+    
+    // true if layer pose does not change with time (inactive, paused, or all animations static and not cross-fading).
+    bool IsStatic();
+    
+    // returns animation if the layer plays a single clip (one node tree, not cross-fading), null otherwise.
+    const Animation* GetSingleAnimation() const;
+    
+    // clip of the first animation node in current tree (null if inactive).
+    const AnimationClip* GetFirstClip() const;
+    
+    bool GetJointPose( u32 joint_idx, const Skeleton& skeleton, AnimationClip::JointPose& pose, u32& traits );
+    
+    // propagates layer weight into current and cross-faded trees. called once per frame before pose extraction.
+    void UpdateWeights( float weight, float epsilon );
+    
+    // advances layer timer. clip events passed during the update are added to events (if not null).
+    void Update( float fDeltaMs, AnimEventBuffer* events );
+    
+    inline LayerType::Enum GetType() const { return m_type; }
+    
+    void SetType( LayerType::Enum t );
+    
+    bool SetNodeFactor( StringId name, float value );
+    
+    bool GetNodeFactor( StringId name, float& value ) const;
+    
+    inline float GetBlendFactor() const { return m_blend_factor; }
+    
+    void SetBlendFactor( float f );
+    
+    void SetStateData( AnimStates* data );
+    
+    inline const AnimStates* GetStateData() const { return m_state_data; }
+    
+    // bytes of current and previous tree node arrays. both are sized by state data GetMaxNodeCount().
+    inline size_t GetTreeMemoryUsage() const { return m_current_tree.GetMemoryUsage() + m_previous_tree.GetMemoryUsage() + m_clip_tree.GetMemoryUsage(); }
+    
+    friend class AnimController;
+    friend class AnimReplication;
+private:
+    bool Play( const AnimBlendTree& tree, float blend_ms, float start_time_ms );
+    
+    // called by owning controller. controllers may be relocated, so layers keep a handle.
+    void SetOwner( Handle controller, u16 index );
+    
+    // records calls if set.
+    inline void SetRecorder( AnimRecorder* recorder ) { m_recorder = recorder; }
+    
+    // sleeping layer adds owner to wake list on the first call changing its state.
+    inline void SetWakeList( AnimWakeList* wake_list ) { m_wake_list = wake_list; }
+    
+    // set while owner is sleeping or static (falls asleep with the next update).
+    inline void SetSleeping( bool sleeping ) { m_sleeping = sleeping; }
+    
+    inline void Wake() { if( m_sleeping && m_wake_list ) { m_wake_list->push_back( m_owner ); m_sleeping = false; } }
+    
+private:
+    // handle of controller owning the layer.
+    Handle m_owner;
+    
+    // index of the layer in owning controller.
+    u16 m_index;
+    
+    // records externally driven calls (null if not recording).
+    AnimRecorder* m_recorder;
+    
+    // wake requests of sleeping owner (null if sleeping is not used).
+    AnimWakeList* m_wake_list;
+    
+    // owning controller is sleeping or static (first state change adds it to wake list).
+    bool m_sleeping;
+    
+    // layer state and transition data.
+    AnimStates* m_state_data;
+    
+    // current state played.
+    StringId m_current_state;
+    
+    // state of the tree blended out (valid while cross-fading).
+    StringId m_previous_state;
+    
+    // layer timer.
+    float m_global_clock;
+    
+    // layer animation pause state.
+    bool m_paused;
+    
+    // root node of animation blend tree.
+    AnimBlendTree m_current_tree;
+    
+    // used while cross-blending.
+    AnimBlendTree m_previous_tree;
+    
+    // single node tree of PlayClip (allocated on first use).
+    AnimBlendTree m_clip_tree;
+    
+private:
+    // type of layer, used while blending layers.
+    LayerType::Enum m_type;
+    
+    // layer blend factor (used when blending between layers occur).
+    float m_blend_factor;
+    
+private:
+    // duration of tree cross fading.
+    float m_crossfade_duration;
+    
+    // crossfade timer.
+    float m_crossfade_timer;
+    
+    // type of current crossfade.
+    BlendType::Enum m_crossfade_type;
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
 //---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/core/StringId.h"
+#include "engine/core/ObjectArray.h"
+#include <vector>
+#include <functional>
+#include <string.h>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// enumerates memory accounting categories.
+namespace AnimMemoryCategory{
+    enum Enum{
+        Clips,
+        Skeletons,
+        States,
+        Controllers,
+        BakedPalettes,
+        Count
+    };
+}
+
+//---------------------------------------------------------------------------------------
+
+// memory of a single shared asset.
+struct AnimAssetMemory
+{
+    AnimMemoryCategory::Enum category;
+
+    // clip, skeleton or state data object.
+    const void* asset;
+
+    // clip/skeleton name. 0 for state data.
+    StringId name;
+
+    size_t bytes;
+};
+
+//---------------------------------------------------------------------------------------
+
+// memory owned by a single controller.
+struct AnimControllerMemory
+{
+    inline void Reset() { memset(this, 0, sizeof(*this)); }
+
+    Handle handle;
+
+    // controller and layer objects.
+    size_t layers;
+
+    // node arrays of current and previous blend tree of all layers.
+    size_t trees;
+
+    // transformation hierarchy.
+    size_t hierarchy;
+
+    // controller's own skinning palette.
+    size_t palette;
+
+    // event buffer.
+    size_t events;
+
+    size_t total;
+};
+
+//---------------------------------------------------------------------------------------
+
+// memory used by animation assets referenced by live controllers and by the controllers themselves.
+struct AnimMemoryReport
+{
+    // bytes per AnimMemoryCategory.
+    size_t category_bytes[AnimMemoryCategory::Count];
+
+    size_t total;
+
+    // highest total seen by the system.
+    size_t high_water;
+
+    // budget set on the system (0 if there is none).
+    size_t budget;
+
+    std::vector<AnimAssetMemory> assets;
+
+    std::vector<AnimControllerMemory> controllers;
+};
+
+// reference count of a shared asset in running memory totals.
+struct AnimAssetRef
+{
+    const void* asset;
+
+    // number of controller references (skeleton) and layer references (state data and its clips).
+    u32 refs;
+
+    // bytes added to the total with the first reference.
+    size_t bytes;
+};
+
+// called when total exceeds the budget.
+typedef std::function<void( const AnimMemoryReport& report )> AnimMemoryBudgetFunc;
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
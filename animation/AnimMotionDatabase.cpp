@@ -0,0 +1,721 @@
+#include "engine/animation/AnimMotionDatabase.h"
+#include "engine/animation/AnimationClip.h"
+#include "engine/animation/AnimHierarchy.h"
+#include "engine/animation/Skeleton.h"
+#include "engine/animation/AnimTrace.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <xmmintrin.h>
+    #define ANIM_MOTION_SSE 1
+#endif
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+AnimMotionSettings::AnimMotionSettings()
+: root_joint(0)
+, joint_count(0)
+, trajectory_count(0)
+, forward_axis(0.f, 0.f, 1.f)
+, position_weight(1.f)
+, velocity_weight(1.f)
+, trajectory_position_weight(1.f)
+, trajectory_direction_weight(1.f)
+{
+    memset( joints, 0, sizeof(joints) );
+    memset( trajectory_ms, 0, sizeof(trajectory_ms) );
+}
+
+//---------------------------------------------------------------------------------------
+
+// database file header, followed by clip names, clip looping, mean, scale, frame clips, frame times and features.
+struct MotionFileHeader
+{
+    u32 magic;
+    u32 version;
+    AnimMotionSettings settings;
+    u32 dimension;
+    u32 stride;
+    u32 frame_count;
+    u32 clip_count;
+};
+
+//---------------------------------------------------------------------------------------
+
+// world transformations use column vectors (translation in elements 3, 7, 11).
+static inline Vec3 TransformPoint( const Matrix4x4& m, const Vec3& p )
+{
+    const float* e = m.matrix;
+    return Vec3( e[0] * p.x + e[1] * p.y + e[2] * p.z + e[3],
+                 e[4] * p.x + e[5] * p.y + e[6] * p.z + e[7],
+                 e[8] * p.x + e[9] * p.y + e[10] * p.z + e[11] );
+}
+
+//---------------------------------------------------------------------------------------
+
+static inline Vec3 TransformVector( const Matrix4x4& m, const Vec3& v )
+{
+    const float* e = m.matrix;
+    return Vec3( e[0] * v.x + e[1] * v.y + e[2] * v.z,
+                 e[4] * v.x + e[5] * v.y + e[6] * v.z,
+                 e[8] * v.x + e[9] * v.y + e[10] * v.z );
+}
+
+//---------------------------------------------------------------------------------------
+
+static inline Vec3 GetTranslation( const Matrix4x4& m )
+{
+    return Vec3( m.matrix[3], m.matrix[7], m.matrix[11] );
+}
+
+//---------------------------------------------------------------------------------------
+
+static inline void WriteVec3( float* out, const Vec3& v )
+{
+    out[0] = v.x;
+    out[1] = v.y;
+    out[2] = v.z;
+}
+
+//---------------------------------------------------------------------------------------
+
+// wraps looped time into clip duration, clamps non looped time.
+static float GetClipTime( const AnimationClip& clip, float time_ms, bool looped )
+{
+    float duration = clip.GetDuration( looped );
+
+    if( duration <= 0.f )
+        return 0.f;
+
+    if( looped )
+    {
+        time_ms = fmodf( time_ms, duration );
+        return time_ms < 0.f ? time_ms + duration : time_ms;
+    }
+
+    return time_ms < 0.f ? 0.f : (time_ms > duration ? duration : time_ms);
+}
+
+//---------------------------------------------------------------------------------------
+
+// samples all joints of the clip and calculates model-space transformations. joints missing in the clip keep identity.
+static void SampleModelPose( const AnimationClip& clip, float time_ms, bool looped, AnimHierarchy& hierarchy )
+{
+    AnimationClip::SampleCursor cursor;
+    clip.UpdateCursor( time_ms, looped, cursor );
+
+    for( u16 j = 0; j < hierarchy.GetNodeCount(); ++j )
+    {
+        AnimTransformation& node = hierarchy.GetNode(j);
+        AnimationClip::JointPose pose;
+
+        if( j < clip.m_skeleton_joint_count && clip.HasJointPose(j) )
+        {
+            clip.GetJointPose( cursor, j, pose );
+        }
+        else
+        {
+            pose.translation = Vec3( 0.f, 0.f, 0.f );
+            pose.rotation = Quaternion( 0.f, 0.f, 0.f, 1.f );
+            pose.scale = 1.f;
+        }
+
+        node.SetTranslation( pose.translation );
+        node.SetRotation( pose.rotation );
+        node.SetScale( pose.scale );
+        node.CalculateLocalTransformation();
+    }
+
+    hierarchy.CalculateGlobalTransformation();
+}
+
+//---------------------------------------------------------------------------------------
+
+#if ANIM_MOTION_SSE
+static inline float HorizontalSum( __m128 v )
+{
+    __m128 sum = _mm_add_ps( v, _mm_movehl_ps( v, v ) );
+    sum = _mm_add_ss( sum, _mm_shuffle_ps( sum, sum, 1 ) );
+    return _mm_cvtss_f32( sum );
+}
+#endif
+
+//---------------------------------------------------------------------------------------
+
+// squared distance of two feature vectors. stops once partial sum reaches limit (checked every 16 features).
+static inline float FrameDistance( const float* query, const float* features, u32 stride, float limit )
+{
+#if ANIM_MOTION_SSE
+    __m128 sum = _mm_setzero_ps();
+
+    for( u32 i = 0; i < stride; i += 4 )
+    {
+        __m128 d = _mm_sub_ps( _mm_loadu_ps( query + i ), _mm_loadu_ps( features + i ) );
+        sum = _mm_add_ps( sum, _mm_mul_ps( d, d ) );
+
+        if( (i & 15) == 12 && HorizontalSum( sum ) >= limit )
+            return limit;
+    }
+
+    return HorizontalSum( sum );
+#else
+    float sum = 0.f;
+
+    for( u32 i = 0; i < stride; ++i )
+    {
+        float d = query[i] - features[i];
+        sum += d * d;
+
+        if( (i & 15) == 15 && sum >= limit )
+            return limit;
+    }
+
+    return sum;
+#endif
+}
+
+//---------------------------------------------------------------------------------------
+
+// squared distance of query to the closest point of a bounding box.
+static inline float BoxDistance( const float* query, const float* box_min, const float* box_max, u32 stride, float limit )
+{
+#if ANIM_MOTION_SSE
+    const __m128 zero = _mm_setzero_ps();
+    __m128 sum = zero;
+
+    for( u32 i = 0; i < stride; i += 4 )
+    {
+        __m128 q = _mm_loadu_ps( query + i );
+        __m128 below = _mm_sub_ps( _mm_loadu_ps( box_min + i ), q );
+        __m128 above = _mm_sub_ps( q, _mm_loadu_ps( box_max + i ) );
+        __m128 d = _mm_max_ps( _mm_max_ps( below, above ), zero );
+        sum = _mm_add_ps( sum, _mm_mul_ps( d, d ) );
+
+        if( (i & 15) == 12 && HorizontalSum( sum ) >= limit )
+            return limit;
+    }
+
+    return HorizontalSum( sum );
+#else
+    float sum = 0.f;
+
+    for( u32 i = 0; i < stride; ++i )
+    {
+        float d = box_min[i] - query[i];
+        d = query[i] - box_max[i] > d ? query[i] - box_max[i] : d;
+        d = d > 0.f ? d : 0.f;
+        sum += d * d;
+
+        if( (i & 15) == 15 && sum >= limit )
+            return limit;
+    }
+
+    return sum;
+#endif
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimMotionDatabase::AnimMotionDatabase()
+: m_dimension(0)
+, m_stride(0)
+, m_frame_count(0)
+, m_features(nullptr)
+, m_mean(nullptr)
+, m_scale(nullptr)
+, m_frame_clip(nullptr)
+, m_frame_time(nullptr)
+, m_small_min(nullptr)
+, m_small_max(nullptr)
+, m_large_min(nullptr)
+, m_large_max(nullptr)
+{
+
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimMotionDatabase::~AnimMotionDatabase()
+{
+    Release();
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimMotionDatabase::Release()
+{
+    delete [] m_features;
+    delete [] m_mean;
+    delete [] m_scale;
+    delete [] m_frame_clip;
+    delete [] m_frame_time;
+    delete [] m_small_min;
+    delete [] m_small_max;
+    delete [] m_large_min;
+    delete [] m_large_max;
+
+    m_features = m_mean = m_scale = m_frame_time = nullptr;
+    m_small_min = m_small_max = m_large_min = m_large_max = nullptr;
+    m_frame_clip = nullptr;
+
+    m_clips.clear();
+    m_looped.clear();
+
+    m_dimension = 0;
+    m_stride = 0;
+    m_frame_count = 0;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimMotionDatabase::Allocate( u32 frame_count, u32 clip_count )
+{
+    m_frame_count = frame_count;
+
+    m_features = new float[(size_t)frame_count * m_stride];
+    m_mean = new float[m_stride];
+    m_scale = new float[m_stride];
+    m_frame_clip = new u16[frame_count];
+    m_frame_time = new float[frame_count];
+
+    m_clips.resize( clip_count, nullptr );
+    m_looped.resize( clip_count, 0 );
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimMotionDatabase::Build( Skeleton* skeleton, AnimationClip* const* clips, const bool* looped, u32 clip_count, const AnimMotionSettings& settings )
+{
+    Release();
+
+    if( !skeleton || clip_count == 0 || clip_count > 0xffff )
+        return false;
+
+    if( settings.joint_count > AnimMotionMaxJoints || settings.trajectory_count > AnimMotionMaxTrajectory )
+        return false;
+
+    if( settings.root_joint >= skeleton->GetJointCount() )
+        return false;
+
+    for( u32 i = 0; i < settings.joint_count; ++i )
+    {
+        if( settings.joints[i] >= skeleton->GetJointCount() )
+            return false;
+    }
+
+    u32 frame_count = 0;
+
+    for( u32 c = 0; c < clip_count; ++c )
+    {
+        // additive and curve clips are sampled the same way, but additive poses are not model-space poses.
+        if( !clips[c] || clips[c]->m_frame_count == 0 || (clips[c]->m_traits & ClipTraits::Additive) )
+            return false;
+
+        frame_count += clips[c]->m_frame_count;
+    }
+
+    ANIM_TRACE_SCOPE( "BuildMotionDatabase", 0, frame_count );
+
+    m_settings = settings;
+
+    u32 joint_count = settings.joint_count;
+    u32 trajectory_count = settings.trajectory_count;
+
+    m_dimension = 6 * joint_count + 6 * trajectory_count;
+    m_stride = (m_dimension + 3) & ~3u;
+
+    if( m_dimension == 0 )
+        return false;
+
+    Allocate( frame_count, clip_count );
+
+    std::vector<float> raw( (size_t)frame_count * m_dimension );
+    AnimHierarchy* hierarchy = AnimHierarchy::CreateFromSkeleton( skeleton );
+
+    u32 frame = 0;
+
+    for( u32 c = 0; c < clip_count; ++c )
+    {
+        const AnimationClip& clip = *clips[c];
+        bool clip_looped = looped ? looped[c] : false;
+
+        m_clips[c] = clips[c];
+        m_looped[c] = clip_looped ? 1 : 0;
+
+        float frame_ms = 1.f / clip.m_frames_per_ms;
+
+        for( u32 i = 0; i < clip.m_frame_count; ++i, ++frame )
+        {
+            float time = i * frame_ms;
+
+            m_frame_clip[frame] = (u16)c;
+            m_frame_time[frame] = time;
+
+            float* out = &raw[(size_t)frame * m_dimension];
+
+            // central difference, one sided at the ends of non looped clips.
+            float prev_time = clip_looped ? time - frame_ms : GetClipTime( clip, time - frame_ms, false );
+            float next_time = clip_looped ? time + frame_ms : GetClipTime( clip, time + frame_ms, false );
+            float velocity_scale = next_time > prev_time ? 1000.f / (next_time - prev_time) : 0.f;
+
+            Vec3 prev_positions[AnimMotionMaxJoints];
+            SampleModelPose( clip, GetClipTime( clip, prev_time, clip_looped ), clip_looped, *hierarchy );
+
+            for( u32 j = 0; j < joint_count; ++j )
+                prev_positions[j] = GetTranslation( hierarchy->GetNode( settings.joints[j] ).GetWorldTransformation() );
+
+            Vec3 next_positions[AnimMotionMaxJoints];
+            SampleModelPose( clip, GetClipTime( clip, next_time, clip_looped ), clip_looped, *hierarchy );
+
+            for( u32 j = 0; j < joint_count; ++j )
+                next_positions[j] = GetTranslation( hierarchy->GetNode( settings.joints[j] ).GetWorldTransformation() );
+
+            // current pose defines root space.
+            SampleModelPose( clip, time, clip_looped, *hierarchy );
+
+            Matrix4x4 inv_root = hierarchy->GetNode( settings.root_joint ).GetWorldTransformation();
+            inv_root.InverseIt();
+
+            for( u32 j = 0; j < joint_count; ++j )
+            {
+                const Matrix4x4& joint = hierarchy->GetNode( settings.joints[j] ).GetWorldTransformation();
+                WriteVec3( out + 3 * j, TransformPoint( inv_root, GetTranslation( joint ) ) );
+
+                Vec3 velocity( (next_positions[j].x - prev_positions[j].x) * velocity_scale,
+                               (next_positions[j].y - prev_positions[j].y) * velocity_scale,
+                               (next_positions[j].z - prev_positions[j].z) * velocity_scale );
+
+                WriteVec3( out + 3 * (joint_count + j), TransformVector( inv_root, velocity ) );
+            }
+
+            for( u32 k = 0; k < trajectory_count; ++k )
+            {
+                SampleModelPose( clip, GetClipTime( clip, time + settings.trajectory_ms[k], clip_looped ), clip_looped, *hierarchy );
+
+                const Matrix4x4& root = hierarchy->GetNode( settings.root_joint ).GetWorldTransformation();
+                Vec3 direction = TransformVector( root, settings.forward_axis );
+
+                WriteVec3( out + 6 * joint_count + 3 * k, TransformPoint( inv_root, GetTranslation( root ) ) );
+                WriteVec3( out + 6 * joint_count + 3 * (trajectory_count + k), TransformVector( inv_root, direction ) );
+            }
+        }
+    }
+
+    delete hierarchy;
+
+    // every 3 component feature shares a deviation, so its axes keep their relative scale.
+    for( u32 d = 0; d < m_stride; ++d )
+    {
+        m_mean[d] = 0.f;
+        m_scale[d] = 0.f;
+    }
+
+    for( u32 f = 0; f < frame_count; ++f )
+    {
+        for( u32 d = 0; d < m_dimension; ++d )
+            m_mean[d] += raw[(size_t)f * m_dimension + d];
+    }
+
+    for( u32 d = 0; d < m_dimension; ++d )
+        m_mean[d] /= (float)frame_count;
+
+    for( u32 group = 0; group < m_dimension / 3; ++group )
+    {
+        float variance = 0.f;
+
+        for( u32 f = 0; f < frame_count; ++f )
+        {
+            for( u32 a = 0; a < 3; ++a )
+            {
+                u32 d = group * 3 + a;
+                float delta = raw[(size_t)f * m_dimension + d] - m_mean[d];
+                variance += delta * delta;
+            }
+        }
+
+        float deviation = sqrtf( variance / (3.f * frame_count) );
+
+        float weight = settings.trajectory_direction_weight;
+
+        if( group < joint_count )
+            weight = settings.position_weight;
+        else if( group < 2 * joint_count )
+            weight = settings.velocity_weight;
+        else if( group < 2 * joint_count + trajectory_count )
+            weight = settings.trajectory_position_weight;
+
+        for( u32 a = 0; a < 3; ++a )
+            m_scale[group * 3 + a] = deviation > 1e-6f ? weight / deviation : weight;
+    }
+
+    for( u32 f = 0; f < frame_count; ++f )
+        Normalize( &raw[(size_t)f * m_dimension], &m_features[(size_t)f * m_stride] );
+
+    BuildBounds();
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimMotionDatabase::BuildBounds()
+{
+    u32 small_count = (m_frame_count + SmallBoxSize - 1) / SmallBoxSize;
+    u32 large_count = (m_frame_count + LargeBoxSize - 1) / LargeBoxSize;
+
+    m_small_min = new float[(size_t)small_count * m_stride];
+    m_small_max = new float[(size_t)small_count * m_stride];
+    m_large_min = new float[(size_t)large_count * m_stride];
+    m_large_max = new float[(size_t)large_count * m_stride];
+
+    for( u32 f = 0; f < m_frame_count; ++f )
+    {
+        const float* features = GetFeatures(f);
+
+        float* small_min = &m_small_min[(size_t)(f / SmallBoxSize) * m_stride];
+        float* small_max = &m_small_max[(size_t)(f / SmallBoxSize) * m_stride];
+        float* large_min = &m_large_min[(size_t)(f / LargeBoxSize) * m_stride];
+        float* large_max = &m_large_max[(size_t)(f / LargeBoxSize) * m_stride];
+
+        bool small_first = (f % SmallBoxSize) == 0;
+        bool large_first = (f % LargeBoxSize) == 0;
+
+        for( u32 d = 0; d < m_stride; ++d )
+        {
+            float v = features[d];
+
+            small_min[d] = small_first || v < small_min[d] ? v : small_min[d];
+            small_max[d] = small_first || v > small_max[d] ? v : small_max[d];
+            large_min[d] = large_first || v < large_min[d] ? v : large_min[d];
+            large_max[d] = large_first || v > large_max[d] ? v : large_max[d];
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimMotionDatabase::Normalize( const float* raw, float* query ) const
+{
+    for( u32 d = 0; d < m_dimension; ++d )
+        query[d] = (raw[d] - m_mean[d]) * m_scale[d];
+
+    // padding matches zero padding of features.
+    for( u32 d = m_dimension; d < m_stride; ++d )
+        query[d] = 0.f;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimMotionDatabase::SetQueryTrajectory( float* query, const Vec3* positions, const Vec3* directions ) const
+{
+    u32 position_offset = 6 * m_settings.joint_count;
+    u32 direction_offset = position_offset + 3 * m_settings.trajectory_count;
+
+    for( u32 k = 0; k < m_settings.trajectory_count; ++k )
+    {
+        const float raw_position[3] = { positions[k].x, positions[k].y, positions[k].z };
+        const float raw_direction[3] = { directions[k].x, directions[k].y, directions[k].z };
+
+        for( u32 a = 0; a < 3; ++a )
+        {
+            u32 p = position_offset + 3 * k + a;
+            u32 d = direction_offset + 3 * k + a;
+
+            query[p] = (raw_position[a] - m_mean[p]) * m_scale[p];
+            query[d] = (raw_direction[a] - m_mean[d]) * m_scale[d];
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+float AnimMotionDatabase::GetCost( const float* query, u32 frame ) const
+{
+    return FrameDistance( query, GetFeatures(frame), m_stride, FLT_MAX );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimMotionDatabase::Search( const float* query, AnimMotionMatch& match, bool use_bounds ) const
+{
+    match.frame = InvalidFrame;
+    match.cost = FLT_MAX;
+
+    if( !use_bounds )
+    {
+        for( u32 f = 0; f < m_frame_count; ++f )
+        {
+            float cost = FrameDistance( query, &m_features[(size_t)f * m_stride], m_stride, match.cost );
+
+            if( cost < match.cost )
+            {
+                match.frame = f;
+                match.cost = cost;
+            }
+        }
+
+        return;
+    }
+
+    u32 small_count = (m_frame_count + SmallBoxSize - 1) / SmallBoxSize;
+    u32 large_count = (m_frame_count + LargeBoxSize - 1) / LargeBoxSize;
+    const u32 small_per_large = LargeBoxSize / SmallBoxSize;
+
+    for( u32 l = 0; l < large_count; ++l )
+    {
+        if( BoxDistance( query, &m_large_min[(size_t)l * m_stride], &m_large_max[(size_t)l * m_stride], m_stride, match.cost ) >= match.cost )
+            continue;
+
+        u32 small_end = (l + 1) * small_per_large < small_count ? (l + 1) * small_per_large : small_count;
+
+        for( u32 s = l * small_per_large; s < small_end; ++s )
+        {
+            if( BoxDistance( query, &m_small_min[(size_t)s * m_stride], &m_small_max[(size_t)s * m_stride], m_stride, match.cost ) >= match.cost )
+                continue;
+
+            u32 frame_end = (s + 1) * SmallBoxSize < m_frame_count ? (s + 1) * SmallBoxSize : m_frame_count;
+
+            for( u32 f = s * SmallBoxSize; f < frame_end; ++f )
+            {
+                float cost = FrameDistance( query, &m_features[(size_t)f * m_stride], m_stride, match.cost );
+
+                if( cost < match.cost )
+                {
+                    match.frame = f;
+                    match.cost = cost;
+                }
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimMotionDatabase::Save( const char* path ) const
+{
+    if( m_frame_count == 0 )
+        return false;
+
+    MotionFileHeader header;
+    header.magic = Magic;
+    header.version = Version;
+    header.settings = m_settings;
+    header.dimension = m_dimension;
+    header.stride = m_stride;
+    header.frame_count = m_frame_count;
+    header.clip_count = (u32)m_clips.size();
+
+    std::vector<StringId> names( m_clips.size() );
+
+    for( size_t c = 0; c < m_clips.size(); ++c )
+        names[c] = m_clips[c]->GetName();
+
+    FILE* file = fopen( path, "wb" );
+
+    if( !file )
+        return false;
+
+    bool result = fwrite( &header, sizeof(header), 1, file ) == 1
+        && fwrite( &names[0], sizeof(StringId), names.size(), file ) == names.size()
+        && fwrite( &m_looped[0], sizeof(u8), m_looped.size(), file ) == m_looped.size()
+        && fwrite( m_mean, sizeof(float), m_stride, file ) == m_stride
+        && fwrite( m_scale, sizeof(float), m_stride, file ) == m_stride
+        && fwrite( m_frame_clip, sizeof(u16), m_frame_count, file ) == m_frame_count
+        && fwrite( m_frame_time, sizeof(float), m_frame_count, file ) == m_frame_count
+        && fwrite( m_features, sizeof(float), (size_t)m_frame_count * m_stride, file ) == (size_t)m_frame_count * m_stride;
+
+    result = (fclose( file ) == 0) && result;
+
+    return result;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimMotionDatabase::Load( const char* path, AnimationClip* const* clips, u32 clip_count )
+{
+    Release();
+
+    FILE* file = fopen( path, "rb" );
+
+    if( !file )
+        return false;
+
+    MotionFileHeader header;
+
+    if( fread( &header, sizeof(header), 1, file ) != 1
+       || header.magic != Magic
+       || header.version != Version
+       || header.frame_count == 0
+       || header.clip_count == 0
+       || header.clip_count > 0xffff
+       || header.stride != ((header.dimension + 3) & ~3u) )
+    {
+        fclose( file );
+        return false;
+    }
+
+    m_settings = header.settings;
+    m_dimension = header.dimension;
+    m_stride = header.stride;
+
+    Allocate( header.frame_count, header.clip_count );
+
+    std::vector<StringId> names( header.clip_count );
+
+    bool result = fread( &names[0], sizeof(StringId), names.size(), file ) == names.size()
+        && fread( &m_looped[0], sizeof(u8), m_looped.size(), file ) == m_looped.size()
+        && fread( m_mean, sizeof(float), m_stride, file ) == m_stride
+        && fread( m_scale, sizeof(float), m_stride, file ) == m_stride
+        && fread( m_frame_clip, sizeof(u16), m_frame_count, file ) == m_frame_count
+        && fread( m_frame_time, sizeof(float), m_frame_count, file ) == m_frame_count
+        && fread( m_features, sizeof(float), (size_t)m_frame_count * m_stride, file ) == (size_t)m_frame_count * m_stride;
+
+    fclose( file );
+
+    // resolve clips by name.
+    for( u32 c = 0; result && c < header.clip_count; ++c )
+    {
+        for( u32 i = 0; i < clip_count; ++i )
+        {
+            if( clips[i] && clips[i]->GetName() == names[c] )
+                m_clips[c] = clips[i];
+        }
+
+        result = m_clips[c] != nullptr;
+    }
+
+    for( u32 f = 0; result && f < m_frame_count; ++f )
+        result = m_frame_clip[f] < header.clip_count;
+
+    if( !result )
+    {
+        Release();
+        return false;
+    }
+
+    BuildBounds();
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+size_t AnimMotionDatabase::GetMemoryUsage() const
+{
+    u32 small_count = (m_frame_count + SmallBoxSize - 1) / SmallBoxSize;
+    u32 large_count = (m_frame_count + LargeBoxSize - 1) / LargeBoxSize;
+
+    return sizeof(AnimMotionDatabase)
+        + ((size_t)m_frame_count + 2 * small_count + 2 * large_count + 2) * m_stride * sizeof(float)
+        + (size_t)m_frame_count * (sizeof(u16) + sizeof(float))
+        + m_clips.size() * (sizeof(AnimationClip*) + sizeof(u8));
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
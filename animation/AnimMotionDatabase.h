@@ -0,0 +1,204 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/math/Vec3.h"
+#include <vector>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class Skeleton;
+class AnimationClip;
+
+// maximum number of matched joints and future trajectory samples.
+static const u32 AnimMotionMaxJoints = 8;
+static const u32 AnimMotionMaxTrajectory = 4;
+
+//---------------------------------------------------------------------------------------
+
+// feature layout of motion database. all features are expressed in root joint space of the frame.
+struct AnimMotionSettings
+{
+    AnimMotionSettings();
+
+    // joint defining character position and facing.
+    u16 root_joint;
+
+    // joints whose positions and velocities are matched (i.e. feet and hips).
+    u16 joints[AnimMotionMaxJoints];
+    u32 joint_count;
+
+    // future root trajectory sample times in milliseconds.
+    float trajectory_ms[AnimMotionMaxTrajectory];
+    u32 trajectory_count;
+
+    // root joint axis pointing forward (trajectory directions).
+    Vec3 forward_axis;
+
+    // feature weights (applied after normalization).
+    float position_weight;
+    float velocity_weight;
+    float trajectory_position_weight;
+    float trajectory_direction_weight;
+};
+
+//---------------------------------------------------------------------------------------
+
+// result of motion search.
+struct AnimMotionMatch
+{
+    // database frame (AnimMotionDatabase::InvalidFrame if database is empty).
+    u32 frame;
+
+    // weighted squared distance of normalized features.
+    float cost;
+};
+
+//---------------------------------------------------------------------------------------
+
+// per-frame feature vectors of a clip set used for motion matching. features of every clip frame are
+// normalized (zero mean, unit deviation per feature, then weighted), so a query is matched by squared distance.
+// consecutive frames are grouped into two levels of bounding boxes, so search skips frame ranges which can't
+// beat the best cost found so far. database is read only after Build/Load and may be searched from many threads.
+//
+// feature layout (GetDimension floats, padded to GetStride):
+//   joint positions (3 per joint), joint velocities in units per second (3 per joint),
+//   trajectory positions (3 per sample), trajectory directions (3 per sample).
+class AnimMotionDatabase
+{
+public:
+    // 'ANMM'
+    static const u32 Magic = 0x4d4d4e41;
+    static const u32 Version = 1;
+
+    // frames per bounding box of the lower and the upper level.
+    static const u32 SmallBoxSize = 16;
+    static const u32 LargeBoxSize = 64;
+
+    static const u32 InvalidFrame = (u32)-1;
+
+public:
+    AnimMotionDatabase();
+    ~AnimMotionDatabase();
+
+    // extracts features of every clip frame (clip frame rate). trajectory of looped clips wraps around,
+    // non looped clips are clamped at the end. offline step, pose of every sample is fully evaluated.
+    bool Build( Skeleton* skeleton, AnimationClip* const* clips, const bool* looped, u32 clip_count, const AnimMotionSettings& settings );
+
+    void Release();
+
+    // writes features and normalization (bounds are rebuilt on load). clips are stored by name.
+    bool Save( const char* path ) const;
+
+    // loads database saved by Save. clips are matched by name, returns false if any of them is missing.
+    bool Load( const char* path, AnimationClip* const* clips, u32 clip_count );
+
+    inline const AnimMotionSettings& GetSettings() const { return m_settings; }
+
+    // number of features.
+    inline u32 GetDimension() const { return m_dimension; }
+
+    // floats of every feature vector and query (dimension padded to a multiple of 4).
+    inline u32 GetStride() const { return m_stride; }
+
+    inline u32 GetFrameCount() const { return m_frame_count; }
+
+    inline AnimationClip* GetFrameClip( u32 frame ) const;
+
+    inline bool IsFrameLooped( u32 frame ) const;
+
+    // local time of the frame in its clip.
+    inline float GetFrameTime( u32 frame ) const;
+
+    // normalized features of the frame (GetStride floats).
+    inline const float* GetFeatures( u32 frame ) const;
+
+    // normalizes raw features (GetDimension floats) into query (GetStride floats).
+    void Normalize( const float* raw, float* query ) const;
+
+    // writes desired root trajectory (root joint space, trajectory_count positions and directions) into
+    // normalized query. pose part is usually copied from features of the frame currently played.
+    void SetQueryTrajectory( float* query, const Vec3* positions, const Vec3* directions ) const;
+
+    // cost of a single frame.
+    float GetCost( const float* query, u32 frame ) const;
+
+    // finds frame with the lowest cost. bounding boxes are tested before frames if use_bounds is set,
+    // otherwise all frames are compared.
+    void Search( const float* query, AnimMotionMatch& match, bool use_bounds = true ) const;
+
+    // bytes of database arrays.
+    size_t GetMemoryUsage() const;
+
+private:
+    // allocates arrays for given frame count and layout.
+    void Allocate( u32 frame_count, u32 clip_count );
+
+    // min/max of every box level.
+    void BuildBounds();
+
+private:
+    AnimMotionSettings m_settings;
+
+    u32 m_dimension;
+    u32 m_stride;
+    u32 m_frame_count;
+
+    // m_frame_count * m_stride normalized features.
+    float* m_features;
+
+    // per feature mean and scale (weight / deviation), m_stride each.
+    float* m_mean;
+    float* m_scale;
+
+    // clip index and local time of every frame.
+    u16* m_frame_clip;
+    float* m_frame_time;
+
+    // clips referenced by frames and their looping.
+    std::vector<AnimationClip*> m_clips;
+    std::vector<u8> m_looped;
+
+    // bounding boxes of SmallBoxSize and LargeBoxSize consecutive frames (m_stride floats each).
+    float* m_small_min;
+    float* m_small_max;
+    float* m_large_min;
+    float* m_large_max;
+};
+
+//---------------------------------------------------------------------------------------
+
+inline AnimationClip* AnimMotionDatabase::GetFrameClip( u32 frame ) const
+{
+    ENGINE_ASSERT(frame < m_frame_count, "frame out of bounds");
+    return m_clips[m_frame_clip[frame]];
+}
+
+//---------------------------------------------------------------------------------------
+
+inline bool AnimMotionDatabase::IsFrameLooped( u32 frame ) const
+{
+    ENGINE_ASSERT(frame < m_frame_count, "frame out of bounds");
+    return m_looped[m_frame_clip[frame]] != 0;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline float AnimMotionDatabase::GetFrameTime( u32 frame ) const
+{
+    ENGINE_ASSERT(frame < m_frame_count, "frame out of bounds");
+    return m_frame_time[frame];
+}
+
+//---------------------------------------------------------------------------------------
+
+inline const float* AnimMotionDatabase::GetFeatures( u32 frame ) const
+{
+    ENGINE_ASSERT(frame < m_frame_count, "frame out of bounds");
+    return &m_features[(size_t)frame * m_stride];
+}
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "engine/animation/AnimPaletteBuffer.h"
+#include <string.h>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+AnimPaletteBuffer::AnimPaletteBuffer()
+: m_memory(nullptr)
+, m_frame_count(0)
+, m_frame_size(0)
+, m_frame_index(0)
+, m_write_offset(0)
+, m_alignment(16)
+, m_entries(nullptr)
+, m_entry_counts(nullptr)
+, m_overflow_counts(nullptr)
+, m_max_palette_count(0)
+{
+
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimPaletteBuffer::~AnimPaletteBuffer()
+{
+    Release();
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimPaletteBuffer::Initialize( void* memory, u32 size_bytes, u32 frame_count, u32 max_palette_count, u32 offset_alignment )
+{
+    ENGINE_ASSERT(((size_t)memory & 15) == 0, "palette memory has to be 16 byte aligned");
+    ENGINE_ASSERT((offset_alignment & (offset_alignment - 1)) == 0, "alignment has to be power of two");
+
+    if( !memory || frame_count == 0 || max_palette_count == 0 )
+        return false;
+
+    if( offset_alignment < 16 )
+        offset_alignment = 16;
+
+    // every region has to start at aligned offset.
+    u32 frame_size = (size_bytes / frame_count) & ~(offset_alignment - 1);
+
+    if( frame_size == 0 )
+        return false;
+
+    Release();
+
+    m_memory = (u8*)memory;
+    m_frame_count = frame_count;
+    m_frame_size = frame_size;
+    m_alignment = offset_alignment;
+    m_max_palette_count = max_palette_count;
+
+    m_entries = new Entry[frame_count * max_palette_count];
+    m_entry_counts = new u32[frame_count];
+    memset(m_entry_counts, 0, sizeof(u32) * frame_count);
+    m_overflow_counts = new u32[frame_count];
+    memset(m_overflow_counts, 0, sizeof(u32) * frame_count);
+
+    // first NextFrame call moves to region 0.
+    m_frame_index = frame_count - 1;
+    m_write_offset = 0;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimPaletteBuffer::Release()
+{
+    delete [] m_entries;
+    m_entries = nullptr;
+
+    delete [] m_entry_counts;
+    m_entry_counts = nullptr;
+
+    delete [] m_overflow_counts;
+    m_overflow_counts = nullptr;
+
+    m_memory = nullptr;
+    m_frame_count = 0;
+    m_frame_size = 0;
+    m_max_palette_count = 0;
+}
+
+//---------------------------------------------------------------------------------------
+
+u32 AnimPaletteBuffer::NextFrame()
+{
+    ENGINE_ASSERT(IsValid(), "palette buffer not initialized");
+
+    m_frame_index = (m_frame_index + 1) % m_frame_count;
+    m_write_offset = 0;
+    m_entry_counts[m_frame_index] = 0;
+    m_overflow_counts[m_frame_index] = 0;
+
+    return m_frame_index;
+}
+
+//---------------------------------------------------------------------------------------
+
+Matrix4x4* AnimPaletteBuffer::Allocate( Handle controller, u32 matrix_count, u32& out_offset )
+{
+    u32& entry_count = m_entry_counts[m_frame_index];
+    u32 size = matrix_count * sizeof(Matrix4x4);
+
+    if( entry_count >= m_max_palette_count || m_write_offset + size > m_frame_size )
+    {
+        m_overflow_counts[m_frame_index]++;
+        return nullptr;
+    }
+
+    out_offset = GetFrameOffset(m_frame_index) + m_write_offset;
+
+    Entry& entry = m_entries[m_frame_index * m_max_palette_count + entry_count];
+    entry.controller = controller;
+    entry.offset = out_offset;
+    entry.matrix_count = matrix_count;
+    entry_count++;
+
+    // next palette starts at aligned offset.
+    m_write_offset = (m_write_offset + size + m_alignment - 1) & ~(m_alignment - 1);
+
+    return (Matrix4x4*)(m_memory + out_offset);
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/core/ObjectArray.h"
+#include "engine/math/Matrix4x4.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// caller-owned skinning palette ring buffer (i.e. persistently mapped uniform/storage buffer).
+// memory is split into frame_count equal regions. every palette generation pass writes
+// palettes of all controllers into the next region, so frame N+1 can be produced while
+// frame N is still consumed.
+class AnimPaletteBuffer
+{
+public:
+    // placement of a single controller palette within a frame region.
+    struct Entry
+    {
+        // controller the palette belongs to.
+        Handle controller;
+
+        // byte offset from the beginning of the whole buffer.
+        u32 offset;
+
+        // number of matrices in the palette.
+        u32 matrix_count;
+    };
+
+public:
+    AnimPaletteBuffer();
+    ~AnimPaletteBuffer();
+
+    // memory has to be at least 16 byte aligned. offset_alignment (power of two, >= 16) is applied to every palette.
+    bool Initialize( void* memory, u32 size_bytes, u32 frame_count, u32 max_palette_count, u32 offset_alignment );
+
+    // releases offset tables. memory is owned by the caller.
+    void Release();
+
+    // moves to the next frame region and clears its offset table and overflow count.
+    // caller is responsible for making sure the region is no longer consumed.
+    u32 NextFrame();
+
+    // reserves space for a palette in current frame region. returns nullptr and counts the
+    // overflow if region or offset table is full.
+    Matrix4x4* Allocate( Handle controller, u32 matrix_count, u32& out_offset );
+
+    inline bool IsValid() const { return m_memory != nullptr; }
+
+    inline void* GetMemory() const { return m_memory; }
+
+    inline u32 GetFrameCount() const { return m_frame_count; }
+
+    // index of the region written by the last palette generation pass.
+    inline u32 GetFrameIndex() const { return m_frame_index; }
+
+    // byte size of a single frame region.
+    inline u32 GetFrameSize() const { return m_frame_size; }
+
+    // byte offset of a frame region from the beginning of the buffer.
+    inline u32 GetFrameOffset( u32 frame ) const { return frame * m_frame_size; }
+
+    // per-frame palette offset table.
+    inline const Entry* GetEntries( u32 frame ) const;
+
+    inline u32 GetEntryCount( u32 frame ) const;
+
+    // number of palettes that did not fit into the frame region (they have no offset table entry).
+    inline u32 GetOverflowCount( u32 frame ) const;
+
+private:
+    // caller provided memory.
+    u8* m_memory;
+
+    // number of buffered frames (2 - double buffering, 3 - triple buffering).
+    u32 m_frame_count;
+
+    // size of a single frame region (multiple of m_alignment).
+    u32 m_frame_size;
+
+    // current frame region.
+    u32 m_frame_index;
+
+    // write position within current frame region.
+    u32 m_write_offset;
+
+    // palette offset alignment.
+    u32 m_alignment;
+
+    // offset tables. m_frame_count * m_max_palette_count entries.
+    Entry* m_entries;
+
+    // number of valid entries per frame.
+    u32* m_entry_counts;
+
+    // number of failed allocations per frame.
+    u32* m_overflow_counts;
+
+    // maximum number of palettes written per frame.
+    u32 m_max_palette_count;
+};
+
+//---------------------------------------------------------------------------------------
+
+inline const AnimPaletteBuffer::Entry* AnimPaletteBuffer::GetEntries( u32 frame ) const
+{
+    ENGINE_ASSERT(frame < m_frame_count, "frame out of bounds");
+    return &m_entries[frame * m_max_palette_count];
+}
+
+//---------------------------------------------------------------------------------------
+
+inline u32 AnimPaletteBuffer::GetEntryCount( u32 frame ) const
+{
+    ENGINE_ASSERT(frame < m_frame_count, "frame out of bounds");
+    return m_entry_counts[frame];
+}
+
+//---------------------------------------------------------------------------------------
+
+inline u32 AnimPaletteBuffer::GetOverflowCount( u32 frame ) const
+{
+    ENGINE_ASSERT(frame < m_frame_count, "frame out of bounds");
+    return m_overflow_counts[frame];
+}
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
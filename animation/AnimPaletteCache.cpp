@@ -0,0 +1,155 @@
+#include "engine/animation/AnimPaletteCache.h"
+#include "engine/animation/AnimationClip.h"
+#include "engine/animation/AnimBounds.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <xmmintrin.h>
+    #define ANIM_PALETTE_CACHE_SSE 1
+#endif
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// palettes are blended as flat float arrays.
+static_assert( sizeof(Matrix4x4) == 16 * sizeof(float), "unexpected Matrix4x4 layout" );
+
+//---------------------------------------------------------------------------------------
+
+AnimPaletteCache::AnimPaletteCache()
+: m_frames_per_second(30.f)
+{
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimPaletteCache::~AnimPaletteCache()
+{
+    Clear();
+}
+
+//---------------------------------------------------------------------------------------
+
+const AnimPaletteCache::Entry* AnimPaletteCache::Find( const Skeleton* skeleton, const AnimationClip* clip ) const
+{
+    for( size_t i = 0; i < m_entries.size(); ++i )
+    {
+        if( m_entries[i]->skeleton == skeleton && m_entries[i]->clip == clip )
+            return m_entries[i];
+    }
+
+    return nullptr;
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimPaletteCache::Entry* AnimPaletteCache::Add( const Skeleton* skeleton, const AnimationClip* clip, u32 joint_count )
+{
+    float duration_ms = clip->GetDuration( true );
+    float frames = duration_ms * m_frames_per_second * 0.001f;
+
+    Entry* entry = new Entry;
+    entry->skeleton = skeleton;
+    entry->clip = clip;
+    entry->frame_count = frames > 1.f ? (u32)( frames + 0.5f ) : 1;
+    entry->frames_per_ms = duration_ms > 0.f ? entry->frame_count / duration_ms : 0.f;
+    entry->joint_count = joint_count;
+    entry->palettes = new Matrix4x4[entry->frame_count * joint_count];
+    entry->bounds = new AnimBounds();
+    entry->bounds->SetCount( entry->frame_count );
+
+    m_entries.push_back( entry );
+    return entry;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimPaletteCache::Clear()
+{
+    for( size_t i = 0; i < m_entries.size(); ++i )
+    {
+        delete [] m_entries[i]->palettes;
+        delete m_entries[i]->bounds;
+        delete m_entries[i];
+    }
+
+    m_entries.clear();
+}
+
+//---------------------------------------------------------------------------------------
+
+size_t AnimPaletteCache::GetMemoryUsage() const
+{
+    size_t size = m_entries.capacity() * sizeof(Entry*);
+
+    for( size_t i = 0; i < m_entries.size(); ++i )
+    {
+        const Entry& entry = *m_entries[i];
+
+        // bounds: handle and 12 floats per frame.
+        size += sizeof(Entry) + sizeof(AnimBounds);
+        size += (size_t)entry.frame_count * entry.joint_count * sizeof(Matrix4x4);
+        size += (size_t)entry.frame_count * (sizeof(Handle) + 12 * sizeof(float));
+    }
+
+    return size;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimPaletteCache::GetFrames( const Entry& entry, float local_time_ms, u32& lower, u32& upper, float& factor )
+{
+    // negative playback rate gives negative local time.
+    float frame = fmodf( local_time_ms * entry.frames_per_ms, (float)entry.frame_count );
+    frame = frame >= 0.f ? frame : frame + (float)entry.frame_count;
+
+    lower = (u32)frame;
+    factor = frame - (float)lower;
+
+    lower = lower < entry.frame_count ? lower : entry.frame_count - 1;
+
+    // looped - last frame blends with the first one.
+    upper = lower + 1 < entry.frame_count ? lower + 1 : 0;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimPaletteCache::Sample( const Entry& entry, float local_time_ms, bool interpolate, Matrix4x4* palette )
+{
+    u32 lower, upper;
+    float factor;
+    GetFrames( entry, local_time_ms, lower, upper, factor );
+
+    const Matrix4x4* a = entry.palettes + (size_t)lower * entry.joint_count;
+
+    if( !interpolate || factor <= 0.f )
+    {
+        memcpy( palette, a, entry.joint_count * sizeof(Matrix4x4) );
+        return;
+    }
+
+    const float* fa = a->matrix;
+    const float* fb = entry.palettes[(size_t)upper * entry.joint_count].matrix;
+    float* out = palette->matrix;
+    u32 count = entry.joint_count * 16;
+
+#if ANIM_PALETTE_CACHE_SSE
+    __m128 f = _mm_set1_ps( factor );
+
+    for( u32 i = 0; i < count; i += 4 )
+    {
+        __m128 va = _mm_loadu_ps( fa + i );
+        __m128 vb = _mm_loadu_ps( fb + i );
+        _mm_storeu_ps( out + i, _mm_add_ps( va, _mm_mul_ps( _mm_sub_ps( vb, va ), f ) ) );
+    }
+#else
+    for( u32 i = 0; i < count; ++i )
+        out[i] = fa[i] + (fb[i] - fa[i]) * factor;
+#endif
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/math/Matrix4x4.h"
+#include <vector>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class Skeleton;
+class AnimationClip;
+class AnimBounds;
+
+// skinning palettes of looped clips baked at a fixed frame rate, one entry per (skeleton, clip).
+// controllers playing a single looped clip index cached palettes by clip phase instead of
+// sampling, hierarchy and palette passes. entries reference skeleton and clip, so the cache has
+// to be cleared before they are unloaded.
+class AnimPaletteCache
+{
+public:
+    struct Entry
+    {
+        const Skeleton* skeleton;
+        const AnimationClip* clip;
+
+        // number of baked frames covering looped clip duration (frame_count-th frame is frame 0).
+        u32 frame_count;
+
+        // baked frames per millisecond of clip local time.
+        float frames_per_ms;
+
+        // matrices in a single palette.
+        u32 joint_count;
+
+        // frame_count palettes, palette after palette.
+        Matrix4x4* palettes;
+
+        // unpadded per-frame bounds (frame_count entries).
+        AnimBounds* bounds;
+    };
+
+public:
+    AnimPaletteCache();
+    ~AnimPaletteCache();
+
+    // frame rate of newly baked entries.
+    inline void SetFrameRate( float frames_per_second ) { m_frames_per_second = frames_per_second; }
+
+    inline float GetFrameRate() const { return m_frames_per_second; }
+
+    // returns cached entry or null.
+    const Entry* Find( const Skeleton* skeleton, const AnimationClip* clip ) const;
+
+    // adds entry with uninitialized palettes and bounds sized for current frame rate.
+    Entry* Add( const Skeleton* skeleton, const AnimationClip* clip, u32 joint_count );
+
+    void Clear();
+
+    inline u32 GetCount() const { return (u32)m_entries.size(); }
+
+    // bytes of all entries.
+    size_t GetMemoryUsage() const;
+
+    // baked frames around clip local time and blend factor between them.
+    static void GetFrames( const Entry& entry, float local_time_ms, u32& lower, u32& upper, float& factor );
+
+    // writes palette at clip local time. nearest lower frame is copied if interpolate is false,
+    // otherwise two frames are blended per matrix element.
+    static void Sample( const Entry& entry, float local_time_ms, bool interpolate, Matrix4x4* palette );
+
+private:
+    std::vector<Entry*> m_entries;
+
+    float m_frames_per_second;
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include "engine/animation/AnimRecorder.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+AnimRecordSettings::AnimRecordSettings()
+: worker_count(1)
+, batch_size(16)
+, prune_epsilon(0.f)
+, baked_frames_per_second(0.f)
+, baked_interpolate(0)
+, sleeping_enabled(1)
+, instance_batching(0)
+, compaction_interval(0)
+, bounds_enabled(0)
+, hit_shapes_enabled(0)
+, bounds_padding(0.f)
+{
+
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimRecorder::AnimRecorder()
+: m_data(nullptr)
+, m_size(0)
+, m_capacity(0)
+, m_frame(0)
+, m_state_data(nullptr)
+, m_state_data_names(nullptr)
+, m_state_data_count(0)
+, m_state_data_capacity(0)
+{
+    Reset();
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimRecorder::~AnimRecorder()
+{
+    delete [] m_data;
+    delete [] m_state_data;
+    delete [] m_state_data_names;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::Reset()
+{
+    m_size = 0;
+    m_frame = 0;
+
+    WriteU32( Magic );
+    WriteU32( Version );
+
+    AnimRecordSettings settings;
+    Write( &settings, sizeof(settings) );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordSettings( const AnimRecordSettings& settings )
+{
+    // settings follow magic and version.
+    memcpy( m_data + 2 * sizeof(u32), &settings, sizeof(settings) );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RegisterStateData( AnimStates* data, StringId name )
+{
+    for( u32 i = 0; i < m_state_data_count; ++i )
+    {
+        if( m_state_data[i] == data )
+        {
+            m_state_data_names[i] = name;
+            return;
+        }
+    }
+
+    if( m_state_data_count == m_state_data_capacity )
+    {
+        u32 capacity = m_state_data_capacity > 0 ? m_state_data_capacity * 2 : 16;
+
+        AnimStates** data_array = new AnimStates*[capacity];
+        StringId* name_array = new StringId[capacity];
+
+        for( u32 i = 0; i < m_state_data_count; ++i )
+        {
+            data_array[i] = m_state_data[i];
+            name_array[i] = m_state_data_names[i];
+        }
+
+        delete [] m_state_data;
+        delete [] m_state_data_names;
+
+        m_state_data = data_array;
+        m_state_data_names = name_array;
+        m_state_data_capacity = capacity;
+    }
+
+    m_state_data[m_state_data_count] = data;
+    m_state_data_names[m_state_data_count] = name;
+    m_state_data_count++;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::Write( const void* data, u32 size )
+{
+    if( m_size + size > m_capacity )
+    {
+        u32 capacity = m_capacity > 0 ? m_capacity * 2 : 64 * 1024;
+
+        while( capacity < m_size + size )
+            capacity *= 2;
+
+        u8* new_data = new u8[capacity];
+
+        if( m_data )
+            memcpy( new_data, m_data, m_size );
+
+        delete [] m_data;
+        m_data = new_data;
+        m_capacity = capacity;
+    }
+
+    memcpy( m_data + m_size, data, size );
+    m_size += size;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::WriteCommand( AnimCommandType::Enum type, Handle h, u16 layer )
+{
+    ENGINE_ASSERT(layer < 256, "layer index does not fit the log format");
+
+    u8 type_byte = (u8)type;
+    u8 layer_byte = (u8)layer;
+
+    Write( &type_byte, sizeof(type_byte) );
+    WriteU32( m_frame );
+    WriteU32( (u32)h );
+    Write( &layer_byte, sizeof(layer_byte) );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordCreateController( Handle h, StringId skeleton_name, u32 layer_count )
+{
+    WriteCommand( AnimCommandType::CreateController, h, 0 );
+    WriteU32( skeleton_name );
+    WriteU32( layer_count );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordDestroyController( Handle h )
+{
+    WriteCommand( AnimCommandType::DestroyController, h, 0 );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordSetStateData( Handle h, u16 layer, AnimStates* data )
+{
+    StringId name = 0;
+
+    for( u32 i = 0; i < m_state_data_count; ++i )
+    {
+        if( m_state_data[i] == data )
+            name = m_state_data_names[i];
+    }
+
+    WriteCommand( AnimCommandType::SetStateData, h, layer );
+    WriteU32( name );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordPlay( Handle h, u16 layer, StringId state_name, float blend_ms )
+{
+    WriteCommand( AnimCommandType::Play, h, layer );
+    WriteU32( state_name );
+    WriteFloat( blend_ms );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordTransition( Handle h, u16 layer, StringId transition_name )
+{
+    WriteCommand( AnimCommandType::Transition, h, layer );
+    WriteU32( transition_name );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordStop( Handle h, u16 layer )
+{
+    WriteCommand( AnimCommandType::Stop, h, layer );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordPause( Handle h, u16 layer )
+{
+    WriteCommand( AnimCommandType::Pause, h, layer );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordResume( Handle h, u16 layer )
+{
+    WriteCommand( AnimCommandType::Resume, h, layer );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordSetNodeFactor( Handle h, u16 layer, StringId factor_name, float value )
+{
+    WriteCommand( AnimCommandType::SetNodeFactor, h, layer );
+    WriteU32( factor_name );
+    WriteFloat( value );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordSetBlendFactor( Handle h, u16 layer, float value )
+{
+    WriteCommand( AnimCommandType::SetBlendFactor, h, layer );
+    WriteFloat( value );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordSetLayerType( Handle h, u16 layer, u32 type )
+{
+    WriteCommand( AnimCommandType::SetLayerType, h, layer );
+    WriteU32( type );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordPlayClip( Handle h, u16 layer, StringId clip_name, float local_time_ms, float blend_ms, bool looped )
+{
+    WriteCommand( AnimCommandType::PlayClip, h, layer );
+    WriteU32( clip_name );
+    WriteFloat( local_time_ms );
+    WriteFloat( blend_ms );
+    WriteU32( looped ? 1 : 0 );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimRecorder::RecordUpdate( float delta_ms )
+{
+    WriteCommand( AnimCommandType::Update, (Handle)-1, 0 );
+    WriteFloat( delta_ms );
+
+    m_frame++;
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/core/StringId.h"
+#include "engine/core/ObjectArray.h"
+#include "engine/animation/AnimCommand.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class AnimStates;
+
+// AnimationSystem settings affecting evaluation, stored in log header (plain data, written as is).
+struct AnimRecordSettings
+{
+    AnimRecordSettings();
+
+    u32 worker_count;
+    u32 batch_size;
+
+    float prune_epsilon;
+
+    // baked palettes frame rate (0 if baking is disabled).
+    float baked_frames_per_second;
+    u32 baked_interpolate;
+
+    u32 sleeping_enabled;
+    u32 instance_batching;
+    u32 compaction_interval;
+
+    u32 bounds_enabled;
+    u32 hit_shapes_enabled;
+    float bounds_padding;
+};
+
+// records externally driven AnimationSystem calls into a compact binary log.
+// log layout: header (magic, version, AnimRecordSettings), then commands: u8 type, u32 frame, u32 controller,
+// u8 layer, type specific payload.
+// assets are identified by name (skeleton name, registered state data name), so the log can be replayed headless.
+class AnimRecorder
+{
+public:
+    // 'ANRC'
+    static const u32 Magic = 0x43524e41;
+    static const u32 Version = 2;
+
+public:
+    AnimRecorder();
+    ~AnimRecorder();
+
+    // clears the log and starts at frame 0. header gets default settings.
+    void Reset();
+
+    // overwrites settings in log header. called by AnimationSystem::StartRecording.
+    void RecordSettings( const AnimRecordSettings& settings );
+
+    // state data has no name of its own. unregistered state data is recorded as 0.
+    void RegisterStateData( AnimStates* data, StringId name );
+
+    inline const u8* GetData() const { return m_data; }
+
+    inline u32 GetSize() const { return m_size; }
+
+    inline u32 GetFrame() const { return m_frame; }
+
+public:
+    void RecordCreateController( Handle h, StringId skeleton_name, u32 layer_count );
+    void RecordDestroyController( Handle h );
+    void RecordSetStateData( Handle h, u16 layer, AnimStates* data );
+    void RecordPlay( Handle h, u16 layer, StringId state_name, float blend_ms );
+    void RecordTransition( Handle h, u16 layer, StringId transition_name );
+    void RecordStop( Handle h, u16 layer );
+    void RecordPause( Handle h, u16 layer );
+    void RecordResume( Handle h, u16 layer );
+    void RecordSetNodeFactor( Handle h, u16 layer, StringId factor_name, float value );
+    void RecordSetBlendFactor( Handle h, u16 layer, float value );
+    void RecordSetLayerType( Handle h, u16 layer, u32 type );
+    void RecordPlayClip( Handle h, u16 layer, StringId clip_name, float local_time_ms, float blend_ms, bool looped );
+
+    // advances frame counter.
+    void RecordUpdate( float delta_ms );
+
+private:
+    void WriteCommand( AnimCommandType::Enum type, Handle h, u16 layer );
+    void Write( const void* data, u32 size );
+
+    inline void WriteU32( u32 value ) { Write( &value, sizeof(value) ); }
+    inline void WriteFloat( float value ) { Write( &value, sizeof(value) ); }
+
+private:
+    // log data.
+    u8* m_data;
+    u32 m_size;
+    u32 m_capacity;
+
+    // current frame (number of recorded updates).
+    u32 m_frame;
+
+    // registered state data names.
+    AnimStates** m_state_data;
+    StringId* m_state_data_names;
+    u32 m_state_data_count;
+    u32 m_state_data_capacity;
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,344 @@
+#include "engine/animation/AnimReplay.h"
+#include "engine/animation/AnimRecorder.h"
+#include "engine/animation/AnimationSystem.h"
+#include "engine/animation/Skeleton.h"
+#include <unordered_map>
+#include <chrono>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// sequential log reader.
+class AnimLogReader
+{
+public:
+    AnimLogReader( const u8* data, u32 size ) : m_data(data), m_size(size), m_pos(0) {}
+
+    inline bool IsEnd() const { return m_pos >= m_size; }
+
+    template<typename T>
+    inline bool Read( T& value )
+    {
+        if( m_pos + sizeof(T) > m_size )
+            return false;
+
+        memcpy( &value, m_data + m_pos, sizeof(T) );
+        m_pos += sizeof(T);
+        return true;
+    }
+
+private:
+    const u8* m_data;
+    u32 m_size;
+    u32 m_pos;
+};
+
+//---------------------------------------------------------------------------------------
+
+static double ElapsedMs( const std::chrono::steady_clock::time_point& from, const std::chrono::steady_clock::time_point& to )
+{
+    return std::chrono::duration<double, std::milli>( to - from ).count();
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimReplay::AnimReplay()
+{
+
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimReplay::RegisterSkeleton( Skeleton* skeleton )
+{
+    m_skeletons.push_back( skeleton );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimReplay::RegisterStateData( StringId name, AnimStates* data )
+{
+    m_state_data_names.push_back( name );
+    m_state_data.push_back( data );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimReplay::RegisterClip( AnimationClip* clip )
+{
+    m_clips.push_back( clip );
+}
+
+//---------------------------------------------------------------------------------------
+
+Skeleton* AnimReplay::FindSkeleton( StringId name ) const
+{
+    for( size_t i = 0; i < m_skeletons.size(); ++i )
+    {
+        if( m_skeletons[i]->GetName() == name )
+            return m_skeletons[i];
+    }
+
+    return nullptr;
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimStates* AnimReplay::FindStateData( StringId name ) const
+{
+    for( size_t i = 0; i < m_state_data.size(); ++i )
+    {
+        if( m_state_data_names[i] == name )
+            return m_state_data[i];
+    }
+
+    return nullptr;
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimationClip* AnimReplay::FindClip( StringId name ) const
+{
+    for( size_t i = 0; i < m_clips.size(); ++i )
+    {
+        if( m_clips[i]->GetName() == name )
+            return m_clips[i];
+    }
+
+    return nullptr;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimReplay::Run( const u8* data, u32 size, u32 max_controller_count, u32 worker_count, AnimReplayReport& report )
+{
+    memset( &report, 0, sizeof(report) );
+
+    AnimLogReader reader( data, size );
+
+    u32 magic = 0, version = 0;
+    if( !reader.Read(magic) || !reader.Read(version) || magic != AnimRecorder::Magic || version != AnimRecorder::Version )
+        return false;
+
+    AnimRecordSettings settings;
+    if( !reader.Read(settings) )
+        return false;
+
+    // replayed frames run with recorded settings, so the checksum matches the recording session.
+    AnimationSystem system( max_controller_count );
+    system.SetWorkerCount( worker_count > 0 ? worker_count : settings.worker_count );
+    system.SetBatchSize( settings.batch_size );
+    system.SetPruneEpsilon( settings.prune_epsilon );
+    system.EnableBakedPalettes( settings.baked_frames_per_second, settings.baked_interpolate != 0 );
+    system.SetSleepingEnabled( settings.sleeping_enabled != 0 );
+    system.SetInstanceBatching( settings.instance_batching != 0 );
+    system.SetCompactionInterval( settings.compaction_interval );
+    system.EnableBounds( settings.bounds_enabled != 0, settings.hit_shapes_enabled != 0, settings.bounds_padding );
+
+    // recorded handle -> replay handle.
+    std::unordered_map<u32, Handle> handles;
+
+    // recorded handles of live controllers in creation order.
+    std::vector<u32> live_controllers;
+
+    while( !reader.IsEnd() )
+    {
+        u8 type = 0, layer_index = 0;
+        u32 frame = 0, recorded_handle = 0;
+
+        if( !reader.Read(type) || !reader.Read(frame) || !reader.Read(recorded_handle) || !reader.Read(layer_index) )
+            return false;
+
+        report.command_count++;
+
+        AnimController* controller = nullptr;
+
+        if( type != AnimCommandType::CreateController && type != AnimCommandType::Update )
+        {
+            std::unordered_map<u32, Handle>::iterator it = handles.find( recorded_handle );
+
+            if( it == handles.end() )
+                return false;
+
+            controller = &system.GetController( it->second );
+
+            if( type != AnimCommandType::DestroyController && layer_index >= controller->GetLayerCount() )
+                return false;
+        }
+
+        switch( type )
+        {
+            case AnimCommandType::CreateController:
+            {
+                StringId skeleton_name;
+                u32 layer_count;
+
+                if( !reader.Read(skeleton_name) || !reader.Read(layer_count) )
+                    return false;
+
+                Skeleton* skeleton = FindSkeleton( skeleton_name );
+
+                if( !skeleton )
+                    return false;
+
+                Handle h = system.CreateController( skeleton, layer_count );
+
+                if( h == (Handle)-1 )
+                    return false;
+
+                handles[recorded_handle] = h;
+                live_controllers.push_back( recorded_handle );
+            }
+            break;
+            case AnimCommandType::DestroyController:
+            {
+                system.DestroyController( handles[recorded_handle] );
+                handles.erase( recorded_handle );
+
+                for( size_t i = 0; i < live_controllers.size(); ++i )
+                {
+                    if( live_controllers[i] == recorded_handle )
+                    {
+                        live_controllers.erase( live_controllers.begin() + i );
+                        break;
+                    }
+                }
+            }
+            break;
+            case AnimCommandType::SetStateData:
+            {
+                StringId name;
+                if( !reader.Read(name) )
+                    return false;
+
+                controller->GetLayer(layer_index).SetStateData( FindStateData(name) );
+            }
+            break;
+            case AnimCommandType::Play:
+            {
+                StringId state_name;
+                float blend_ms;
+                if( !reader.Read(state_name) || !reader.Read(blend_ms) )
+                    return false;
+
+                controller->GetLayer(layer_index).Play( state_name, blend_ms );
+            }
+            break;
+            case AnimCommandType::Transition:
+            {
+                StringId transition_name;
+                if( !reader.Read(transition_name) )
+                    return false;
+
+                controller->GetLayer(layer_index).Transition( transition_name );
+            }
+            break;
+            case AnimCommandType::Stop:
+                controller->GetLayer(layer_index).Stop();
+                break;
+            case AnimCommandType::Pause:
+                controller->GetLayer(layer_index).Pause();
+                break;
+            case AnimCommandType::Resume:
+                controller->GetLayer(layer_index).Resume();
+                break;
+            case AnimCommandType::SetNodeFactor:
+            {
+                StringId factor_name;
+                float value;
+                if( !reader.Read(factor_name) || !reader.Read(value) )
+                    return false;
+
+                controller->GetLayer(layer_index).SetNodeFactor( factor_name, value );
+            }
+            break;
+            case AnimCommandType::SetBlendFactor:
+            {
+                float value;
+                if( !reader.Read(value) )
+                    return false;
+
+                controller->GetLayer(layer_index).SetBlendFactor( value );
+            }
+            break;
+            case AnimCommandType::SetLayerType:
+            {
+                u32 layer_type;
+                if( !reader.Read(layer_type) )
+                    return false;
+
+                controller->GetLayer(layer_index).SetType( (LayerType::Enum)layer_type );
+            }
+            break;
+            case AnimCommandType::PlayClip:
+            {
+                StringId clip_name;
+                float local_time_ms;
+                float blend_ms;
+                u32 looped;
+                if( !reader.Read(clip_name) || !reader.Read(local_time_ms) || !reader.Read(blend_ms) || !reader.Read(looped) )
+                    return false;
+
+                controller->GetLayer(layer_index).PlayClip( FindClip(clip_name), local_time_ms, blend_ms, looped != 0 );
+            }
+            break;
+            case AnimCommandType::Update:
+            {
+                float delta_ms;
+                if( !reader.Read(delta_ms) )
+                    return false;
+
+                std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+                system.Update( delta_ms );
+                std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+                system.LocalPoseCalculation();
+                std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+                system.GlobalPoseCalculation();
+                std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+                system.MatrixPaletteGeneration();
+                std::chrono::steady_clock::time_point t4 = std::chrono::steady_clock::now();
+
+                report.stage_ms[AnimStage::Update] += ElapsedMs( t0, t1 );
+                report.stage_ms[AnimStage::LocalPose] += ElapsedMs( t1, t2 );
+                report.stage_ms[AnimStage::GlobalPose] += ElapsedMs( t2, t3 );
+                report.stage_ms[AnimStage::Palette] += ElapsedMs( t3, t4 );
+                report.total_ms += ElapsedMs( t0, t4 );
+
+                report.frame_count++;
+            }
+            break;
+            default:
+                return false;
+        }
+    }
+
+    // FNV-1a over final palettes.
+    u64 hash = 14695981039346656037ULL;
+
+    for( size_t i = 0; i < live_controllers.size(); ++i )
+    {
+        AnimController& controller = system.GetController( handles[live_controllers[i]] );
+
+        const u8* bytes = (const u8*)controller.GetSkinningPalette();
+        u32 byte_count = controller.GetSkeleton()->GetJointCount() * sizeof(Matrix4x4);
+
+        for( u32 b = 0; b < byte_count; ++b )
+        {
+            hash ^= bytes[b];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    report.palette_checksum = hash;
+
+    // release what is left before the system goes away.
+    for( size_t i = 0; i < live_controllers.size(); ++i )
+        system.DestroyController( handles[live_controllers[i]] );
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/core/StringId.h"
+#include "engine/animation/AnimStats.h"
+#include <vector>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class Skeleton;
+class AnimStates;
+class AnimationClip;
+
+// results of a replayed AnimRecorder log.
+struct AnimReplayReport
+{
+    // number of replayed updates.
+    u32 frame_count;
+
+    // number of replayed commands (including updates).
+    u32 command_count;
+
+    // wall time of every stage summed over all frames, in milliseconds.
+    double stage_ms[AnimStage::Count];
+
+    // wall time of all stages, in milliseconds.
+    double total_ms;
+
+    // FNV-1a hash of final skinning palettes of all live controllers (creation order).
+    u64 palette_checksum;
+};
+
+//---------------------------------------------------------------------------------------
+
+// re-runs AnimRecorder log headless on a fresh AnimationSystem.
+// every recorded update runs all frame stages, so real sessions can be used as benchmarks.
+class AnimReplay
+{
+public:
+    AnimReplay();
+
+    // skeletons are matched with the log by name.
+    void RegisterSkeleton( Skeleton* skeleton );
+
+    // state data is matched with the log by name given to AnimRecorder::RegisterStateData.
+    void RegisterStateData( StringId name, AnimStates* data );
+
+    // clips played by AnimLayer::PlayClip are matched with the log by clip name.
+    void RegisterClip( AnimationClip* clip );
+
+    // applies settings recorded in log header. worker_count overrides recorded worker count (0 keeps it).
+    // returns false if log is invalid or references unknown skeleton.
+    bool Run( const u8* data, u32 size, u32 max_controller_count, u32 worker_count, AnimReplayReport& report );
+
+private:
+    Skeleton* FindSkeleton( StringId name ) const;
+    AnimStates* FindStateData( StringId name ) const;
+    AnimationClip* FindClip( StringId name ) const;
+
+private:
+    std::vector<Skeleton*> m_skeletons;
+
+    std::vector<StringId> m_state_data_names;
+    std::vector<AnimStates*> m_state_data;
+
+    std::vector<AnimationClip*> m_clips;
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
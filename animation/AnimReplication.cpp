@@ -0,0 +1,624 @@
+#include "engine/animation/AnimReplication.h"
+#include "engine/animation/AnimController.h"
+#include "engine/animation/AnimStates.h"
+#include <string.h>
+#include <math.h>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// bits of snapshot header fields.
+static const u32 SequenceBits = 16;
+static const u32 LayerCountBits = 4;
+static const u32 FlagBits = 6;
+static const u32 FactorCountBits = 5;
+static const u32 HalfBits = 16;
+
+// varying length values store their bit count - 1 in 5 bits.
+static const u32 LengthBits = 5;
+
+static_assert( AnimNetMaxLayers < (1u << LayerCountBits), "layer count does not fit" );
+static_assert( AnimNetMaxFactors < (1u << FactorCountBits), "factor count does not fit" );
+
+//---------------------------------------------------------------------------------------
+
+// scalar fp16 conversions (round to nearest even, overflow goes to infinity).
+static u16 FloatToHalf( float value )
+{
+    u32 bits;
+    memcpy( &bits, &value, sizeof(bits) );
+
+    u32 sign = (bits >> 16) & 0x8000;
+    u32 exponent = (bits >> 23) & 0xff;
+    u32 mantissa = bits & 0x7fffff;
+
+    // nan/infinity.
+    if( exponent == 0xff )
+        return (u16)( sign | 0x7c00 | (mantissa ? 0x200 : 0) );
+
+    s32 half_exponent = (s32)exponent - 127 + 15;
+
+    // overflow.
+    if( half_exponent >= 31 )
+        return (u16)( sign | 0x7c00 );
+
+    // denormal or zero.
+    if( half_exponent <= 0 )
+    {
+        if( half_exponent < -10 )
+            return (u16)sign;
+
+        mantissa |= 0x800000;
+
+        u32 shift = (u32)(14 - half_exponent);
+        u32 half_mantissa = mantissa >> shift;
+        u32 rest = mantissa & ((1u << shift) - 1);
+        u32 halfway = 1u << (shift - 1);
+
+        if( rest > halfway || (rest == halfway && (half_mantissa & 1)) )
+            half_mantissa++;
+
+        return (u16)( sign | half_mantissa );
+    }
+
+    u32 half = sign | ((u32)half_exponent << 10) | (mantissa >> 13);
+    u32 rest = mantissa & 0x1fff;
+
+    // round to nearest even. carry into exponent is correct (up to infinity).
+    if( rest > 0x1000 || (rest == 0x1000 && (half & 1)) )
+        half++;
+
+    return (u16)half;
+}
+
+//---------------------------------------------------------------------------------------
+
+static float HalfToFloat( u16 value )
+{
+    u32 sign = ((u32)value & 0x8000) << 16;
+    u32 exponent = ((u32)value >> 10) & 0x1f;
+    u32 mantissa = (u32)value & 0x3ff;
+    u32 bits;
+
+    if( exponent == 0x1f )
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if( exponent == 0 )
+    {
+        if( mantissa == 0 )
+        {
+            bits = sign;
+        }
+        else
+        {
+            // normalize denormal.
+            exponent = 127 - 15 + 1;
+
+            while( !(mantissa & 0x400) )
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    }
+    else
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy( &result, &bits, sizeof(result) );
+    return result;
+}
+
+//---------------------------------------------------------------------------------------
+static inline s32 QuantizeTime( float time_ms )
+{
+    return (s32)floorf( time_ms / AnimNetTimeStepMs + 0.5f );
+}
+
+//---------------------------------------------------------------------------------------
+
+static inline float DequantizeTime( s32 time )
+{
+    return time * AnimNetTimeStepMs;
+}
+
+//---------------------------------------------------------------------------------------
+
+// changed bit, then zigzag encoded difference with its bit length. small differences (time advancing
+// since the baseline) take a few bits.
+static void WriteDelta( AnimBitWriter& writer, s32 value, s32 base )
+{
+    if( value == base )
+    {
+        writer.Write( 0, 1 );
+        return;
+    }
+
+    s32 delta = (s32)((u32)value - (u32)base);
+    u32 zigzag = ((u32)delta << 1) ^ (u32)(delta >> 31);
+
+    u32 bits = 1;
+    while( bits < 32 && (zigzag >> bits) != 0 )
+        bits++;
+
+    writer.Write( 1, 1 );
+    writer.Write( bits - 1, LengthBits );
+    writer.Write( zigzag, bits );
+}
+
+//---------------------------------------------------------------------------------------
+
+static s32 ReadDelta( AnimBitReader& reader, s32 base )
+{
+    if( reader.Read( 1 ) == 0 )
+        return base;
+
+    u32 bits = reader.Read( LengthBits ) + 1;
+    u32 zigzag = reader.Read( bits );
+    s32 delta = (s32)((zigzag >> 1) ^ (0u - (zigzag & 1)));
+
+    return (s32)((u32)base + (u32)delta);
+}
+
+//---------------------------------------------------------------------------------------
+
+// changed bit, then value.
+static inline void WriteChanged( AnimBitWriter& writer, u32 value, u32 base, u32 bits )
+{
+    writer.Write( value != base ? 1 : 0, 1 );
+
+    if( value != base )
+        writer.Write( value, bits );
+}
+
+//---------------------------------------------------------------------------------------
+
+static inline u32 ReadChanged( AnimBitReader& reader, u32 base, u32 bits )
+{
+    return reader.Read( 1 ) ? reader.Read( bits ) : base;
+}
+
+//---------------------------------------------------------------------------------------
+
+static void WriteTree( AnimBitWriter& writer, const AnimNetTreeState& tree, const AnimNetTreeState& base )
+{
+    bool source_changed = tree.state != base.state || tree.clip != base.clip;
+    writer.Write( source_changed ? 1 : 0, 1 );
+
+    if( source_changed )
+    {
+        writer.Write( tree.state, 32 );
+        writer.Write( tree.clip, 32 );
+    }
+
+    WriteDelta( writer, tree.elapsed, base.elapsed );
+    WriteChanged( writer, tree.factor_count, base.factor_count, FactorCountBits );
+
+    for( u32 i = 0; i < tree.factor_count; ++i )
+        WriteChanged( writer, tree.factors[i], i < base.factor_count ? base.factors[i] : 0, HalfBits );
+}
+
+//---------------------------------------------------------------------------------------
+
+static bool ReadTree( AnimBitReader& reader, const AnimNetTreeState& base, AnimNetTreeState& tree )
+{
+    if( reader.Read( 1 ) )
+    {
+        tree.state = reader.Read( 32 );
+        tree.clip = reader.Read( 32 );
+    }
+    else
+    {
+        tree.state = base.state;
+        tree.clip = base.clip;
+    }
+
+    tree.elapsed = ReadDelta( reader, base.elapsed );
+    tree.factor_count = ReadChanged( reader, base.factor_count, FactorCountBits );
+
+    if( tree.factor_count > AnimNetMaxFactors )
+        return false;
+
+    for( u32 i = 0; i < tree.factor_count; ++i )
+        tree.factors[i] = (u16)ReadChanged( reader, i < base.factor_count ? base.factors[i] : 0, HalfBits );
+
+    for( u32 i = tree.factor_count; i < AnimNetMaxFactors; ++i )
+        tree.factors[i] = 0;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------
+
+AnimNetSnapshot::AnimNetSnapshot()
+{
+    Clear();
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimNetSnapshot::Clear()
+{
+    memset( this, 0, sizeof(*this) );
+}
+
+//---------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------
+
+AnimBitWriter::AnimBitWriter( u8* buffer, u32 capacity )
+: m_buffer(buffer)
+, m_capacity(capacity)
+, m_size(0)
+, m_scratch(0)
+, m_scratch_bits(0)
+{
+
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBitWriter::Write( u32 value, u32 bits )
+{
+    ENGINE_ASSERT(bits <= 32, "too many bits");
+
+    m_scratch |= ((u64)value & ((1ull << bits) - 1)) << m_scratch_bits;
+    m_scratch_bits += bits;
+
+    while( m_scratch_bits >= 8 )
+    {
+        if( m_size < m_capacity )
+            m_buffer[m_size] = (u8)m_scratch;
+
+        m_size++;
+        m_scratch >>= 8;
+        m_scratch_bits -= 8;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimBitWriter::Flush()
+{
+    if( m_scratch_bits > 0 )
+        Write( 0, 8 - m_scratch_bits );
+}
+
+//---------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------
+
+AnimBitReader::AnimBitReader( const u8* data, u32 size )
+: m_data(data)
+, m_size(size)
+, m_position(0)
+, m_scratch(0)
+, m_scratch_bits(0)
+, m_overflow(false)
+{
+
+}
+
+//---------------------------------------------------------------------------------------
+
+u32 AnimBitReader::Read( u32 bits )
+{
+    ENGINE_ASSERT(bits <= 32, "too many bits");
+
+    while( m_scratch_bits < bits )
+    {
+        u8 byte = 0;
+
+        if( m_position < m_size )
+            byte = m_data[m_position++];
+        else
+            m_overflow = true;
+
+        m_scratch |= (u64)byte << m_scratch_bits;
+        m_scratch_bits += 8;
+    }
+
+    u32 value = (u32)(m_scratch & ((1ull << bits) - 1));
+    m_scratch >>= bits;
+    m_scratch_bits -= bits;
+
+    return value;
+}
+
+//---------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------
+
+AnimReplication::AnimReplication()
+{
+
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimReplication::RegisterClip( AnimationClip* clip )
+{
+    if( clip && !FindClip( clip->GetName() ) )
+        m_clips.push_back( clip );
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimationClip* AnimReplication::FindClip( StringId name ) const
+{
+    for( size_t i = 0; i < m_clips.size(); ++i )
+    {
+        if( m_clips[i]->GetName() == name )
+            return m_clips[i];
+    }
+
+    return nullptr;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimReplication::CaptureTree( const AnimBlendTree& tree, StringId state, float clock, AnimNetTreeState& out, bool& looped )
+{
+    const Animation* animation = tree.GetFirstAnimation();
+
+    out.state = state;
+    out.clip = state == 0 && animation ? animation->GetClip()->GetName() : 0;
+    out.elapsed = animation ? QuantizeTime( clock - animation->GetStartTime() ) : 0;
+    looped = animation ? animation->IsLooped() : false;
+
+    float factors[AnimNetMaxFactors];
+    u16 factor_count = tree.GetFactors( factors, AnimNetMaxFactors );
+    ENGINE_ASSERT(factor_count <= AnimNetMaxFactors, "too many blend tree factors to replicate");
+
+    out.factor_count = factor_count < AnimNetMaxFactors ? factor_count : AnimNetMaxFactors;
+
+    for( u32 i = 0; i < out.factor_count; ++i )
+        out.factors[i] = FloatToHalf( factors[i] );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimReplication::Capture( AnimController& controller, u16 sequence, AnimNetSnapshot& snapshot )
+{
+    ENGINE_ASSERT(controller.GetLayerCount() <= AnimNetMaxLayers, "too many layers to replicate");
+
+    snapshot.Clear();
+    snapshot.sequence = sequence;
+    snapshot.layer_count = controller.GetLayerCount() < AnimNetMaxLayers ? controller.GetLayerCount() : AnimNetMaxLayers;
+
+    for( u32 l = 0; l < snapshot.layer_count; ++l )
+    {
+        AnimLayer& layer = controller.GetLayer( (u16)l );
+        AnimNetLayerState& out = snapshot.layers[l];
+
+        out.blend_factor = FloatToHalf( layer.m_blend_factor );
+        out.flags |= layer.m_type == LayerType::Additive ? AnimNetFlags::Additive : 0;
+
+        if( !layer.Active() )
+            continue;
+
+        bool looped = false;
+
+        out.flags |= AnimNetFlags::Active;
+        out.flags |= layer.Paused() ? AnimNetFlags::Paused : 0;
+
+        CaptureTree( layer.m_current_tree, layer.m_current_state, layer.m_global_clock, out.current, looped );
+        out.flags |= looped ? AnimNetFlags::Looped : 0;
+
+        if( layer.IsCrossfading() )
+        {
+            out.flags |= AnimNetFlags::Crossfading;
+            out.crossfade_timer = QuantizeTime( layer.m_crossfade_timer );
+            out.crossfade_duration = QuantizeTime( layer.m_crossfade_duration );
+
+            CaptureTree( layer.m_previous_tree, layer.m_previous_state, layer.m_global_clock, out.previous, looped );
+            out.flags |= looped ? AnimNetFlags::PreviousLooped : 0;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimReplication::Write( const AnimNetSnapshot& snapshot, const AnimNetSnapshot* baseline, AnimBitWriter& writer )
+{
+    static const AnimNetSnapshot empty;
+    const AnimNetSnapshot& base = baseline ? *baseline : empty;
+
+    writer.Write( snapshot.sequence, SequenceBits );
+    writer.Write( baseline ? 1 : 0, 1 );
+
+    if( baseline )
+        writer.Write( baseline->sequence, SequenceBits );
+
+    writer.Write( snapshot.layer_count, LayerCountBits );
+
+    for( u32 l = 0; l < snapshot.layer_count; ++l )
+    {
+        const AnimNetLayerState& layer = snapshot.layers[l];
+        const AnimNetLayerState& base_layer = base.layers[l];
+
+        WriteChanged( writer, layer.flags, base_layer.flags, FlagBits );
+        WriteChanged( writer, layer.blend_factor, base_layer.blend_factor, HalfBits );
+
+        if( !(layer.flags & AnimNetFlags::Active) )
+            continue;
+
+        WriteTree( writer, layer.current, base_layer.current );
+
+        if( layer.flags & AnimNetFlags::Crossfading )
+        {
+            WriteDelta( writer, layer.crossfade_timer, base_layer.crossfade_timer );
+            WriteDelta( writer, layer.crossfade_duration, base_layer.crossfade_duration );
+            WriteTree( writer, layer.previous, base_layer.previous );
+        }
+    }
+
+    writer.Flush();
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimReplication::PeekBaseline( const u8* data, u32 size, u16& baseline_sequence )
+{
+    AnimBitReader reader( data, size );
+
+    reader.Read( SequenceBits );
+
+    if( !reader.Read( 1 ) )
+        return false;
+
+    baseline_sequence = (u16)reader.Read( SequenceBits );
+
+    return !reader.IsOverflow();
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimReplication::Read( AnimBitReader& reader, const AnimNetSnapshot* baseline, AnimNetSnapshot& snapshot )
+{
+    static const AnimNetSnapshot empty;
+
+    u16 sequence = (u16)reader.Read( SequenceBits );
+    bool has_baseline = reader.Read( 1 ) != 0;
+
+    if( has_baseline != (baseline != nullptr) )
+        return false;
+
+    if( has_baseline && (u16)reader.Read( SequenceBits ) != baseline->sequence )
+        return false;
+
+    // snapshot may be the baseline itself.
+    AnimNetSnapshot base = baseline ? *baseline : empty;
+
+    snapshot.Clear();
+    snapshot.sequence = sequence;
+    snapshot.layer_count = reader.Read( LayerCountBits );
+
+    if( snapshot.layer_count > AnimNetMaxLayers )
+        return false;
+
+    for( u32 l = 0; l < snapshot.layer_count; ++l )
+    {
+        AnimNetLayerState& layer = snapshot.layers[l];
+        const AnimNetLayerState& base_layer = base.layers[l];
+
+        layer.flags = ReadChanged( reader, base_layer.flags, FlagBits );
+        layer.blend_factor = (u16)ReadChanged( reader, base_layer.blend_factor, HalfBits );
+
+        if( !(layer.flags & AnimNetFlags::Active) )
+            continue;
+
+        if( !ReadTree( reader, base_layer.current, layer.current ) )
+            return false;
+
+        if( layer.flags & AnimNetFlags::Crossfading )
+        {
+            layer.crossfade_timer = ReadDelta( reader, base_layer.crossfade_timer );
+            layer.crossfade_duration = ReadDelta( reader, base_layer.crossfade_duration );
+
+            if( !ReadTree( reader, base_layer.previous, layer.previous ) )
+                return false;
+        }
+    }
+
+    return !reader.IsOverflow();
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimReplication::ApplyTree( AnimLayer& layer, const AnimNetTreeState& state, bool looped, AnimBlendTree& tree ) const
+{
+    if( state.state != 0 )
+    {
+        const AnimStates::State* data = layer.m_state_data ? layer.m_state_data->FindState( state.state ) : nullptr;
+
+        if( !data || !data->GetBlendTree().IsValid() )
+            return false;
+
+        tree = data->GetBlendTree();
+    }
+    else
+    {
+        AnimationClip* clip = FindClip( state.clip );
+
+        if( !clip )
+            return false;
+
+        if( tree.GetCapacity() == 0 )
+            tree.Resize(1);
+
+        tree.SetClip( clip, looped, 1.f );
+    }
+
+    tree.Start( layer.m_global_clock - DequantizeTime( state.elapsed ) );
+
+    float factors[AnimNetMaxFactors];
+
+    for( u32 i = 0; i < state.factor_count; ++i )
+        factors[i] = HalfToFloat( state.factors[i] );
+
+    tree.SetFactors( factors, (u16)state.factor_count );
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimReplication::Apply( const AnimNetSnapshot& snapshot, AnimController& controller ) const
+{
+    u32 layer_count = snapshot.layer_count < controller.GetLayerCount() ? snapshot.layer_count : controller.GetLayerCount();
+
+    for( u32 l = 0; l < layer_count; ++l )
+    {
+        AnimLayer& layer = controller.GetLayer( (u16)l );
+        const AnimNetLayerState& state = snapshot.layers[l];
+
+        layer.Wake();
+
+        layer.m_type = (state.flags & AnimNetFlags::Additive) ? LayerType::Additive : LayerType::Lerp;
+        layer.m_blend_factor = HalfToFloat( state.blend_factor );
+        layer.m_paused = (state.flags & AnimNetFlags::Paused) != 0;
+
+        layer.m_previous_tree.Clear();
+        layer.m_crossfade_type = BlendType::None;
+        layer.m_crossfade_duration = 0.f;
+        layer.m_crossfade_timer = 0.f;
+
+        if( !(state.flags & AnimNetFlags::Active) )
+        {
+            layer.m_current_tree.Clear();
+            continue;
+        }
+
+        if( !ApplyTree( layer, state.current, (state.flags & AnimNetFlags::Looped) != 0, layer.m_current_tree ) )
+            return false;
+
+        layer.m_current_state = state.current.state;
+
+        // cross-fades shorter than a time step end immediately.
+        if( (state.flags & AnimNetFlags::Crossfading) && state.crossfade_duration > 0 )
+        {
+            if( !ApplyTree( layer, state.previous, (state.flags & AnimNetFlags::PreviousLooped) != 0, layer.m_previous_tree ) )
+                return false;
+
+            layer.m_previous_state = state.previous.state;
+            layer.m_crossfade_type = BlendType::Linear;
+            layer.m_crossfade_duration = DequantizeTime( state.crossfade_duration );
+            layer.m_crossfade_timer = DequantizeTime( state.crossfade_timer );
+        }
+
+        // restarted trees have no valid sample cursors.
+        layer.m_current_tree.UpdateCursors( layer.m_global_clock );
+        layer.m_previous_tree.UpdateCursors( layer.m_global_clock );
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/core/StringId.h"
+#include <vector>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class AnimController;
+class AnimLayer;
+class AnimBlendTree;
+class AnimationClip;
+
+// maximum number of replicated layers per controller and factors per blend tree.
+static const u32 AnimNetMaxLayers = 8;
+static const u32 AnimNetMaxFactors = 16;
+
+// time quantization of tree start times and cross-fades in milliseconds.
+static const float AnimNetTimeStepMs = 0.125f;
+
+// enumerates replicated layer flags.
+namespace AnimNetFlags{
+    enum Enum{
+        Active = 1 << 0,
+        Paused = 1 << 1,
+        Crossfading = 1 << 2,
+        Additive = 1 << 3,
+
+        // looping of single clip trees (AnimLayer::PlayClip).
+        Looped = 1 << 4,
+        PreviousLooped = 1 << 5
+    };
+}
+
+//---------------------------------------------------------------------------------------
+
+// replicated blend tree. times are in AnimNetTimeStepMs units.
+struct AnimNetTreeState
+{
+    // state name, 0 if tree plays a single clip.
+    StringId state;
+
+    // clip name of single clip tree, 0 otherwise.
+    StringId clip;
+
+    // layer clock - tree start time.
+    s32 elapsed;
+
+    // fp16 node factors in AnimBlendTree::GetFactors order.
+    u16 factors[AnimNetMaxFactors];
+    u32 factor_count;
+};
+
+// replicated layer. previous tree is zeroed unless cross-fading.
+struct AnimNetLayerState
+{
+    // AnimNetFlags bits.
+    u32 flags;
+
+    // fp16 layer blend factor.
+    u16 blend_factor;
+
+    s32 crossfade_timer;
+    s32 crossfade_duration;
+
+    AnimNetTreeState current;
+    AnimNetTreeState previous;
+};
+
+// everything a client needs to reproduce controller pose (given the same skeleton, state data and clips).
+// plain data, so snapshots can be kept per connection as delta baselines.
+struct AnimNetSnapshot
+{
+    AnimNetSnapshot();
+
+    // zeroes all layers, which is also the implicit baseline of the first snapshot.
+    void Clear();
+
+    // set by the sender, used to match delta baseline on the receiver.
+    u16 sequence;
+
+    u32 layer_count;
+    AnimNetLayerState layers[AnimNetMaxLayers];
+};
+
+//---------------------------------------------------------------------------------------
+
+// packs values of given bit width into caller-owned buffer (least significant bits first).
+class AnimBitWriter
+{
+public:
+    AnimBitWriter( u8* buffer, u32 capacity );
+
+    // writes lowest bits (<= 32) of value.
+    void Write( u32 value, u32 bits );
+
+    // writes remaining bits of the last byte. called once after all writes.
+    void Flush();
+
+    // bytes written (including bytes past capacity if overflowed).
+    inline u32 GetByteCount() const { return m_size; }
+
+    // true if data did not fit into buffer.
+    inline bool IsOverflow() const { return m_size > m_capacity; }
+
+private:
+    u8* m_buffer;
+    u32 m_capacity;
+    u32 m_size;
+
+    // bits not written to the buffer yet.
+    u64 m_scratch;
+    u32 m_scratch_bits;
+};
+
+//---------------------------------------------------------------------------------------
+
+// reads values written by AnimBitWriter. reading past the end returns zero bits and sets overflow.
+class AnimBitReader
+{
+public:
+    AnimBitReader( const u8* data, u32 size );
+
+    u32 Read( u32 bits );
+
+    inline bool IsOverflow() const { return m_overflow; }
+
+private:
+    const u8* m_data;
+    u32 m_size;
+    u32 m_position;
+
+    u64 m_scratch;
+    u32 m_scratch_bits;
+
+    bool m_overflow;
+};
+
+//---------------------------------------------------------------------------------------
+
+// compact network replication of controller animation state. instead of joint transforms, the server sends
+// per-layer state names, tree start times, cross-fade progress and fp16 blend tree factors. snapshots are
+// delta encoded against the last snapshot acknowledged by the client and bit packed, so a steady state
+// costs a few bits per layer.
+//
+// server: Capture -> Write( snapshot, last acked snapshot ) -> send. keeps sent snapshots until acked.
+// client: Read( data, acked snapshot of given sequence ) -> Apply. keeps received snapshots as baselines.
+class AnimReplication
+{
+public:
+    AnimReplication();
+
+    // clips played by AnimLayer::PlayClip are matched by clip name on Apply.
+    void RegisterClip( AnimationClip* clip );
+
+    // captures state of all controller layers (at most AnimNetMaxLayers).
+    static void Capture( AnimController& controller, u16 sequence, AnimNetSnapshot& snapshot );
+
+    // writes snapshot as delta against baseline (null if client has no acknowledged snapshot).
+    static void Write( const AnimNetSnapshot& snapshot, const AnimNetSnapshot* baseline, AnimBitWriter& writer );
+
+    // reads snapshot written against the same baseline. returns false if data is invalid or written
+    // against a different baseline sequence.
+    static bool Read( AnimBitReader& reader, const AnimNetSnapshot* baseline, AnimNetSnapshot& snapshot );
+
+    // sequence of the baseline snapshot was written against (false if written without baseline). lets the
+    // client find the baseline before Read.
+    static bool PeekBaseline( const u8* data, u32 size, u16& baseline_sequence );
+
+    // sets layers of controller with matching skeleton and state data. layer clocks are kept, tree start
+    // times are set relative to them. calls are not recorded and have to be made outside of pipelined frames.
+    // returns false if a state or clip is unknown.
+    bool Apply( const AnimNetSnapshot& snapshot, AnimController& controller ) const;
+
+private:
+    static void CaptureTree( const AnimBlendTree& tree, StringId state, float clock, AnimNetTreeState& out, bool& looped );
+
+    bool ApplyTree( AnimLayer& layer, const AnimNetTreeState& state, bool looped, AnimBlendTree& tree ) const;
+
+    AnimationClip* FindClip( StringId name ) const;
+
+private:
+    std::vector<AnimationClip*> m_clips;
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
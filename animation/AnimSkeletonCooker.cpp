@@ -0,0 +1,301 @@
+#include "engine/animation/AnimSkeletonCooker.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// offsets of skeleton arrays relative to the end of skeleton header.
+struct SkeletonLayout
+{
+    size_t joints;
+    size_t hit_shapes;
+    size_t mirror_joints;
+    size_t size;
+};
+
+//---------------------------------------------------------------------------------------
+
+static size_t AlignUp( size_t value, size_t alignment )
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+//---------------------------------------------------------------------------------------
+
+static SkeletonLayout GetLayout( u32 joint_count, u32 hit_shape_count, bool mirror_table )
+{
+    SkeletonLayout layout;
+    
+    // offsets are aligned relative to block start (joint matrices are 16 byte aligned).
+    size_t header = sizeof(Skeleton);
+    
+    layout.joints = AlignUp( header, 16 ) - header;
+    layout.hit_shapes = AlignUp( header + layout.joints + (size_t)joint_count * sizeof(SkeletonJoint), 16 ) - header;
+    layout.mirror_joints = layout.hit_shapes + (size_t)hit_shape_count * sizeof(SkeletonHitShape);
+    layout.size = header + layout.mirror_joints + (mirror_table ? (size_t)joint_count * sizeof(u16) : 0);
+    
+    return layout;
+}
+
+//---------------------------------------------------------------------------------------
+
+Skeleton* AnimSkeletonCooker::Allocate( StringId name, u32 joint_count, u32 hit_shape_count, bool mirror_table )
+{
+    SkeletonLayout layout = GetLayout( joint_count, hit_shape_count, mirror_table );
+    
+    u8* data = new u8[layout.size];
+    memset( data, 0, layout.size );
+    
+    Skeleton* skeleton = (Skeleton*)data;
+    u8* arrays = data + sizeof(Skeleton);
+    
+    skeleton->m_magic = Skeleton::Magic;
+    skeleton->m_version = Skeleton::Version;
+    skeleton->m_name = name;
+    skeleton->m_joint_count = joint_count;
+    skeleton->m_joints = (SkeletonJoint*)( arrays + layout.joints );
+    skeleton->m_hit_shape_count = hit_shape_count;
+    skeleton->m_hit_shapes = hit_shape_count > 0 ? (SkeletonHitShape*)( arrays + layout.hit_shapes ) : nullptr;
+    skeleton->m_mirror_axis = MirrorAxis::X;
+    skeleton->m_mirror_joints = mirror_table ? (u16*)( arrays + layout.mirror_joints ) : nullptr;
+    
+    for( u32 i = 0; i < joint_count; ++i )
+    {
+        skeleton->m_joints[i].m_parent_index = (u32)-1;
+        float* m = skeleton->m_joints[i].m_inv_bind_pose.matrix;
+        m[0] = m[5] = m[10] = m[15] = 1.f;
+        
+        if( mirror_table )
+            skeleton->m_mirror_joints[i] = (u16)i;
+    }
+    
+    return skeleton;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimSkeletonCooker::Free( Skeleton* skeleton )
+{
+    delete [] (u8*)skeleton;
+}
+
+//---------------------------------------------------------------------------------------
+
+size_t AnimSkeletonCooker::GetDataSize( const Skeleton& skeleton )
+{
+    return GetLayout( skeleton.m_joint_count, skeleton.m_hit_shape_count, skeleton.m_mirror_joints != nullptr ).size;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimSkeletonCooker::SetJoint( Skeleton& skeleton, u32 idx, StringId name, u32 parent_index, const Matrix4x4& inv_bind_pose )
+{
+    ENGINE_ASSERT(idx < skeleton.m_joint_count, "index out of bounds");
+    
+    SkeletonJoint& joint = skeleton.m_joints[idx];
+    joint.m_name = name;
+    joint.m_parent_index = parent_index;
+    joint.m_inv_bind_pose = inv_bind_pose;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimSkeletonCooker::SetHitShape( Skeleton& skeleton, u32 idx, const SkeletonHitShape& shape )
+{
+    ENGINE_ASSERT(idx < skeleton.m_hit_shape_count, "index out of bounds");
+    
+    skeleton.m_hit_shapes[idx] = shape;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimSkeletonCooker::SetMirrorTable( Skeleton& skeleton, MirrorAxis::Enum axis, const u16* counterparts )
+{
+    if( !skeleton.m_mirror_joints )
+        return false;
+    
+    for( u32 i = 0; i < skeleton.m_joint_count; ++i )
+    {
+        if( counterparts[i] >= skeleton.m_joint_count || counterparts[counterparts[i]] != i )
+            return false;
+    }
+    
+    skeleton.m_mirror_axis = axis;
+    memcpy( skeleton.m_mirror_joints, counterparts, skeleton.m_joint_count * sizeof(u16) );
+    
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimSkeletonCooker::BuildMirrorTable( Skeleton& skeleton, MirrorAxis::Enum axis, const char* const* joint_names, const char* left_token, const char* right_token )
+{
+    u32 joint_count = skeleton.m_joint_count;
+    u16* counterparts = new u16[joint_count];
+    bool valid = true;
+    
+    for( u32 i = 0; i < joint_count && valid; ++i )
+    {
+        counterparts[i] = (u16)i;
+        
+        std::string name = joint_names[i];
+        size_t left = name.find( left_token );
+        size_t right = name.find( right_token );
+        
+        // swap the token found first.
+        if( left != std::string::npos && (right == std::string::npos || left <= right) )
+            name.replace( left, strlen(left_token), right_token );
+        else if( right != std::string::npos )
+            name.replace( right, strlen(right_token), left_token );
+        else
+            continue;
+        
+        valid = false;
+        
+        for( u32 j = 0; j < joint_count; ++j )
+        {
+            if( j != i && name == joint_names[j] )
+            {
+                counterparts[i] = (u16)j;
+                valid = true;
+                break;
+            }
+        }
+    }
+    
+    valid = valid && SetMirrorTable( skeleton, axis, counterparts );
+    
+    delete [] counterparts;
+    return valid;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimSkeletonCooker::Validate( const Skeleton& skeleton )
+{
+    if( !skeleton.IsCurrentVersion() || skeleton.m_joint_count == 0 || skeleton.m_joint_count > 0xffff )
+        return false;
+    
+    // hierarchy is evaluated in joint order.
+    for( u32 i = 0; i < skeleton.m_joint_count; ++i )
+    {
+        u32 parent = skeleton.m_joints[i].m_parent_index;
+        
+        if( parent != (u32)-1 && parent >= i )
+            return false;
+    }
+    
+    for( u32 i = 0; i < skeleton.m_hit_shape_count; ++i )
+    {
+        if( skeleton.m_hit_shapes[i].joint_index >= skeleton.m_joint_count )
+            return false;
+    }
+    
+    if( skeleton.m_mirror_joints )
+    {
+        if( skeleton.m_mirror_axis > MirrorAxis::Z )
+            return false;
+        
+        for( u32 i = 0; i < skeleton.m_joint_count; ++i )
+        {
+            u16 counterpart = skeleton.m_mirror_joints[i];
+            
+            if( counterpart >= skeleton.m_joint_count || skeleton.m_mirror_joints[counterpart] != i )
+                return false;
+        }
+    }
+    
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+Skeleton* AnimSkeletonCooker::Load( const char* path )
+{
+    FILE* file = fopen( path, "rb" );
+    
+    if( !file )
+        return nullptr;
+    
+    fseek( file, 0, SEEK_END );
+    long file_size = ftell( file );
+    fseek( file, 0, SEEK_SET );
+    
+    if( file_size < (long)sizeof(Skeleton) )
+    {
+        fclose( file );
+        return nullptr;
+    }
+    
+    u8* data = new u8[file_size];
+    size_t read = fread( data, 1, file_size, file );
+    fclose( file );
+    
+    Skeleton* skeleton = (Skeleton*)data;
+    
+    // reject files of other layout versions and files whose arrays point outside of the file.
+    if( read != (size_t)file_size || !skeleton->IsCurrentVersion() || GetDataSize( *skeleton ) > (size_t)file_size )
+    {
+        Free( skeleton );
+        return nullptr;
+    }
+    
+    size_t array_size = file_size - sizeof(Skeleton);
+    
+    if( (size_t)skeleton->m_joints + (size_t)skeleton->m_joint_count * sizeof(SkeletonJoint) > array_size
+       || (skeleton->m_hit_shape_count > 0 && (size_t)skeleton->m_hit_shapes + (size_t)skeleton->m_hit_shape_count * sizeof(SkeletonHitShape) > array_size)
+       || (skeleton->m_mirror_joints && (size_t)skeleton->m_mirror_joints + (size_t)skeleton->m_joint_count * sizeof(u16) > array_size) )
+    {
+        Free( skeleton );
+        return nullptr;
+    }
+    
+    skeleton->FixPointers();
+    
+    if( !Validate( *skeleton ) )
+    {
+        Free( skeleton );
+        return nullptr;
+    }
+    
+    return skeleton;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimSkeletonCooker::Save( const Skeleton& skeleton, const char* path )
+{
+    // repack, so the output layout does not depend on the source.
+    Skeleton* copy = Allocate( skeleton.m_name, skeleton.m_joint_count, skeleton.m_hit_shape_count, skeleton.m_mirror_joints != nullptr );
+    
+    copy->m_mirror_axis = skeleton.m_mirror_axis;
+    memcpy( copy->m_joints, skeleton.m_joints, (size_t)skeleton.m_joint_count * sizeof(SkeletonJoint) );
+    
+    if( skeleton.m_hit_shape_count > 0 )
+        memcpy( copy->m_hit_shapes, skeleton.m_hit_shapes, (size_t)skeleton.m_hit_shape_count * sizeof(SkeletonHitShape) );
+    
+    if( skeleton.m_mirror_joints )
+        memcpy( copy->m_mirror_joints, skeleton.m_mirror_joints, (size_t)skeleton.m_joint_count * sizeof(u16) );
+    
+    size_t size = GetDataSize( *copy );
+    copy->BreakPointers();
+    
+    bool result = false;
+    FILE* file = fopen( path, "wb" );
+    
+    if( file )
+    {
+        result = fwrite( copy, 1, size, file ) == size;
+        result = (fclose( file ) == 0) && result;
+    }
+    
+    Free( copy );
+    return result;
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/animation/Skeleton.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// offline skeleton authoring used by content build. skeletons are kept in the same relocatable
+// format runtime loads (header followed by joints, hit shapes and mirror table, pointers stored as offsets).
+class AnimSkeletonCooker
+{
+public:
+    // loads relocatable skeleton binary of current version. returned skeleton has fixed pointers and must be
+    // released with Free.
+    static Skeleton* Load( const char* path );
+    
+    // writes skeleton as relocatable binary.
+    static bool Save( const Skeleton& skeleton, const char* path );
+    
+    // allocates skeleton with all arrays in a single block. joints and hit shapes are zeroed and have to be
+    // set with SetJoint/SetHitShape. mirror table (if requested) maps every joint onto itself.
+    static Skeleton* Allocate( StringId name, u32 joint_count, u32 hit_shape_count, bool mirror_table );
+    
+    static void Free( Skeleton* skeleton );
+    
+    // size of skeleton block (header + arrays).
+    static size_t GetDataSize( const Skeleton& skeleton );
+    
+    // parent_index is (u32)-1 for root joints. parents have to precede their children.
+    static void SetJoint( Skeleton& skeleton, u32 idx, StringId name, u32 parent_index, const Matrix4x4& inv_bind_pose );
+    
+    static void SetHitShape( Skeleton& skeleton, u32 idx, const SkeletonHitShape& shape );
+    
+    // sets mirror table of skeleton allocated with one. returns false if counterparts are out of range or
+    // not symmetric (counterpart of counterpart has to be the joint itself).
+    static bool SetMirrorTable( Skeleton& skeleton, MirrorAxis::Enum axis, const u16* counterparts );
+    
+    // builds mirror table from joint names (joint_count entries, i.e. "l_arm"/"r_arm" with tokens "l_" and "r_").
+    // counterpart of a joint is the joint named with the first token occurrence swapped, joints without tokens
+    // mirror onto themselves. returns false if a sided joint has no counterpart.
+    static bool BuildMirrorTable( Skeleton& skeleton, MirrorAxis::Enum axis, const char* const* joint_names, const char* left_token, const char* right_token );
+    
+    // checks joint order, hit shape joints and mirror table. returns false if runtime would read out of bounds.
+    static bool Validate( const Skeleton& skeleton );
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include "engine/animation/AnimSkinning.h"
+#include "engine/animation/AnimWorkerPool.h"
+#include <algorithm>
+#include <math.h>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define ANIM_SKINNING_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <xmmintrin.h>
+    #define ANIM_SKINNING_SSE 1
+#endif
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// kernels read palette as flat float array (translation in elements 3, 7, 11).
+static_assert( sizeof(Matrix4x4) == 16 * sizeof(float), "unexpected Matrix4x4 layout" );
+
+//---------------------------------------------------------------------------------------
+
+SkinningInput::SkinningInput()
+: influence_count(0)
+, vertex_count(0)
+{
+    for( u32 i = 0; i < 3; ++i )
+    {
+        position[i] = nullptr;
+        normal[i] = nullptr;
+    }
+
+    for( u32 i = 0; i < 4; ++i )
+    {
+        joints[i] = nullptr;
+        weights[i] = nullptr;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+SkinningOutput::SkinningOutput()
+{
+    for( u32 i = 0; i < 3; ++i )
+    {
+        position[i] = nullptr;
+        normal[i] = nullptr;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+#if ANIM_SKINNING_AVX2
+
+// skins 8 vertices at a time. blended matrix elements are gathered across vertices.
+// returns first vertex not processed.
+static u32 SkinVerticesAVX2( const float* palette, const SkinningInput& in, SkinningOutput& out, u32 begin, u32 end )
+{
+    const bool skin_normals = in.normal[0] != nullptr;
+
+    u32 v = begin;
+    for( ; v + 8 <= end; v += 8 )
+    {
+        // rows 0-2 of weighted palette matrix.
+        __m256 m[12];
+        for( u32 e = 0; e < 12; ++e )
+            m[e] = _mm256_setzero_ps();
+
+        for( u32 k = 0; k < in.influence_count; ++k )
+        {
+            __m256i idx = _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i*)(in.joints[k] + v) ) );
+            idx = _mm256_slli_epi32( idx, 4 );
+
+            __m256 w = _mm256_loadu_ps( in.weights[k] + v );
+
+            for( u32 e = 0; e < 12; ++e )
+                m[e] = _mm256_add_ps( m[e], _mm256_mul_ps( w, _mm256_i32gather_ps( palette + e, idx, 4 ) ) );
+        }
+
+        __m256 px = _mm256_loadu_ps( in.position[0] + v );
+        __m256 py = _mm256_loadu_ps( in.position[1] + v );
+        __m256 pz = _mm256_loadu_ps( in.position[2] + v );
+
+        for( u32 r = 0; r < 3; ++r )
+        {
+            __m256 res = _mm256_add_ps( _mm256_mul_ps( m[r*4 + 0], px ), _mm256_mul_ps( m[r*4 + 1], py ) );
+            res = _mm256_add_ps( res, _mm256_add_ps( _mm256_mul_ps( m[r*4 + 2], pz ), m[r*4 + 3] ) );
+            _mm256_storeu_ps( out.position[r] + v, res );
+        }
+
+        if( skin_normals )
+        {
+            __m256 nx = _mm256_loadu_ps( in.normal[0] + v );
+            __m256 ny = _mm256_loadu_ps( in.normal[1] + v );
+            __m256 nz = _mm256_loadu_ps( in.normal[2] + v );
+
+            __m256 n[3];
+            for( u32 r = 0; r < 3; ++r )
+            {
+                n[r] = _mm256_add_ps( _mm256_mul_ps( m[r*4 + 0], nx ), _mm256_mul_ps( m[r*4 + 1], ny ) );
+                n[r] = _mm256_add_ps( n[r], _mm256_mul_ps( m[r*4 + 2], nz ) );
+            }
+
+            // blended matrix is not orthonormal - renormalize. degenerate normals are zeroed like in the other kernels.
+            __m256 len_sq = _mm256_add_ps( _mm256_mul_ps( n[0], n[0] ), _mm256_add_ps( _mm256_mul_ps( n[1], n[1] ), _mm256_mul_ps( n[2], n[2] ) ) );
+            __m256 len = _mm256_sqrt_ps( len_sq );
+            __m256 valid = _mm256_cmp_ps( len, _mm256_set1_ps( 1e-12f ), _CMP_GT_OQ );
+            __m256 inv_len = _mm256_and_ps( _mm256_div_ps( _mm256_set1_ps( 1.f ), len ), valid );
+
+            for( u32 r = 0; r < 3; ++r )
+                _mm256_storeu_ps( out.normal[r] + v, _mm256_mul_ps( n[r], inv_len ) );
+        }
+    }
+
+    return v;
+}
+
+#endif
+
+//---------------------------------------------------------------------------------------
+
+#if ANIM_SKINNING_SSE
+
+// blends palette rows of a single vertex.
+static inline void SkinVertexSSE( const float* palette, const SkinningInput& in, SkinningOutput& out, u32 v )
+{
+    __m128 r0 = _mm_setzero_ps();
+    __m128 r1 = _mm_setzero_ps();
+    __m128 r2 = _mm_setzero_ps();
+
+    for( u32 k = 0; k < in.influence_count; ++k )
+    {
+        const float* m = palette + in.joints[k][v] * 16;
+        __m128 w = _mm_set1_ps( in.weights[k][v] );
+
+        r0 = _mm_add_ps( r0, _mm_mul_ps( w, _mm_loadu_ps( m + 0 ) ) );
+        r1 = _mm_add_ps( r1, _mm_mul_ps( w, _mm_loadu_ps( m + 4 ) ) );
+        r2 = _mm_add_ps( r2, _mm_mul_ps( w, _mm_loadu_ps( m + 8 ) ) );
+    }
+
+    // three dot products at once: transpose products and sum columns.
+    __m128 p = _mm_set_ps( 1.f, in.position[2][v], in.position[1][v], in.position[0][v] );
+    __m128 x = _mm_mul_ps( r0, p );
+    __m128 y = _mm_mul_ps( r1, p );
+    __m128 z = _mm_mul_ps( r2, p );
+    __m128 w = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS( x, y, z, w );
+
+    float res[4];
+    _mm_storeu_ps( res, _mm_add_ps( _mm_add_ps( x, y ), _mm_add_ps( z, w ) ) );
+
+    out.position[0][v] = res[0];
+    out.position[1][v] = res[1];
+    out.position[2][v] = res[2];
+
+    if( in.normal[0] )
+    {
+        __m128 n = _mm_set_ps( 0.f, in.normal[2][v], in.normal[1][v], in.normal[0][v] );
+        x = _mm_mul_ps( r0, n );
+        y = _mm_mul_ps( r1, n );
+        z = _mm_mul_ps( r2, n );
+        w = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS( x, y, z, w );
+
+        _mm_storeu_ps( res, _mm_add_ps( _mm_add_ps( x, y ), _mm_add_ps( z, w ) ) );
+
+        float len = sqrtf( res[0] * res[0] + res[1] * res[1] + res[2] * res[2] );
+        float inv_len = len > 1e-12f ? 1.f / len : 0.f;
+
+        out.normal[0][v] = res[0] * inv_len;
+        out.normal[1][v] = res[1] * inv_len;
+        out.normal[2][v] = res[2] * inv_len;
+    }
+}
+
+#endif
+
+//---------------------------------------------------------------------------------------
+
+static inline void SkinVertexScalar( const float* palette, const SkinningInput& in, SkinningOutput& out, u32 v )
+{
+    float m[12] = { 0.f };
+
+    for( u32 k = 0; k < in.influence_count; ++k )
+    {
+        const float* joint = palette + in.joints[k][v] * 16;
+        float w = in.weights[k][v];
+
+        for( u32 e = 0; e < 12; ++e )
+            m[e] += w * joint[e];
+    }
+
+    float px = in.position[0][v], py = in.position[1][v], pz = in.position[2][v];
+
+    for( u32 r = 0; r < 3; ++r )
+        out.position[r][v] = m[r*4 + 0] * px + m[r*4 + 1] * py + m[r*4 + 2] * pz + m[r*4 + 3];
+
+    if( in.normal[0] )
+    {
+        float nx = in.normal[0][v], ny = in.normal[1][v], nz = in.normal[2][v];
+        float n[3];
+
+        for( u32 r = 0; r < 3; ++r )
+            n[r] = m[r*4 + 0] * nx + m[r*4 + 1] * ny + m[r*4 + 2] * nz;
+
+        float len = sqrtf( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+        float inv_len = len > 1e-12f ? 1.f / len : 0.f;
+
+        for( u32 r = 0; r < 3; ++r )
+            out.normal[r][v] = n[r] * inv_len;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimSkinning::SkinVertices( const Matrix4x4* palette, const SkinningInput& input, SkinningOutput& output, u32 begin, u32 end )
+{
+    ENGINE_ASSERT(input.influence_count >= 1 && input.influence_count <= 4, "invalid influence count");
+    ENGINE_ASSERT(end <= input.vertex_count, "vertex range out of bounds");
+
+    const float* matrices = (const float*)palette;
+    u32 v = begin;
+
+#if ANIM_SKINNING_AVX2
+    v = SkinVerticesAVX2( matrices, input, output, v, end );
+#endif
+
+    // remainder (or everything if avx2 is not available).
+    for( ; v < end; ++v )
+    {
+#if ANIM_SKINNING_SSE
+        SkinVertexSSE( matrices, input, output, v );
+#else
+        SkinVertexScalar( matrices, input, output, v );
+#endif
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimSkinning::SkinVerticesScalar( const Matrix4x4* palette, const SkinningInput& input, SkinningOutput& output, u32 begin, u32 end )
+{
+    ENGINE_ASSERT(input.influence_count >= 1 && input.influence_count <= 4, "invalid influence count");
+    ENGINE_ASSERT(end <= input.vertex_count, "vertex range out of bounds");
+
+    for( u32 v = begin; v < end; ++v )
+        SkinVertexScalar( (const float*)palette, input, output, v );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimSkinning::SkinBatch( SkinningJob* jobs, u32 job_count, AnimWorkerPool* pool )
+{
+    if( job_count == 0 )
+        return;
+
+    // first chunk index of every job. chunks never span two meshes.
+    u32* first_chunk = new u32[job_count + 1];
+    first_chunk[0] = 0;
+
+    for( u32 i = 0; i < job_count; ++i )
+        first_chunk[i + 1] = first_chunk[i] + (jobs[i].input.vertex_count + ChunkSize - 1) / ChunkSize;
+
+    u32 chunk_count = first_chunk[job_count];
+
+    AnimWorkerPool::RangeFunc skin_chunks = [&]( u32 begin, u32 end, u32 /*worker*/ )
+    {
+        u32 job = (u32)( std::upper_bound( first_chunk, first_chunk + job_count + 1, begin ) - first_chunk ) - 1;
+
+        for( u32 c = begin; c < end; ++c )
+        {
+            while( c >= first_chunk[job + 1] )
+                job++;
+
+            SkinningJob& j = jobs[job];
+            u32 first_vertex = (c - first_chunk[job]) * ChunkSize;
+            u32 last_vertex = std::min( first_vertex + ChunkSize, j.input.vertex_count );
+
+            SkinVertices( j.palette, j.input, j.output, first_vertex, last_vertex );
+        }
+    };
+
+    if( pool )
+        pool->ParallelFor( chunk_count, 1, skin_chunks );
+    else
+        skin_chunks( 0, chunk_count, 0 );
+
+    delete [] first_chunk;
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/math/Matrix4x4.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class AnimWorkerPool;
+
+// skinned mesh vertex streams in structure-of-arrays layout.
+struct SkinningInput
+{
+    SkinningInput();
+
+    // x, y, z position streams.
+    const float* position[3];
+
+    // x, y, z normal streams. normals are not skinned if null.
+    const float* normal[3];
+
+    // joint index stream per influence (palette indices).
+    const u16* joints[4];
+
+    // weight stream per influence. weights of a vertex should sum up to 1.
+    const float* weights[4];
+
+    // number of used influence streams (1-4).
+    u32 influence_count;
+
+    // number of vertices in every stream.
+    u32 vertex_count;
+};
+
+// skinned vertex streams. may not alias input streams.
+struct SkinningOutput
+{
+    SkinningOutput();
+
+    float* position[3];
+
+    // written only if input normals are present.
+    float* normal[3];
+};
+
+// single mesh skinned with a controller palette (AnimController::GetSkinningPalette).
+struct SkinningJob
+{
+    const Matrix4x4* palette;
+    SkinningInput input;
+    SkinningOutput output;
+};
+
+//---------------------------------------------------------------------------------------
+
+// cpu linear-blend skinning, used where there is no gpu (server side hit detection, cloth proxies).
+// uses avx2 kernel if compiled with avx2 support, sse kernel otherwise.
+class AnimSkinning
+{
+public:
+    // number of vertices in a single work item.
+    static const u32 ChunkSize = 512;
+
+public:
+    // skins [begin, end) vertex range of a single mesh.
+    static void SkinVertices( const Matrix4x4* palette, const SkinningInput& input, SkinningOutput& output, u32 begin, u32 end );
+
+    // same as SkinVertices with the portable kernel used by builds without sse. simd kernels match it
+    // within float rounding.
+    static void SkinVerticesScalar( const Matrix4x4* palette, const SkinningInput& input, SkinningOutput& output, u32 begin, u32 end );
+
+    // skins all jobs. vertices of all meshes are split into ChunkSize items which are run on the pool (if any).
+    static void SkinBatch( SkinningJob* jobs, u32 job_count, AnimWorkerPool* pool );
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
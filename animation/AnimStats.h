@@ -0,0 +1,149 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include <string.h>
+
+// animation statistics are compiled out unless ANIM_STATS is defined to 1.
+#ifndef ANIM_STATS
+    #define ANIM_STATS 0
+#endif
+
+#if ANIM_STATS
+    #include <chrono>
+#endif
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// enumerates AnimationSystem frame stages.
+namespace AnimStage{
+    enum Enum{
+        Update,
+        LocalPose,
+        GlobalPose,
+        Palette,
+        Count
+    };
+}
+
+//---------------------------------------------------------------------------------------
+
+// work counters. gathered per thread and merged into frame stats after every controller batch.
+struct AnimStatCounters
+{
+    inline void Reset() { memset(this, 0, sizeof(*this)); }
+
+    inline void Add( const AnimStatCounters& rhs );
+
+    // number of joint poses sampled from animation clips.
+    u64 joints_sampled;
+
+    // number of quaternion slerps (sample interpolation and pose blending).
+    u64 slerps;
+
+    // number of layer blend trees evaluated.
+    u64 trees_evaluated;
+
+    // number of evaluated trees which were cross-fading with previous tree.
+    u64 trees_crossfading;
+
+    // bytes of animation clip data read while sampling.
+    u64 clip_bytes;
+
+    // number of subtree/layer evaluations skipped because of (near) zero weight.
+    u64 pruned_evaluations;
+
+    // number of translation/scale channel interpolations skipped by trait specialized kernels.
+    u64 channels_skipped;
+
+    // number of controllers using baked palettes (local pose, global pose and palette passes skipped).
+    u64 baked_controllers;
+
+    // number of controllers evaluated in instance batches (global pose pass).
+    u64 batched_controllers;
+
+    // number of sleeping controllers (skipped by all frame stages).
+    u64 sleeping_controllers;
+
+    // number of sampled joint poses reflected by mirrored animations.
+    u64 joints_mirrored;
+};
+
+//---------------------------------------------------------------------------------------
+
+// maximum number of workers tracked by frame stats.
+static const u32 AnimStatMaxWorkers = 32;
+
+// single frame statistics of AnimationSystem.
+struct AnimFrameStats
+{
+    inline void Reset() { memset(this, 0, sizeof(*this)); }
+
+    // wall time of every stage in milliseconds.
+    float stage_ms[AnimStage::Count];
+
+    // work counters summed over all workers.
+    AnimStatCounters counters;
+
+    // number of workers used.
+    u32 worker_count;
+
+    // time every worker spent running controller batches in milliseconds.
+    float worker_busy_ms[AnimStatMaxWorkers];
+};
+
+//---------------------------------------------------------------------------------------
+
+inline void AnimStatCounters::Add( const AnimStatCounters& rhs )
+{
+    joints_sampled += rhs.joints_sampled;
+    slerps += rhs.slerps;
+    trees_evaluated += rhs.trees_evaluated;
+    trees_crossfading += rhs.trees_crossfading;
+    clip_bytes += rhs.clip_bytes;
+    pruned_evaluations += rhs.pruned_evaluations;
+    channels_skipped += rhs.channels_skipped;
+    baked_controllers += rhs.baked_controllers;
+    batched_controllers += rhs.batched_controllers;
+    sleeping_controllers += rhs.sleeping_controllers;
+    joints_mirrored += rhs.joints_mirrored;
+}
+
+//---------------------------------------------------------------------------------------
+
+#if ANIM_STATS
+
+class AnimStats
+{
+public:
+    // counters of calling thread. plain data, so no lazy initialization cost on access.
+    static inline AnimStatCounters& ThreadCounters()
+    {
+        static thread_local AnimStatCounters counters;
+        return counters;
+    }
+
+    // moves calling thread counters into destination.
+    static inline void FlushThreadCounters( AnimStatCounters& destination )
+    {
+        AnimStatCounters& counters = ThreadCounters();
+        destination.Add( counters );
+        counters.Reset();
+    }
+
+    // monotonic time in nanoseconds.
+    static inline u64 Now()
+    {
+        return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+};
+
+    #define ANIM_STAT_ADD( counter, value ) ( Engine::AnimStats::ThreadCounters().counter += (value) )
+#else
+    #define ANIM_STAT_ADD( counter, value ) ((void)0)
+#endif
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
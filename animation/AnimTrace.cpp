@@ -0,0 +1,143 @@
+#include "engine/animation/AnimTrace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// ring buffer owned by a single recording thread.
+struct AnimTraceBuffer
+{
+    AnimTraceEvent events[AnimTrace::RingSize];
+
+    // total number of events ever written. only owning thread writes it.
+    std::atomic<u32> head;
+
+    // trace thread id (registration order).
+    u32 thread_id;
+
+    // next registered buffer.
+    AnimTraceBuffer* next;
+};
+
+// registered buffers. buffers are never released - threads may still hold them.
+static std::atomic<AnimTraceBuffer*> s_buffers(nullptr);
+static std::atomic<u32> s_thread_count(0);
+static std::atomic<bool> s_enabled(true);
+
+//---------------------------------------------------------------------------------------
+
+static AnimTraceBuffer* GetThreadBuffer()
+{
+    static thread_local AnimTraceBuffer* buffer = nullptr;
+
+    if( !buffer )
+    {
+        buffer = new AnimTraceBuffer();
+        buffer->head = 0;
+        buffer->thread_id = s_thread_count.fetch_add(1);
+
+        // lock-free push to the registry.
+        AnimTraceBuffer* first = s_buffers.load();
+        do
+        {
+            buffer->next = first;
+        }
+        while( !s_buffers.compare_exchange_weak( first, buffer ) );
+    }
+
+    return buffer;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimTrace::SetEnabled( bool enabled )
+{
+    s_enabled = enabled;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimTrace::IsEnabled()
+{
+    return s_enabled.load( std::memory_order_relaxed );
+}
+
+//---------------------------------------------------------------------------------------
+
+u64 AnimTrace::Now()
+{
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimTrace::Record( const char* name, u64 begin_ns, u64 end_ns, u32 worker, u32 arg )
+{
+    AnimTraceBuffer* buffer = GetThreadBuffer();
+
+    u32 head = buffer->head.load( std::memory_order_relaxed );
+
+    AnimTraceEvent& e = buffer->events[head % RingSize];
+    e.name = name;
+    e.begin_ns = begin_ns;
+    e.end_ns = end_ns;
+    e.worker = worker;
+    e.arg = arg;
+
+    // publish the event.
+    buffer->head.store( head + 1, std::memory_order_release );
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimTrace::Dump( const char* path )
+{
+    FILE* file = fopen( path, "w" );
+
+    if( !file )
+        return false;
+
+    fprintf( file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" );
+
+    bool first = true;
+
+    for( AnimTraceBuffer* buffer = s_buffers.load(); buffer; buffer = buffer->next )
+    {
+        u32 head = buffer->head.load( std::memory_order_acquire );
+        u32 count = head < RingSize ? head : RingSize;
+
+        // thread name metadata.
+        fprintf( file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"anim thread %u\"}}",
+                first ? "" : ",\n", buffer->thread_id, buffer->thread_id );
+        first = false;
+
+        for( u32 i = head - count; i != head; ++i )
+        {
+            const AnimTraceEvent& e = buffer->events[i % RingSize];
+
+            // complete events, time in microseconds.
+            fprintf( file, ",\n{\"name\":\"%s\",\"cat\":\"animation\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"worker\":%u,\"arg\":%u}}",
+                    e.name, buffer->thread_id, e.begin_ns * 0.001, (e.end_ns - e.begin_ns) * 0.001, e.worker, e.arg );
+        }
+    }
+
+    fprintf( file, "\n]}\n" );
+    fclose( file );
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimTrace::Clear()
+{
+    for( AnimTraceBuffer* buffer = s_buffers.load(); buffer; buffer = buffer->next )
+        buffer->head.store( 0, std::memory_order_release );
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "engine/core/Types.h"
+
+// animation trace events are compiled out unless ANIM_TRACE is defined to 1.
+#ifndef ANIM_TRACE
+    #define ANIM_TRACE 0
+#endif
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// single timed event.
+struct AnimTraceEvent
+{
+    // static string, never copied.
+    const char* name;
+
+    // begin/end time in nanoseconds.
+    u64 begin_ns;
+    u64 end_ns;
+
+    // worker index running the event.
+    u32 worker;
+
+    // event argument (i.e. first controller of a batch).
+    u32 arg;
+};
+
+//---------------------------------------------------------------------------------------
+
+// timeline of animation work. every thread records into its own ring buffer, so recording
+// is lock-free. buffered events can be dumped as chrome trace json (loadable by perfetto).
+class AnimTrace
+{
+public:
+    // number of events kept per thread. older events are overwritten.
+    static const u32 RingSize = 8192;
+
+public:
+    // recording can be switched off at runtime.
+    static void SetEnabled( bool enabled );
+
+    static bool IsEnabled();
+
+    // monotonic time in nanoseconds.
+    static u64 Now();
+
+    // appends event to calling thread ring buffer.
+    static void Record( const char* name, u64 begin_ns, u64 end_ns, u32 worker, u32 arg );
+
+    // writes all buffered events to a file in chrome trace event format.
+    // should be called while no animation work is running.
+    static bool Dump( const char* path );
+
+    // drops all buffered events.
+    static void Clear();
+};
+
+//---------------------------------------------------------------------------------------
+
+// records an event covering its lifetime.
+class AnimTraceScope
+{
+public:
+    inline AnimTraceScope( const char* name, u32 worker, u32 arg )
+    : m_name(name)
+    , m_worker(worker)
+    , m_arg(arg)
+    , m_begin_ns(AnimTrace::IsEnabled() ? AnimTrace::Now() : 0)
+    {
+    }
+
+    inline ~AnimTraceScope()
+    {
+        if( m_begin_ns != 0 )
+            AnimTrace::Record( m_name, m_begin_ns, AnimTrace::Now(), m_worker, m_arg );
+    }
+
+private:
+    const char* m_name;
+    u32 m_worker;
+    u32 m_arg;
+    u64 m_begin_ns;
+};
+
+//---------------------------------------------------------------------------------------
+
+#if ANIM_TRACE
+    #define ANIM_TRACE_CONCAT_IMPL( a, b ) a##b
+    #define ANIM_TRACE_CONCAT( a, b ) ANIM_TRACE_CONCAT_IMPL( a, b )
+    #define ANIM_TRACE_SCOPE( name, worker, arg ) Engine::AnimTraceScope ANIM_TRACE_CONCAT( anim_trace_scope_, __LINE__ )( name, worker, arg )
+#else
+    #define ANIM_TRACE_SCOPE( name, worker, arg ) ((void)0)
+#endif
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "engine/animation/AnimWorkerPool.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+AnimWorkerPool::AnimWorkerPool()
+: m_threads(nullptr)
+, m_worker_count(1)
+, m_func(nullptr)
+, m_count(0)
+, m_batch_size(1)
+, m_next(0)
+, m_busy_workers(0)
+, m_generation(0)
+, m_quit(false)
+{
+
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimWorkerPool::~AnimWorkerPool()
+{
+    Stop();
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimWorkerPool::Start( u32 worker_count )
+{
+    Stop();
+
+    if( worker_count < 1 )
+        worker_count = 1;
+
+    m_worker_count = worker_count;
+
+    // generation keeps counting across restarts, new workers must not take the last job of previous ones.
+    u32 generation;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = false;
+        generation = m_generation;
+    }
+
+    if( worker_count > 1 )
+    {
+        m_threads = new std::thread[worker_count - 1];
+
+        for( u32 i = 1; i < worker_count; ++i )
+            m_threads[i - 1] = std::thread( &AnimWorkerPool::WorkerMain, this, i, generation );
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimWorkerPool::Stop()
+{
+    if( m_threads )
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_job_cv.notify_all();
+
+        for( u32 i = 0; i < m_worker_count - 1; ++i )
+            m_threads[i].join();
+
+        delete [] m_threads;
+        m_threads = nullptr;
+    }
+
+    m_worker_count = 1;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimWorkerPool::ParallelFor( u32 count, u32 batch_size, const RangeFunc& func )
+{
+    if( count == 0 )
+        return;
+
+    if( batch_size == 0 )
+        batch_size = 1;
+
+    // not worth waking anybody up.
+    if( m_worker_count <= 1 || count <= batch_size )
+    {
+        func( 0, count, 0 );
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_func = &func;
+        m_count = count;
+        m_batch_size = batch_size;
+        m_next = 0;
+        m_busy_workers = m_worker_count - 1;
+        m_generation++;
+    }
+    m_job_cv.notify_all();
+
+    RunBatches( 0 );
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while( m_busy_workers > 0 )
+        m_done_cv.wait(lock);
+
+    m_func = nullptr;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimWorkerPool::RunBatches( u32 worker )
+{
+    for(;;)
+    {
+        u32 begin = m_next.fetch_add( m_batch_size );
+
+        if( begin >= m_count )
+            break;
+
+        u32 end = begin + m_batch_size < m_count ? begin + m_batch_size : m_count;
+
+        (*m_func)( begin, end, worker );
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimWorkerPool::WorkerMain( u32 worker, u32 generation )
+{
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            while( !m_quit && generation == m_generation )
+                m_job_cv.wait(lock);
+
+            if( m_quit )
+                return;
+
+            generation = m_generation;
+        }
+
+        RunBatches( worker );
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if( --m_busy_workers == 0 )
+            m_done_cv.notify_one();
+    }
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// persistent worker threads used to split animation work into batches.
+// calling thread always takes part in the work as worker 0.
+class AnimWorkerPool
+{
+public:
+    // called for every batch with [begin, end) range and index of the worker running it.
+    typedef std::function<void( u32 begin, u32 end, u32 worker )> RangeFunc;
+
+public:
+    AnimWorkerPool();
+    ~AnimWorkerPool();
+
+    // spawns worker_count - 1 threads.
+    void Start( u32 worker_count );
+
+    // joins all threads.
+    void Stop();
+
+    // number of workers including calling thread.
+    inline u32 GetWorkerCount() const { return m_worker_count; }
+
+    // splits [0, count) into batch_size ranges and runs them on all workers. blocks until done.
+    void ParallelFor( u32 count, u32 batch_size, const RangeFunc& func );
+
+private:
+    // generation is the last job generation at start, worker waits for the next one.
+    void WorkerMain( u32 worker, u32 generation );
+
+    // takes batches of the current job until there are none left.
+    void RunBatches( u32 worker );
+
+private:
+    // spawned threads (m_worker_count - 1).
+    std::thread* m_threads;
+
+    // number of workers including calling thread.
+    u32 m_worker_count;
+
+    std::mutex m_mutex;
+
+    // signaled when new job is available.
+    std::condition_variable m_job_cv;
+
+    // signaled when last worker finishes current job.
+    std::condition_variable m_done_cv;
+
+    // current job.
+    const RangeFunc* m_func;
+    u32 m_count;
+    u32 m_batch_size;
+
+    // next range start handed out to a worker.
+    std::atomic<u32> m_next;
+
+    // spawned threads still working on current job.
+    u32 m_busy_workers;
+
+    // incremented with every job so sleeping workers can tell there is a new one.
+    u32 m_generation;
+
+    bool m_quit;
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -1,103 +1,330 @@
-#include "engine/animation/Animation.h"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-    
-Animation::Animation()
-: m_clip(nullptr)
-, m_global_start_time_ms(0.f)
-, m_looped(false)
-, m_playback_rate(1.f)
-{
-    
-}
-    
-//---------------------------------------------------------------------------------------
-    
-Animation::Animation( const Animation& rhs, float current_clock_ms )
-: m_clip(rhs.m_clip)
-, m_global_start_time_ms(current_clock_ms)
-, m_looped(rhs.m_looped)
-, m_playback_rate(rhs.m_playback_rate)
-{
-    
-}
-    
-//---------------------------------------------------------------------------------------
-    
-Animation::Animation( AnimationClip* clip, float current_clock_ms, bool looped, float playback_rate )
-: m_clip(clip)
-, m_global_start_time_ms(current_clock_ms)
-, m_looped(looped)
-, m_playback_rate(playback_rate)
-{
-    
-}
-
-//---------------------------------------------------------------------------------------
-
-Animation& Animation::operator=(const Animation& rhs )
-{
-    m_clip = rhs.m_clip;
-    m_global_start_time_ms = rhs.m_global_start_time_ms;
-    m_looped = rhs.m_looped;
-    m_playback_rate = rhs.m_playback_rate;
-    
-    return *this;
-}
-
-//---------------------------------------------------------------------------------------
-
-void Animation::GetJointPose(float current_global_time_ms, s16 joint_idx, AnimationClip::JointPose& out_pose) const
-{
-    float local_time = GetLocalAnimationTime( current_global_time_ms );
-    ENGINE_ASSERT( local_time <= m_clip->GetDuration( m_looped ), "local time out of range" );
-    
-    m_clip->GetJointPose( local_time, joint_idx, out_pose, m_looped );
-}
-    
-//---------------------------------------------------------------------------------------
-    
-float Animation::GetLocalAnimationTime(float global_time_ms) const
-{
-    float local_time = 0.f;
-    
-    // if animation is played once (N = 1):
-    //      t = clamp(t = R(T - Tstart), 0, D).
-    // if animation loops forever (N = infinity)
-    //      t = (R(T - Tstart)) mod D.
-    // if animation is looed finite number of times ( 1 < N < inf )
-    //      t = clamp(R(T - Tstart), 0, N*D) mod D.
-    
-    float duration = m_clip->GetDuration( m_looped );
-    
-    if(m_looped)
-    {
-        // (m_playback_rate * (globalTime - m_startGlobalTime)) % duration;
-        float timer = (m_playback_rate * (global_time_ms - m_global_start_time_ms));
-        local_time = fmodf(timer, duration);
-    }
-    else
-    {
-        local_time = Engine::Math::Clamp<float>(m_playback_rate * (global_time_ms - m_global_start_time_ms), -duration, duration);
-    }
-    
-    // fix negative playback rate.
-    if(local_time < 0.f)
-        local_time += duration;
-    
-    return local_time;
-}
-
-//---------------------------------------------------------------------------------------
-
-bool Animation::IsValid() const
-{
-    return m_clip != nullptr;
-}
-
-//---------------------------------------------------------------------------------------
-}; //namespace Engine
-//---------------------------------------------------------------------------------------
-
+#include "engine/animation/Animation.h"
+#include <math.h>
+#include <string.h>
+#include <stddef.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <xmmintrin.h>
+    #define ANIM_MIRROR_SSE 1
+#endif
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// kernel reads and writes quaternion as 4 floats (x, y, z, w).
+static_assert( sizeof(Quaternion) == 4 * sizeof(float), "unexpected Quaternion layout" );
+static_assert( offsetof(Quaternion, x) == 0 * sizeof(float), "unexpected Quaternion layout" );
+static_assert( offsetof(Quaternion, y) == 1 * sizeof(float), "unexpected Quaternion layout" );
+static_assert( offsetof(Quaternion, z) == 2 * sizeof(float), "unexpected Quaternion layout" );
+static_assert( offsetof(Quaternion, w) == 3 * sizeof(float), "unexpected Quaternion layout" );
+
+// sign flips reflecting a local pose across plane perpendicular to the axis (M * pose * M). translation
+// component along the axis is negated, rotation keeps its component along the axis and negates the other
+// two (reflection reverses rotation direction). uniform scale is not changed.
+static const u32 s_mirror_rotation_signs[3][4] = {
+    { 0, 0x80000000, 0x80000000, 0 },
+    { 0x80000000, 0, 0x80000000, 0 },
+    { 0x80000000, 0x80000000, 0, 0 }
+};
+
+static const u32 s_mirror_translation_signs[3][4] = {
+    { 0x80000000, 0, 0, 0 },
+    { 0, 0x80000000, 0, 0 },
+    { 0, 0, 0x80000000, 0 }
+};
+
+//---------------------------------------------------------------------------------------
+
+static inline void MirrorPose( AnimationClip::JointPose& pose, MirrorAxis::Enum axis )
+{
+#if ANIM_MIRROR_SSE
+    // sign bits are flipped in a single xor per channel.
+    float* q = (float*)&pose.rotation;
+    _mm_storeu_ps( q, _mm_xor_ps( _mm_loadu_ps( q ), _mm_loadu_ps( (const float*)s_mirror_rotation_signs[axis] ) ) );
+    
+    float ts[4];
+    __m128 t = _mm_set_ps( pose.scale, pose.translation.z, pose.translation.y, pose.translation.x );
+    _mm_storeu_ps( ts, _mm_xor_ps( t, _mm_loadu_ps( (const float*)s_mirror_translation_signs[axis] ) ) );
+    
+    pose.translation = Vec3( ts[0], ts[1], ts[2] );
+#else
+    // sign bits are flipped on a copy (float storage must not be accessed through u32 pointer).
+    u32 q[4];
+    memcpy( q, &pose.rotation, sizeof(q) );
+    
+    for( u32 c = 0; c < 4; ++c )
+        q[c] ^= s_mirror_rotation_signs[axis][c];
+    
+    memcpy( &pose.rotation, q, sizeof(q) );
+    
+    switch( axis )
+    {
+        case MirrorAxis::X: pose.translation.x = -pose.translation.x; break;
+        case MirrorAxis::Y: pose.translation.y = -pose.translation.y; break;
+        case MirrorAxis::Z: pose.translation.z = -pose.translation.z; break;
+    }
+#endif
+}
+
+//---------------------------------------------------------------------------------------
+    
+Animation::Animation()
+: m_clip(nullptr)
+, m_global_start_time_ms(0.f)
+, m_looped(false)
+, m_mirrored(false)
+, m_playback_rate(1.f)
+, m_event_cursor(0)
+, m_event_cursor_time(-1.f)
+, m_event_cursor_forward(true)
+, m_cursor_global_time(0.f)
+, m_cursor_valid(false)
+{
+    
+}
+    
+//---------------------------------------------------------------------------------------
+    
+Animation::Animation( const Animation& rhs, float current_clock_ms )
+: m_clip(rhs.m_clip)
+, m_global_start_time_ms(current_clock_ms)
+, m_looped(rhs.m_looped)
+, m_mirrored(rhs.m_mirrored)
+, m_playback_rate(rhs.m_playback_rate)
+, m_event_cursor(0)
+, m_event_cursor_time(-1.f)
+, m_event_cursor_forward(true)
+, m_cursor_global_time(0.f)
+, m_cursor_valid(false)
+{
+    
+}
+    
+//---------------------------------------------------------------------------------------
+    
+Animation::Animation( AnimationClip* clip, float current_clock_ms, bool looped, float playback_rate, bool mirrored )
+: m_clip(clip)
+, m_global_start_time_ms(current_clock_ms)
+, m_looped(looped)
+, m_mirrored(mirrored)
+, m_playback_rate(playback_rate)
+, m_event_cursor(0)
+, m_event_cursor_time(-1.f)
+, m_event_cursor_forward(true)
+, m_cursor_global_time(0.f)
+, m_cursor_valid(false)
+{
+    
+}
+
+//---------------------------------------------------------------------------------------
+
+Animation& Animation::operator=(const Animation& rhs )
+{
+    m_clip = rhs.m_clip;
+    m_global_start_time_ms = rhs.m_global_start_time_ms;
+    m_looped = rhs.m_looped;
+    m_mirrored = rhs.m_mirrored;
+    m_playback_rate = rhs.m_playback_rate;
+    m_event_cursor = rhs.m_event_cursor;
+    m_event_cursor_time = rhs.m_event_cursor_time;
+    m_event_cursor_forward = rhs.m_event_cursor_forward;
+    m_cursor = rhs.m_cursor;
+    m_cursor_global_time = rhs.m_cursor_global_time;
+    m_cursor_valid = rhs.m_cursor_valid;
+    
+    return *this;
+}
+
+//---------------------------------------------------------------------------------------
+
+void Animation::UpdateCursor( float global_time_ms )
+{
+    float local_time = GetLocalAnimationTime( global_time_ms );
+    ENGINE_ASSERT( local_time <= m_clip->GetDuration( m_looped ), "local time out of range" );
+    
+    m_clip->UpdateCursor( local_time, m_looped, m_cursor );
+    m_cursor_global_time = global_time_ms;
+    m_cursor_valid = true;
+}
+
+//---------------------------------------------------------------------------------------
+
+void Animation::GetJointPose(float current_global_time_ms, s16 joint_idx, const Skeleton& skeleton, AnimationClip::JointPose& out_pose) const
+{
+    ENGINE_ASSERT( !m_mirrored || skeleton.HasMirrorTable(), "mirrored animation needs skeleton mirror table" );
+    
+    s16 source_joint = GetSourceJoint( joint_idx, skeleton );
+    
+    // common case - cursor has been moved by layer update.
+    if( m_cursor_valid && m_cursor_global_time == current_global_time_ms )
+    {
+        m_clip->GetJointPose( m_cursor, source_joint, out_pose );
+    }
+    else
+    {
+        float local_time = GetLocalAnimationTime( current_global_time_ms );
+        ENGINE_ASSERT( local_time <= m_clip->GetDuration( m_looped ), "local time out of range" );
+        
+        m_clip->GetJointPose( local_time, source_joint, out_pose, m_looped );
+    }
+    
+    if( m_mirrored )
+    {
+        MirrorPose( out_pose, skeleton.GetMirrorAxis() );
+        ANIM_STAT_ADD(joints_mirrored, 1);
+    }
+}
+    
+//---------------------------------------------------------------------------------------
+    
+float Animation::GetLocalAnimationTime(float global_time_ms) const
+{
+    float local_time = 0.f;
+    
+    // if animation is played once (N = 1):
+    //      t = clamp(t = R(T - Tstart), 0, D).
+    // if animation loops forever (N = infinity)
+    //      t = (R(T - Tstart)) mod D.
+    // if animation is looed finite number of times ( 1 < N < inf )
+    //      t = clamp(R(T - Tstart), 0, N*D) mod D.
+    
+    float duration = m_clip->GetDuration( m_looped );
+    
+    if(m_looped)
+    {
+        // (m_playback_rate * (globalTime - m_startGlobalTime)) % duration;
+        float timer = (m_playback_rate * (global_time_ms - m_global_start_time_ms));
+        local_time = fmodf(timer, duration);
+    }
+    else
+    {
+        local_time = Engine::Math::Clamp<float>(m_playback_rate * (global_time_ms - m_global_start_time_ms), -duration, duration);
+    }
+    
+    // fix negative playback rate.
+    if(local_time < 0.f)
+        local_time += duration;
+    
+    return local_time;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool Animation::IsStatic( float global_time_ms ) const
+{
+    if( m_playback_rate == 0.f )
+        return true;
+    
+    if( m_looped )
+        return false;
+    
+    // same clamp as GetLocalAnimationTime.
+    float duration = m_clip->GetDuration( m_looped );
+    float timer = m_playback_rate * (global_time_ms - m_global_start_time_ms);
+    
+    return timer >= duration || timer <= -duration;
+}
+
+//---------------------------------------------------------------------------------------
+
+void Animation::CollectEvents( float prev_global_time_ms, float global_time_ms, float weight, u16 layer, AnimEventBuffer& events )
+{
+    u32 event_count = m_clip->GetEventCount();
+    
+    if( event_count == 0 )
+        return;
+    
+    float duration = m_clip->GetDuration( m_looped );
+    float delta = m_playback_rate * (global_time_ms - prev_global_time_ms);
+    
+    if( delta == 0.f || duration <= 0.f )
+        return;
+    
+    float from = GetLocalAnimationTime( prev_global_time_ms );
+    float to = GetLocalAnimationTime( global_time_ms );
+    bool forward = delta > 0.f;
+    
+    // cursor is valid only if playback continues from the last collected time in the same direction. events at
+    // 'from' have been fired already unless nothing has been collected since start, so the range is open on that side.
+    if( m_event_cursor_time < 0.f )
+        m_event_cursor = m_clip->FindEventCursor( from, !forward );
+    else if( m_event_cursor_time != from || m_event_cursor_forward != forward )
+        m_event_cursor = m_clip->FindEventCursor( from, forward );
+    
+    AnimEvent e;
+    e.weight = weight;
+    e.layer = layer;
+    
+    auto fire = [&]( u32 idx )
+    {
+        e.name = m_clip->GetEvent(idx).name;
+        e.time_ms = m_clip->GetEvent(idx).time_ms;
+        events.Add(e);
+    };
+    
+    // looped clip passing a whole cycle (or more) in one update fires every event once, starting after 'from'.
+    bool full_cycle = m_looped && fabsf( delta ) >= duration;
+    u32 begin = m_event_cursor;
+    
+    if( forward )
+    {
+        // fires events in (from, to] ([from, to] on first call). looped clip wraps around at the end.
+        bool wrapped = m_looped && (to < from || full_cycle);
+        float end = wrapped ? duration : to;
+        
+        for( ; m_event_cursor < event_count && m_clip->GetEvent(m_event_cursor).time_ms <= end; ++m_event_cursor )
+            fire( m_event_cursor );
+        
+        if( full_cycle )
+        {
+            for( u32 i = 0; i < begin; ++i )
+                fire( i );
+            
+            m_event_cursor = m_clip->FindEventCursor( to, true );
+        }
+        else if( wrapped )
+        {
+            for( m_event_cursor = 0; m_event_cursor < event_count && m_clip->GetEvent(m_event_cursor).time_ms <= to; ++m_event_cursor )
+                fire( m_event_cursor );
+        }
+    }
+    else
+    {
+        // negative playback rate fires events in [to, from) ([to, from] on first call) backwards.
+        bool wrapped = m_looped && (to > from || full_cycle);
+        float end = wrapped ? 0.f : to;
+        
+        for( ; m_event_cursor > 0 && m_clip->GetEvent(m_event_cursor - 1).time_ms >= end; --m_event_cursor )
+            fire( m_event_cursor - 1 );
+        
+        if( full_cycle )
+        {
+            for( u32 i = event_count; i > begin; --i )
+                fire( i - 1 );
+            
+            m_event_cursor = m_clip->FindEventCursor( to, false );
+        }
+        else if( wrapped )
+        {
+            for( m_event_cursor = event_count; m_event_cursor > 0 && m_clip->GetEvent(m_event_cursor - 1).time_ms >= to; --m_event_cursor )
+                fire( m_event_cursor - 1 );
+        }
+    }
+    
+    m_event_cursor_time = to;
+    m_event_cursor_forward = forward;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool Animation::IsValid() const
+{
+    return m_clip != nullptr;
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
+
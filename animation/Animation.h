@@ -1,51 +1,102 @@
-#pragma once
-
-#include "engine/core/StringId.h"
-#include "engine/animation/AnimationClip.h"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-
-class Animation
-{
-public:
-    Animation();
-    Animation( const Animation& rhs, float current_clock_ms );
-    Animation( AnimationClip* clip, float current_clock_ms, bool looped, float playback_rate );
-    Animation& operator=(const Animation& rhs );
-    
-    void GetJointPose(float global_time_ms, s16 joint_idx, AnimationClip::JointPose& outPose) const;
-    
-    inline bool	HasJointPose(s16 joint_idx) const { return m_clip->HasJointPose(joint_idx); }
-    
-    inline float GetPlaybackRate() const { return m_playback_rate; }
-    
-    inline void	SetPlaybackRate(float rate) { m_playback_rate = rate; }
-    
-    // calculates the local time of the animation, up to clip duration (in milliseconds).
-    float GetLocalAnimationTime(float global_time_ms) const;
-    
-    // animation start time, relative to AnimLayer timer.
-    inline float GetStartTime() const { return m_global_start_time_ms; }
-  
-    inline void SetStartTime( float time_ms ) { m_global_start_time_ms = time_ms; }
-    
-    bool IsValid() const;
-private:
-    // AnimLayer related animation start time.
-    float m_global_start_time_ms;
-    
-    // animation clip is looped if true.
-    bool m_looped;
-    
-    // playback rate scale factor. 1.0 by default.
-    float m_playback_rate;
-    
-    // animation frame data.
-    AnimationClip* m_clip;
-};
-
-//---------------------------------------------------------------------------------------
-} // namespace Engine
+#pragma once
+
+#include "engine/core/StringId.h"
+#include "engine/animation/AnimationClip.h"
+#include "engine/animation/AnimEvent.h"
+#include "engine/animation/Skeleton.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class Animation
+{
+public:
+    Animation();
+    Animation( const Animation& rhs, float current_clock_ms );
+    Animation( AnimationClip* clip, float current_clock_ms, bool looped, float playback_rate, bool mirrored = false );
+    Animation& operator=(const Animation& rhs );
+    
+    // mirrored animation samples counterpart joint and reflects its pose across skeleton mirror plane.
+    void GetJointPose(float global_time_ms, s16 joint_idx, const Skeleton& skeleton, AnimationClip::JointPose& outPose) const;
+    
+    inline bool	HasJointPose(s16 joint_idx, const Skeleton& skeleton) const { return m_clip->HasJointPose( GetSourceJoint(joint_idx, skeleton) ); }
+    
+    // reflection keeps identity and static channels, so traits of the counterpart joint apply.
+    inline u32 GetJointTraits(s16 joint_idx, const Skeleton& skeleton) const { return m_clip->GetJointTraits( GetSourceJoint(joint_idx, skeleton) ); }
+    
+    // clip joint sampled for the skeleton joint (counterpart joint if mirrored).
+    inline s16 GetSourceJoint(s16 joint_idx, const Skeleton& skeleton) const { return m_mirrored ? (s16)skeleton.GetMirrorJoint(joint_idx) : joint_idx; }
+    
+    inline bool IsMirrored() const { return m_mirrored; }
+    
+    inline void SetMirrored(bool mirrored) { m_mirrored = mirrored; }
+    
+    inline const AnimationClip* GetClip() const { return m_clip; }
+    
+    inline float GetPlaybackRate() const { return m_playback_rate; }
+    
+    inline bool IsLooped() const { return m_looped; }
+    
+    inline void	SetPlaybackRate(float rate) { m_playback_rate = rate; }
+    
+    // calculates the local time of the animation, up to clip duration (in milliseconds).
+    float GetLocalAnimationTime(float global_time_ms) const;
+    
+    // animation start time, relative to AnimLayer timer.
+    inline float GetStartTime() const { return m_global_start_time_ms; }
+  
+    inline void SetStartTime( float time_ms ) { m_global_start_time_ms = time_ms; m_event_cursor_time = -1.f; m_cursor_valid = false; }
+    
+    // shifts start time and global timer together, local time and event cursor stay valid.
+    inline void RewindStartTime( float rewind_time_ms ) { m_global_start_time_ms -= rewind_time_ms; m_cursor_valid = false; }
+    
+    // moves sample cursor to given global time. GetJointPose calls for the same time reuse it.
+    void UpdateCursor( float global_time_ms );
+    
+    // adds clip events passed between two global times (handles looping and negative playback rate).
+    // uses event cursor kept from the previous call, so the cost depends on number of fired events only.
+    void CollectEvents( float prev_global_time_ms, float global_time_ms, float weight, u16 layer, AnimEventBuffer& events );
+    
+    bool IsValid() const;
+    
+    // true if pose does not change after given global time (paused by 0 playback rate or clamped at the end of non looped clip).
+    bool IsStatic( float global_time_ms ) const;
+private:
+    // AnimLayer related animation start time.
+    float m_global_start_time_ms;
+    
+    // animation clip is looped if true.
+    bool m_looped;
+    
+    // left and right side of the pose are swapped and reflected if true.
+    bool m_mirrored;
+    
+    // playback rate scale factor. 1.0 by default.
+    float m_playback_rate;
+    
+    // animation frame data.
+    AnimationClip* m_clip;
+    
+    // number of clip events with time <= m_event_cursor_time (< if playing backwards).
+    u32 m_event_cursor;
+    
+    // local time the event cursor is valid for. negative if cursor has to be searched for.
+    float m_event_cursor_time;
+    
+    // playback direction the event cursor was left by (meaning of m_event_cursor depends on it).
+    bool m_event_cursor_forward;
+    
+    // clip sampling position at m_cursor_global_time.
+    AnimationClip::SampleCursor m_cursor;
+    
+    // global time the sample cursor is valid for.
+    float m_cursor_global_time;
+    
+    // false until first UpdateCursor and after start time changes.
+    bool m_cursor_valid;
+};
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
 //---------------------------------------------------------------------------------------
\ No newline at end of file
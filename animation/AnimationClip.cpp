@@ -1,71 +1,328 @@
-#include "engine/animation/AnimationClip.h"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-
-AnimationClip::AnimationClip()
-{
-    
-}
-
-//---------------------------------------------------------------------------------------
-
-AnimationClip::~AnimationClip()
-{
-    
-}
-
-//---------------------------------------------------------------------------------------
-
-void AnimationClip::FixPointers()
-{
-    m_joint_poses = (JointPose*)( (u8*)this + (int)m_joint_poses + sizeof(AnimationClip) );
-    m_joint_remap = (s16*)( (u8*)this + (int)m_joint_remap + sizeof(AnimationClip) );
-}
-
-//---------------------------------------------------------------------------------------
-
-void AnimationClip::BreakPointers()
-{
-    m_joint_poses = (JointPose*)( (u8*)m_joint_poses - (int)this - sizeof(AnimationClip) );
-    m_joint_remap = (s16*)( (u8*)m_joint_remap - (int)this - sizeof(AnimationClip) );
-}
-
-//---------------------------------------------------------------------------------------
-
-bool AnimationClip::operator-=( const AnimationClip& source )
-{
-    if( m_skeleton_joint_count != source.m_skeleton_joint_count
-       || m_frames_per_ms != source.m_frames_per_ms
-       || m_frame_count != source.m_frame_count )
-        return false;
-  
-    for( u32 f = 0; f < m_frame_count; ++f )
-    {
-        for( u32 i = 0; i < m_skeleton_joint_count; ++i )
-        {
-            if( HasJointPose(i) )
-            {
-                JointPose pose = GetJointPose(f, i);
-                
-                if( source.HasJointPose(i) )
-                {
-                    const JointPose& source_pose = source.GetJointPose(f, i);
-                    pose -= source_pose;
-                }
-                
-                // update joint position.
-                u32 array_index = f * m_animated_joint_count + i;
-                m_joint_poses[array_index] = pose;
-            }
-        }
-    }
-    
-    return true;
-}
-
-//---------------------------------------------------------------------------------------
-}; //namespace Engine
-//---------------------------------------------------------------------------------------
-
+#include "engine/animation/AnimationClip.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <xmmintrin.h>
+    #define ANIM_CURVE_SSE 1
+#endif
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+const AnimationClip::JointPose::LerpFunc AnimationClip::JointPose::s_lerp_kernels[4] =
+{
+    &JointPose::LerpKernel<false, false>,
+    &JointPose::LerpKernel<false, true>,
+    &JointPose::LerpKernel<true, false>,
+    &JointPose::LerpKernel<true, true>
+};
+
+const AnimationClip::JointPose::AdditiveFunc AnimationClip::JointPose::s_additive_kernels[4] =
+{
+    &JointPose::AdditiveKernel<false, false>,
+    &JointPose::AdditiveKernel<false, true>,
+    &JointPose::AdditiveKernel<true, false>,
+    &JointPose::AdditiveKernel<true, true>
+};
+
+//---------------------------------------------------------------------------------------
+
+AnimationClip::AnimationClip()
+: m_magic(Magic)
+, m_version(Version)
+, m_name(0)
+, m_skeleton_joint_count(0)
+, m_animated_joint_count(0)
+, m_frames_per_ms(0.f)
+, m_frame_count(0)
+, m_joint_poses(nullptr)
+, m_joint_remap(nullptr)
+, m_event_count(0)
+, m_events(nullptr)
+, m_curve_key_count(0)
+, m_curve_keys(nullptr)
+, m_curve_key_frames(nullptr)
+, m_curve_joint_keys(nullptr)
+, m_traits(ClipTraits::None)
+, m_translation_joint(-1)
+{
+    
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimationClip::~AnimationClip()
+{
+    
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationClip::FixPointers()
+{
+    m_joint_poses = (JointPose*)( (u8*)this + (size_t)m_joint_poses + sizeof(AnimationClip) );
+    m_joint_remap = (s16*)( (u8*)this + (size_t)m_joint_remap + sizeof(AnimationClip) );
+    
+    if( m_event_count > 0 )
+        m_events = (Event*)( (u8*)this + (size_t)m_events + sizeof(AnimationClip) );
+    else
+        m_events = nullptr;
+    
+    if( m_curve_key_count > 0 )
+    {
+        m_curve_keys = (CurveKey*)( (u8*)this + (size_t)m_curve_keys + sizeof(AnimationClip) );
+        m_curve_key_frames = (u16*)( (u8*)this + (size_t)m_curve_key_frames + sizeof(AnimationClip) );
+        m_curve_joint_keys = (u32*)( (u8*)this + (size_t)m_curve_joint_keys + sizeof(AnimationClip) );
+    }
+    else
+    {
+        m_curve_keys = nullptr;
+        m_curve_key_frames = nullptr;
+        m_curve_joint_keys = nullptr;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationClip::BreakPointers()
+{
+    m_joint_poses = (JointPose*)( (u8*)m_joint_poses - (size_t)this - sizeof(AnimationClip) );
+    m_joint_remap = (s16*)( (u8*)m_joint_remap - (size_t)this - sizeof(AnimationClip) );
+    
+    if( m_event_count > 0 )
+        m_events = (Event*)( (u8*)m_events - (size_t)this - sizeof(AnimationClip) );
+    
+    if( m_curve_key_count > 0 )
+    {
+        m_curve_keys = (CurveKey*)( (u8*)m_curve_keys - (size_t)this - sizeof(AnimationClip) );
+        m_curve_key_frames = (u16*)( (u8*)m_curve_key_frames - (size_t)this - sizeof(AnimationClip) );
+        m_curve_joint_keys = (u32*)( (u8*)m_curve_joint_keys - (size_t)this - sizeof(AnimationClip) );
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+u32 AnimationClip::FindEventCursor( float local_time_ms, bool inclusive ) const
+{
+    u32 first = 0;
+    u32 count = m_event_count;
+    
+    // upper bound if inclusive, lower bound otherwise.
+    while( count > 0 )
+    {
+        u32 step = count / 2;
+        u32 idx = first + step;
+        
+        if( m_events[idx].time_ms < local_time_ms || (inclusive && m_events[idx].time_ms == local_time_ms) )
+        {
+            first = idx + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+    
+    return first;
+}
+
+//---------------------------------------------------------------------------------------
+
+size_t AnimationClip::GetMemoryUsage() const
+{
+    size_t size = sizeof(AnimationClip);
+    
+    if( !HasCurves() )
+        size += (size_t)m_animated_joint_count * m_frame_count * sizeof(JointPose);
+    
+    size += (size_t)m_skeleton_joint_count * sizeof(s16);
+    size += (size_t)m_event_count * sizeof(Event);
+    
+    if( HasCurves() )
+    {
+        size += (size_t)m_curve_key_count * (sizeof(CurveKey) + sizeof(u16));
+        size += ((size_t)m_animated_joint_count + 1) * sizeof(u32);
+    }
+    
+    return size;
+}
+
+//---------------------------------------------------------------------------------------
+
+// quaternion is read and written as 4 floats in constructor order (x, y, z, w).
+static_assert( sizeof(Quaternion) == 4 * sizeof(float), "unexpected Quaternion layout" );
+
+void AnimationClip::EvaluateCurve( const CurveKey& key_a, float frame_a, const CurveKey& key_b, float frame_b, float frame, JointPose& out_pose )
+{
+    float length = frame_b - frame_a;
+    float t = (frame - frame_a) / length;
+    float t2 = t * t;
+    float t3 = t2 * t;
+    
+    // hermite basis, tangent terms scaled from per frame to segment length.
+    float h00 = 2.f * t3 - 3.f * t2 + 1.f;
+    float h10 = (t3 - 2.f * t2 + t) * length;
+    float h01 = -2.f * t3 + 3.f * t2;
+    float h11 = (t3 - t2) * length;
+    
+#if ANIM_CURVE_SSE
+    __m128 b00 = _mm_set1_ps( h00 );
+    __m128 b10 = _mm_set1_ps( h10 );
+    __m128 b01 = _mm_set1_ps( h01 );
+    __m128 b11 = _mm_set1_ps( h11 );
+    
+    __m128 ts = _mm_add_ps(
+        _mm_add_ps( _mm_mul_ps( b00, _mm_loadu_ps( key_a.translation_scale ) ), _mm_mul_ps( b10, _mm_loadu_ps( key_a.translation_scale_tangent ) ) ),
+        _mm_add_ps( _mm_mul_ps( b01, _mm_loadu_ps( key_b.translation_scale ) ), _mm_mul_ps( b11, _mm_loadu_ps( key_b.translation_scale_tangent ) ) ) );
+    
+    __m128 q = _mm_add_ps(
+        _mm_add_ps( _mm_mul_ps( b00, _mm_loadu_ps( key_a.rotation ) ), _mm_mul_ps( b10, _mm_loadu_ps( key_a.rotation_tangent ) ) ),
+        _mm_add_ps( _mm_mul_ps( b01, _mm_loadu_ps( key_b.rotation ) ), _mm_mul_ps( b11, _mm_loadu_ps( key_b.rotation_tangent ) ) ) );
+    
+    // normalize rotation (dot product broadcast to all lanes).
+    __m128 dot = _mm_mul_ps( q, q );
+    dot = _mm_add_ps( dot, _mm_shuffle_ps( dot, dot, _MM_SHUFFLE(2, 3, 0, 1) ) );
+    dot = _mm_add_ps( dot, _mm_shuffle_ps( dot, dot, _MM_SHUFFLE(1, 0, 3, 2) ) );
+    q = _mm_div_ps( q, _mm_sqrt_ps( dot ) );
+    
+    float translation_scale[4];
+    _mm_storeu_ps( translation_scale, ts );
+    _mm_storeu_ps( (float*)&out_pose.rotation, q );
+#else
+    float translation_scale[4];
+    float rotation[4];
+    
+    for( u32 i = 0; i < 4; ++i )
+    {
+        translation_scale[i] = h00 * key_a.translation_scale[i] + h10 * key_a.translation_scale_tangent[i]
+                             + h01 * key_b.translation_scale[i] + h11 * key_b.translation_scale_tangent[i];
+        
+        rotation[i] = h00 * key_a.rotation[i] + h10 * key_a.rotation_tangent[i]
+                    + h01 * key_b.rotation[i] + h11 * key_b.rotation_tangent[i];
+    }
+    
+    float inv_length = 1.f / sqrtf( rotation[0] * rotation[0] + rotation[1] * rotation[1] + rotation[2] * rotation[2] + rotation[3] * rotation[3] );
+    out_pose.rotation = Quaternion( rotation[0] * inv_length, rotation[1] * inv_length, rotation[2] * inv_length, rotation[3] * inv_length );
+#endif
+    
+    out_pose.translation = Vec3( translation_scale[0], translation_scale[1], translation_scale[2] );
+    out_pose.scale = translation_scale[3];
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationClip::GetCurvePose( const SampleCursor& cursor, u32 joint_idx, JointPose& out_pose ) const
+{
+    u32 first = m_curve_joint_keys[joint_idx];
+    u32 last = m_curve_joint_keys[joint_idx + 1] - 1;
+    
+    ANIM_STAT_ADD(joints_sampled, 1);
+    
+    // looped clip blends last frame with the first one.
+    if( cursor.upper_frame < cursor.lower_frame )
+    {
+        ANIM_STAT_ADD(clip_bytes, 2 * sizeof(CurveKey) + sizeof(s16));
+        
+        const CurveKey& a = m_curve_keys[last];
+        const CurveKey& b = m_curve_keys[first];
+        
+        JointPose pose_a, pose_b;
+        pose_a.translation = Vec3( a.translation_scale[0], a.translation_scale[1], a.translation_scale[2] );
+        pose_a.scale = a.translation_scale[3];
+        pose_a.rotation = Quaternion( a.rotation[0], a.rotation[1], a.rotation[2], a.rotation[3] );
+        pose_b.translation = Vec3( b.translation_scale[0], b.translation_scale[1], b.translation_scale[2] );
+        pose_b.scale = b.translation_scale[3];
+        pose_b.rotation = Quaternion( b.rotation[0], b.rotation[1], b.rotation[2], b.rotation[3] );
+        
+        out_pose.MakeLerp( pose_a, pose_b, cursor.factor );
+        return;
+    }
+    
+    float frame = (float)cursor.lower_frame + cursor.factor;
+    
+    // last key with key frame <= lower frame. cursor keeps no key index (keys differ per joint), so the search
+    // covers all keys of the joint.
+    u32 lo = first;
+    u32 hi = last;
+    
+    while( lo < hi )
+    {
+        u32 mid = (lo + hi + 1) / 2;
+        
+        if( m_curve_key_frames[mid] <= cursor.lower_frame )
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    
+    if( lo == last )
+        lo = last > first ? last - 1 : first;
+    
+    u32 next = lo < last ? lo + 1 : lo;
+    
+    if( next == lo )
+    {
+        // single key joint.
+        ANIM_STAT_ADD(clip_bytes, sizeof(CurveKey) + sizeof(s16));
+        
+        const CurveKey& key = m_curve_keys[lo];
+        out_pose.translation = Vec3( key.translation_scale[0], key.translation_scale[1], key.translation_scale[2] );
+        out_pose.scale = key.translation_scale[3];
+        out_pose.rotation = Quaternion( key.rotation[0], key.rotation[1], key.rotation[2], key.rotation[3] );
+        return;
+    }
+    
+    EvaluateCurve( m_curve_keys[lo], (float)m_curve_key_frames[lo], m_curve_keys[next], (float)m_curve_key_frames[next], frame, out_pose );
+    
+    ANIM_STAT_ADD(clip_bytes, 2 * sizeof(CurveKey) + sizeof(s16));
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimationClip::operator-=( const AnimationClip& source )
+{
+    // curve clips have to be decoded first.
+    if( HasCurves() || source.HasCurves() )
+        return false;
+    
+    if( m_skeleton_joint_count != source.m_skeleton_joint_count
+       || m_frames_per_ms != source.m_frames_per_ms
+       || m_frame_count != source.m_frame_count )
+        return false;
+    
+    // traits of the difference are unknown until clip is cooked again.
+    m_traits = ClipTraits::Additive;
+    m_translation_joint = -1;
+  
+    for( u32 f = 0; f < m_frame_count; ++f )
+    {
+        for( u32 i = 0; i < m_skeleton_joint_count; ++i )
+        {
+            if( HasJointPose(i) )
+            {
+                // joint data is stored at remapped index (both clips may omit different joints).
+                s16 pose_idx = m_joint_remap[i];
+                
+                JointPose pose = GetJointPose(f, pose_idx);
+                
+                if( source.HasJointPose(i) )
+                {
+                    const JointPose& source_pose = source.GetJointPose(f, source.m_joint_remap[i]);
+                    pose -= source_pose;
+                }
+                
+                // update joint position.
+                u32 array_index = f * m_animated_joint_count + pose_idx;
+                m_joint_poses[array_index] = pose;
+            }
+        }
+    }
+    
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
+
@@ -1,225 +1,479 @@
-#pragma once
-
-#include "engine/core/StringId.h"
-#include "engine/math/Quaternion.h"
-#include "engine/math/Vec3.h"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-
-class AnimationClip
-{
-public:
-	AnimationClip();
-	~AnimationClip();
-    
-    // used to generate additive clip (refference - source clip).
-    bool operator-=( const AnimationClip& source );
-    
-	void BreakPointers();
-	void FixPointers();
-	
-	//---------------------------------------------------------------------------------------
-
-	// joint poses stored translation vector/quaternion rotation/uniform scale format.
-	// uniform scale is used to reduce amount memory needed to store AnimationClips.
-	// each JointPose stores local joint pose what enables us to blend different AnimationClips.
-	struct JointPose
-	{
-		JointPose();
-		inline JointPose( const JointPose& p );
-        inline JointPose& operator-=( const JointPose& rhs );
-        
-		inline void toMatrix(Matrix4x4& out) const;
-        
-        inline void MakeLerp( const JointPose& poseA, const JointPose& poseB, float factor );
-        inline void AdditiveAdd( const JointPose& poseB, float factor );
-        
-		Quaternion rotation;
-		Vec3 translation;
-		float scale; // uniform scale.
-	};
-	
-	//---------------------------------------------------------------------------------------
-
-	// animations name.
-	inline StringId GetName() const;
-
-	// returns duration of the animation in milliseconds. (m_frame_count [- 1] / m_frames_per_ms).
-    // looped animations last frame is skipped (same as first frame).
-	inline float GetDuration( bool looped ) const;
-
-	// returns joint pose in between frames for specified joint index. JointPose is inTQS format for further blending.
-	inline void	GetJointPose(float localTimeMs, s16 jointIdx, JointPose& outPose, bool looped) const;
-	
-    // returns true if joint is animated in this clip.
-	inline bool HasJointPose(s16 joint_idx) const;
-
-private:
-	//! returns sample time i.e. 3.3 - frame between frame 3 and frame 4. used to get blended in between joint pose.
-	inline float GetSampleTime(float local_time_ms) const;
-    
-    // returns joint pose at given frame for given joint index.
-    inline const JointPose& GetJointPose( u32 frame, u32 joint_idx ) const;
-
-public:
-	//! name of the animation.
-	StringId m_name;
-
-	//! total number of skeleton joints. (joint_remap array size).
-	s16 m_skeleton_joint_count;
-    
-    //! joints animated in this animation clip. (joint_poses array size).
-    s16 m_animated_joint_count;
-
-	//! frames per second * 0.001f. milliseconds used to avoid float precision errors.
-	float m_frames_per_ms;
-
-	//! number of baked frames.
-	u32 m_frame_count;
-
-	//! baked animation poses. array of m_frame_count*m_joint_count poses.
-	JointPose* m_joint_poses;
-
-	//! joint remap array. stores actual index of joint data. -1 if joint doesn't participate in this animation.
-	s16* m_joint_remap;
-};
-    
-//---------------------------------------------------------------------------------------
-
-inline AnimationClip::JointPose& AnimationClip::JointPose::operator-=( const JointPose& rhs )
-{
-    translation -= rhs.translation;
-    scale -= rhs.scale;
-    
-    // Q1 * Q2 = Q3
-    // Q2 = Q3 * Q1^-1
-    Quaternion inv = rhs.rotation.inverse();
-    inv.normalize();
-    rotation = inv * rotation;
-    
-    return *this;
-}
-
-//---------------------------------------------------------------------------------------
-
-inline void AnimationClip::JointPose::AdditiveAdd(const JointPose &pose_b, float factor)
-{
-    translation += pose_b.translation * factor;
-    rotation = Quaternion::SLERP(rotation, rotation * pose_b.rotation, factor);
-    scale += pose_b.scale * factor;
-}
-
-//---------------------------------------------------------------------------------------
-    
-inline AnimationClip::JointPose::JointPose()
-{
-}
-    
-//---------------------------------------------------------------------------------------
-    
-inline AnimationClip::JointPose::JointPose(const JointPose& p)
-{
-    translation = p.translation;
-    rotation = p.rotation;
-    scale = p.scale;
-}
-
-//---------------------------------------------------------------------------------------
-    
-inline void AnimationClip::JointPose::toMatrix(Matrix4x4& out) const
-{
-    out.MakeScale(scale, scale, scale);
-    
-    Matrix4x4 rot;
-    rotation.toMatrix(rot);
-    
-    out *= rot;
-    
-    out.matrix[12] = translation.x;
-    out.matrix[13] = translation.y;
-    out.matrix[14] = translation.z;
-}
-    
-//---------------------------------------------------------------------------------------
-    
-inline void AnimationClip::JointPose::MakeLerp( const JointPose& poseA, const JointPose& poseB, float factor )
-{
-    translation = Vec3::LERP(poseA.translation, poseB.translation, factor);
-    rotation = Quaternion::SLERP(poseA.rotation, poseB.rotation, factor);
-    scale = Math::Lerp(poseA.scale, poseB.scale, factor);
-}
-	
-//---------------------------------------------------------------------------------------
-
-inline StringId AnimationClip::GetName() const
-{
-    return m_name;
-}
-
-//---------------------------------------------------------------------------------------
-
-inline float AnimationClip::GetDuration(bool looped) const
-{
-    return looped ? m_frame_count / m_frames_per_ms : (m_frame_count-1) / m_frames_per_ms;
-}
-
-//---------------------------------------------------------------------------------------
-
-inline float AnimationClip::GetSampleTime(float local_time_ms) const
-{
-    return local_time_ms * m_frames_per_ms;
-}
-
-//---------------------------------------------------------------------------------------
-
-inline const AnimationClip::JointPose& AnimationClip::GetJointPose( u32 frame, u32 joint_idx ) const
-{
-    u32 array_index = frame * m_animated_joint_count + joint_idx;
-    
-    ENGINE_ASSERT(array_index < m_animated_joint_count * m_frame_count, "joint out of bounds");
-    return m_joint_poses[ array_index ];
-}
-    
-//---------------------------------------------------------------------------------------
-    
-inline bool	AnimationClip::HasJointPose(s16 joint_idx) const
-{
-    return m_joint_remap[joint_idx] != -1;
-}
-    
-//---------------------------------------------------------------------------------------
-    
-inline void AnimationClip::GetJointPose(float local_time_ms, s16 jointIdx, JointPose& outPose, bool looped) const
-{
-    ENGINE_ASSERT(HasJointPose(jointIdx), "");
-    
-    s16 realJointIdx = m_joint_remap[jointIdx];
-    
-    float sample_time = GetSampleTime(local_time_ms);
-    
-    // blended samples.
-    u32 lower_sample = (u32)Math::Floor<float>(sample_time);
-    u32 upper_sample = (u32)Math::Ceil<float>(sample_time);
-    
-    // blend factor.
-    float factor = sample_time - (float)lower_sample;
-    
-    if( looped )
-    {
-        // for looped clip - blend last frame with the first one.
-        if( upper_sample == m_frame_count )
-            upper_sample = 0;
-    }
-    
-    const JointPose& lower_pose = GetJointPose(lower_sample, realJointIdx);
-    const JointPose& upper_pose = GetJointPose(upper_sample, realJointIdx);
-    
-    // sample blending.
-    outPose.MakeLerp(lower_pose, upper_pose, factor);
-}
-    
-//---------------------------------------------------------------------------------------
-} // namespace Engine
-//---------------------------------------------------------------------------------------
+#pragma once
+
+#include "engine/core/StringId.h"
+#include "engine/math/Quaternion.h"
+#include "engine/math/Vec3.h"
+#include "engine/animation/AnimStats.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// channel traits of a clip, detected at cook time. traits select specialized sampling and
+// blending kernels which skip channels known to be constant.
+namespace ClipTraits{
+    enum Enum{
+        None = 0,
+        
+        // scale is identity on all joints and frames (1, additive clips 0).
+        IdentityScale = 1 << 0,
+        
+        // additive translation is 0 on all joints except translation joint.
+        IdentityTranslation = 1 << 1,
+        
+        // translation doesn't change over time on all joints except translation joint.
+        StaticTranslation = 1 << 2,
+        
+        // clip stores additive poses.
+        Additive = 1 << 3,
+        
+        // traits kept by blending (lerp/additive of two poses sharing the trait keeps it).
+        BlendMask = IdentityScale | IdentityTranslation
+    };
+}
+
+//---------------------------------------------------------------------------------------
+
+class AnimationClip
+{
+public:
+    // 'ANCL'
+    static const u32 Magic = 0x4c434e41;
+    
+    // bumped whenever header or array layout changes, blobs of other versions have to be re-cooked.
+    static const u32 Version = 1;
+    
+public:
+	AnimationClip();
+	~AnimationClip();
+    
+    // true if blob was written with current header layout (checked before FixPointers).
+    inline bool IsCurrentVersion() const { return m_magic == Magic && m_version == Version; }
+    
+    // used to generate additive clip (refference - source clip).
+    bool operator-=( const AnimationClip& source );
+    
+	void BreakPointers();
+	void FixPointers();
+	
+	//---------------------------------------------------------------------------------------
+
+	// joint poses stored translation vector/quaternion rotation/uniform scale format.
+	// uniform scale is used to reduce amount memory needed to store AnimationClips.
+	// each JointPose stores local joint pose what enables us to blend different AnimationClips.
+	struct JointPose
+	{
+		JointPose();
+		inline JointPose( const JointPose& p );
+        inline JointPose& operator-=( const JointPose& rhs );
+        
+		inline void toMatrix(Matrix4x4& out) const;
+        
+        inline void MakeLerp( const JointPose& poseA, const JointPose& poseB, float factor );
+        inline void AdditiveAdd( const JointPose& poseB, float factor );
+        
+        // versions specialized for pose traits (ClipTraits::BlendMask bits shared by both poses).
+        inline void MakeLerp( const JointPose& poseA, const JointPose& poseB, float factor, u32 traits );
+        inline void AdditiveAdd( const JointPose& poseB, float factor, u32 traits );
+        
+        // kernels skipping channels known to be equal on both poses (copied from pose_a) or
+        // identity on additive pose. indexed by (skip translation << 1) | skip scale.
+        template<bool SKIP_TRANSLATION, bool SKIP_SCALE>
+        static inline void LerpKernel( JointPose& out, const JointPose& pose_a, const JointPose& pose_b, float factor );
+        
+        template<bool SKIP_TRANSLATION, bool SKIP_SCALE>
+        static inline void AdditiveKernel( JointPose& out, const JointPose& pose_b, float factor );
+        
+        typedef void (*LerpFunc)( JointPose& out, const JointPose& pose_a, const JointPose& pose_b, float factor );
+        typedef void (*AdditiveFunc)( JointPose& out, const JointPose& pose_b, float factor );
+        
+        static const LerpFunc s_lerp_kernels[4];
+        static const AdditiveFunc s_additive_kernels[4];
+        
+		Quaternion rotation;
+		Vec3 translation;
+		float scale; // uniform scale.
+	};
+	
+	//---------------------------------------------------------------------------------------
+    
+    // sampling position within the clip. computed once per update and reused by every joint sample.
+    // stores frame indices only, curve clips search keys of every joint from them.
+    struct SampleCursor
+    {
+        // local time the cursor was computed for.
+        float local_time_ms;
+        
+        // blended frames.
+        u32 lower_frame;
+        u32 upper_frame;
+        
+        // blend factor between lower and upper frame.
+        float factor;
+    };
+    
+	//---------------------------------------------------------------------------------------
+    
+    // cubic hermite key of a single joint (optional curve encoding, used instead of dense frames).
+    // translation and uniform scale form one 4 component curve, rotation (x, y, z, w) a second one
+    // which is normalized after evaluation. tangents are per frame.
+    struct CurveKey
+    {
+        float translation_scale[4];
+        float rotation[4];
+        float translation_scale_tangent[4];
+        float rotation_tangent[4];
+    };
+    
+	//---------------------------------------------------------------------------------------
+    
+    // named event on the clip timeline (footstep, hit frame...).
+    struct Event
+    {
+        // event time in milliseconds.
+        float time_ms;
+        
+        // event name.
+        StringId name;
+    };
+    
+	//---------------------------------------------------------------------------------------
+
+	// animations name.
+	inline StringId GetName() const;
+
+	// returns duration of the animation in milliseconds. (m_frame_count [- 1] / m_frames_per_ms).
+    // looped animations last frame is skipped (same as first frame).
+	inline float GetDuration( bool looped ) const;
+
+	// returns joint pose in between frames for specified joint index. JointPose is inTQS format for further blending.
+	inline void	GetJointPose(float localTimeMs, s16 jointIdx, JointPose& outPose, bool looped) const;
+    
+    // returns joint pose at cursor position.
+    inline void GetJointPose(const SampleCursor& cursor, s16 joint_idx, JointPose& out_pose) const;
+    
+    // moves cursor to given local time. frames are uniformly spaced, so the frame interval is computed
+    // directly from the time (previous cursor position is not used).
+    inline void UpdateCursor(float local_time_ms, bool looped, SampleCursor& cursor) const;
+    
+    // true if joint poses are stored as hermite curves instead of dense frames.
+    inline bool HasCurves() const { return m_curve_key_count > 0; }
+    
+    // evaluates hermite segment between two keys at frame (between key frames).
+    static void EvaluateCurve(const CurveKey& key_a, float frame_a, const CurveKey& key_b, float frame_b, float frame, JointPose& out_pose);
+	
+    // returns true if joint is animated in this clip.
+	inline bool HasJointPose(s16 joint_idx) const;
+    
+    // ClipTraits of joint pose. translation traits are cleared for translation joint.
+    inline u32 GetJointTraits(s16 joint_idx) const;
+    
+    // number of events in the clip.
+    inline u32 GetEventCount() const { return m_event_count; }
+    
+    // events are sorted by time.
+    inline const Event& GetEvent(u32 idx) const;
+    
+    // returns number of events with time <= local_time_ms, or < local_time_ms if not inclusive (binary search).
+    u32 FindEventCursor(float local_time_ms, bool inclusive) const;
+    
+    // bytes of clip block (header and arrays, alignment padding is not included).
+    size_t GetMemoryUsage() const;
+
+private:
+	//! returns sample time i.e. 3.3 - frame between frame 3 and frame 4. used to get blended in between joint pose.
+	inline float GetSampleTime(float local_time_ms) const;
+    
+    // returns joint pose at given frame for given joint index.
+    inline const JointPose& GetJointPose( u32 frame, u32 joint_idx ) const;
+    
+    // evaluates curve of animated joint at cursor position.
+    void GetCurvePose( const SampleCursor& cursor, u32 joint_idx, JointPose& out_pose ) const;
+
+public:
+    //! AnimationClip::Magic.
+    u32 m_magic;
+    
+    //! AnimationClip::Version the blob was written with.
+    u32 m_version;
+    
+	//! name of the animation.
+	StringId m_name;
+
+	//! total number of skeleton joints. (joint_remap array size).
+	s16 m_skeleton_joint_count;
+    
+    //! joints animated in this animation clip. (joint_poses array size).
+    s16 m_animated_joint_count;
+
+	//! frames per second * 0.001f. milliseconds used to avoid float precision errors.
+	float m_frames_per_ms;
+
+	//! number of baked frames.
+	u32 m_frame_count;
+
+	//! baked animation poses. array of m_frame_count*m_joint_count poses.
+	JointPose* m_joint_poses;
+
+	//! joint remap array. stores actual index of joint data. -1 if joint doesn't participate in this animation.
+	s16* m_joint_remap;
+    
+    //! number of timeline events.
+    u32 m_event_count;
+    
+    //! timeline events sorted by time. null if there are no events.
+    Event* m_events;
+    
+    //! number of curve keys of all joints. 0 if joint poses are stored in m_joint_poses.
+    u32 m_curve_key_count;
+    
+    //! curve keys, joint after joint. null if there are no curves.
+    CurveKey* m_curve_keys;
+    
+    //! frame of every curve key (increasing within a joint, first is 0, last is m_frame_count - 1).
+    u16* m_curve_key_frames;
+    
+    //! first key of every animated joint (m_animated_joint_count + 1 entries).
+    u32* m_curve_joint_keys;
+    
+    //! ClipTraits detected at cook time.
+    u32 m_traits;
+    
+    //! animated joint excluded from translation traits (i.e. root motion). -1 if there is none.
+    s16 m_translation_joint;
+};
+    
+//---------------------------------------------------------------------------------------
+
+inline AnimationClip::JointPose& AnimationClip::JointPose::operator-=( const JointPose& rhs )
+{
+    translation -= rhs.translation;
+    scale -= rhs.scale;
+    
+    // Q1 * Q2 = Q3
+    // Q2 = Q3 * Q1^-1
+    Quaternion inv = rhs.rotation.inverse();
+    inv.normalize();
+    rotation = inv * rotation;
+    
+    return *this;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline void AnimationClip::JointPose::AdditiveAdd(const JointPose &pose_b, float factor)
+{
+    translation += pose_b.translation * factor;
+    rotation = Quaternion::SLERP(rotation, rotation * pose_b.rotation, factor);
+    scale += pose_b.scale * factor;
+    
+    ANIM_STAT_ADD(slerps, 1);
+}
+
+//---------------------------------------------------------------------------------------
+
+template<bool SKIP_TRANSLATION, bool SKIP_SCALE>
+inline void AnimationClip::JointPose::LerpKernel( JointPose& out, const JointPose& pose_a, const JointPose& pose_b, float factor )
+{
+    out.translation = SKIP_TRANSLATION ? pose_a.translation : Vec3::LERP(pose_a.translation, pose_b.translation, factor);
+    out.rotation = Quaternion::SLERP(pose_a.rotation, pose_b.rotation, factor);
+    out.scale = SKIP_SCALE ? pose_a.scale : Math::Lerp(pose_a.scale, pose_b.scale, factor);
+    
+    ANIM_STAT_ADD(slerps, 1);
+    ANIM_STAT_ADD(channels_skipped, (SKIP_TRANSLATION ? 1 : 0) + (SKIP_SCALE ? 1 : 0));
+}
+
+//---------------------------------------------------------------------------------------
+
+template<bool SKIP_TRANSLATION, bool SKIP_SCALE>
+inline void AnimationClip::JointPose::AdditiveKernel( JointPose& out, const JointPose& pose_b, float factor )
+{
+    if( !SKIP_TRANSLATION )
+        out.translation += pose_b.translation * factor;
+    
+    out.rotation = Quaternion::SLERP(out.rotation, out.rotation * pose_b.rotation, factor);
+    
+    if( !SKIP_SCALE )
+        out.scale += pose_b.scale * factor;
+    
+    ANIM_STAT_ADD(slerps, 1);
+    ANIM_STAT_ADD(channels_skipped, (SKIP_TRANSLATION ? 1 : 0) + (SKIP_SCALE ? 1 : 0));
+}
+
+//---------------------------------------------------------------------------------------
+
+inline void AnimationClip::JointPose::MakeLerp( const JointPose& poseA, const JointPose& poseB, float factor, u32 traits )
+{
+    s_lerp_kernels[traits & ClipTraits::BlendMask]( *this, poseA, poseB, factor );
+}
+
+//---------------------------------------------------------------------------------------
+
+inline void AnimationClip::JointPose::AdditiveAdd( const JointPose& poseB, float factor, u32 traits )
+{
+    s_additive_kernels[traits & ClipTraits::BlendMask]( *this, poseB, factor );
+}
+
+//---------------------------------------------------------------------------------------
+    
+inline AnimationClip::JointPose::JointPose()
+{
+}
+    
+//---------------------------------------------------------------------------------------
+    
+inline AnimationClip::JointPose::JointPose(const JointPose& p)
+{
+    translation = p.translation;
+    rotation = p.rotation;
+    scale = p.scale;
+}
+
+//---------------------------------------------------------------------------------------
+    
+inline void AnimationClip::JointPose::toMatrix(Matrix4x4& out) const
+{
+    out.MakeScale(scale, scale, scale);
+    
+    Matrix4x4 rot;
+    rotation.toMatrix(rot);
+    
+    out *= rot;
+    
+    out.matrix[12] = translation.x;
+    out.matrix[13] = translation.y;
+    out.matrix[14] = translation.z;
+}
+    
+//---------------------------------------------------------------------------------------
+    
+inline void AnimationClip::JointPose::MakeLerp( const JointPose& poseA, const JointPose& poseB, float factor )
+{
+    translation = Vec3::LERP(poseA.translation, poseB.translation, factor);
+    rotation = Quaternion::SLERP(poseA.rotation, poseB.rotation, factor);
+    scale = Math::Lerp(poseA.scale, poseB.scale, factor);
+    
+    ANIM_STAT_ADD(slerps, 1);
+}
+	
+//---------------------------------------------------------------------------------------
+
+inline StringId AnimationClip::GetName() const
+{
+    return m_name;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline float AnimationClip::GetDuration(bool looped) const
+{
+    return looped ? m_frame_count / m_frames_per_ms : (m_frame_count-1) / m_frames_per_ms;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline float AnimationClip::GetSampleTime(float local_time_ms) const
+{
+    return local_time_ms * m_frames_per_ms;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline const AnimationClip::JointPose& AnimationClip::GetJointPose( u32 frame, u32 joint_idx ) const
+{
+    u32 array_index = frame * m_animated_joint_count + joint_idx;
+    
+    ENGINE_ASSERT(array_index < m_animated_joint_count * m_frame_count, "joint out of bounds");
+    return m_joint_poses[ array_index ];
+}
+    
+//---------------------------------------------------------------------------------------
+    
+inline bool	AnimationClip::HasJointPose(s16 joint_idx) const
+{
+    return m_joint_remap[joint_idx] != -1;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline u32 AnimationClip::GetJointTraits(s16 joint_idx) const
+{
+    if( m_joint_remap[joint_idx] == m_translation_joint )
+        return m_traits & ~(ClipTraits::StaticTranslation | ClipTraits::IdentityTranslation);
+    
+    return m_traits;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline const AnimationClip::Event& AnimationClip::GetEvent(u32 idx) const
+{
+    ENGINE_ASSERT(idx < m_event_count, "event out of bounds");
+    return m_events[idx];
+}
+    
+//---------------------------------------------------------------------------------------
+    
+inline void AnimationClip::UpdateCursor(float local_time_ms, bool looped, SampleCursor& cursor) const
+{
+    // frames are uniformly spaced, so the interval is computed directly.
+    float sample_time = GetSampleTime(local_time_ms);
+    
+    // blended samples.
+    cursor.lower_frame = (u32)Math::Floor<float>(sample_time);
+    cursor.upper_frame = (u32)Math::Ceil<float>(sample_time);
+    
+    // blend factor.
+    cursor.factor = sample_time - (float)cursor.lower_frame;
+    
+    if( looped )
+    {
+        // for looped clip - blend last frame with the first one.
+        if( cursor.upper_frame == m_frame_count )
+            cursor.upper_frame = 0;
+    }
+    
+    cursor.local_time_ms = local_time_ms;
+}
+    
+//---------------------------------------------------------------------------------------
+    
+inline void AnimationClip::GetJointPose(const SampleCursor& cursor, s16 joint_idx, JointPose& out_pose) const
+{
+    ENGINE_ASSERT(HasJointPose(joint_idx), "");
+    
+    s16 real_joint_idx = m_joint_remap[joint_idx];
+    
+    if( HasCurves() )
+    {
+        GetCurvePose(cursor, real_joint_idx, out_pose);
+        return;
+    }
+    
+    const JointPose& lower_pose = GetJointPose(cursor.lower_frame, real_joint_idx);
+    const JointPose& upper_pose = GetJointPose(cursor.upper_frame, real_joint_idx);
+    
+    // constant channels are copied from lower frame.
+    u32 traits = GetJointTraits(joint_idx);
+    u32 kernel = (traits & ClipTraits::IdentityScale) | ((traits & ClipTraits::StaticTranslation) >> 1);
+    
+    // sample blending.
+    JointPose::s_lerp_kernels[kernel](out_pose, lower_pose, upper_pose, cursor.factor);
+    
+    ANIM_STAT_ADD(joints_sampled, 1);
+    ANIM_STAT_ADD(clip_bytes, 2 * sizeof(JointPose) + sizeof(s16));
+}
+    
+//---------------------------------------------------------------------------------------
+    
+inline void AnimationClip::GetJointPose(float local_time_ms, s16 jointIdx, JointPose& outPose, bool looped) const
+{
+    SampleCursor cursor;
+    UpdateCursor(local_time_ms, looped, cursor);
+    
+    GetJointPose(cursor, jointIdx, outPose);
+}
+    
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
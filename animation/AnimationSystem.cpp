@@ -1,154 +1,1597 @@
-#include "engine/animation/AnimationSystem.h"
-#include "engine/animation/Skeleton.h"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-
-AnimationSystem::AnimationSystem( u32 max_controller_count )
-: m_controllers(max_controller_count)
-{
-    
-}
-
-//---------------------------------------------------------------------------------------
-    
-Handle AnimationSystem::CreateController( Skeleton* skeleton, u32 layer_count )
-{
-    if( !m_controllers.CanAdd() )
-        return (Handle)-1;
-    
-    Handle h = m_controllers.Add();
-    AnimController& controller = m_controllers.Get(h);
-    controller.Initialize( skeleton, layer_count );
-    
-    return h;
-}
-
-//---------------------------------------------------------------------------------------
-
-void AnimationSystem::DestroyController( Handle h )
-{
-    AnimController& controller = m_controllers.Get(h);
-    controller.Release();
-    m_controllers.Remove(h);
-}
-
-//---------------------------------------------------------------------------------------
-
-bool AnimationSystem::HasController( Handle h )
-{
-    return m_controllers.Exists(h);
-}
-
-//---------------------------------------------------------------------------------------
-
-AnimController& AnimationSystem::GetController( Handle h )
-{
-    return m_controllers.Get(h);
-}
-
-//---------------------------------------------------------------------------------------
-
-void AnimationSystem::Update( float delta_ms )
-{
-    for( u32 i = 0; i < m_controllers.Count(); ++i )
-    {
-        AnimController& controller = m_controllers[i];
-        
-        controller.Update( delta_ms );
-    }
-}
-    
-//---------------------------------------------------------------------------------------
-
-void AnimationSystem::LocalPoseCalculation()
-{
-    // todo: can be easly run in parallel.
-    for( u32 i = 0; i < m_controllers.Count(); ++i )
-    {
-        AnimController& controller = m_controllers[i];
-        Skeleton* skeleton = controller.GetSkeleton();
-        AnimHierarchy* hierarchy = controller.GetHierarchy();
-        
-        for( u16 j = 0; j < skeleton->GetJointCount(); ++j )
-        {
-            AnimationClip::JointPose local_pose;
-            controller.GetJointPose( j, local_pose );
-            
-            AnimTransformation& node = hierarchy->GetNode(j);
-            
-            node.SetTranslation( local_pose.translation );
-            node.SetScale( local_pose.scale );
-            node.SetRotation( local_pose.rotation );
-            
-            node.CalculateLocalTransformation();
-        }
-    }
-}
-
-//---------------------------------------------------------------------------------------
-
-void AnimationSystem::GlobalPoseCalculation()
-{
-    // todo: can be easly run in parallel.
-    for( u32 i = 0; i < m_controllers.Count(); ++i )
-    {
-        AnimController& controller = m_controllers[i];
-        AnimHierarchy* hierarchy = controller.GetHierarchy();
-        
-        hierarchy->CalculateGlobalTransformation();
-    }
- }
-
-//---------------------------------------------------------------------------------------
-
-void AnimationSystem::MatrixPaletteGeneration()
-{
-    // todo: can be easly run in parallel.
-    for( u32 i = 0; i < m_controllers.Count(); ++i )
-    {
-        AnimController& controller = m_controllers[i];
-        AnimHierarchy* hierarchy = controller.GetHierarchy();
-        Skeleton* skeleton = controller.GetSkeleton();
-        Matrix4x4* palette = controller.GetSkinningPalette();
-        
-        // we need inverse matrix of root node's world transformation to calculate model-space palette.
-        Matrix4x4 parentInvMatrix = hierarchy->GetNode(0).GetWorldTransformation();
-        parentInvMatrix.InverseIt();
-        
-        for( u16 j = 0; j < hierarchy->GetNodeCount(); ++j )
-        {
-            // creating skinning palette.
-            // K = (Bj_M)^-1 * Cj_M
-            // palette matrix is inverse bind pose in model-space multiplied by current pose in model-space.
-            
-            // world-space matrix
-            palette[j] = hierarchy->GetNode(j).GetWorldTransformation();
-            
-            // world-space -> model-space
-            palette[j] = parentInvMatrix * palette[j];
-            
-            // skinning palette matrix ( model-space * inverse bind pose )
-            palette[j] *= skeleton->GetInvBindPose(j);
-        }
-    }
-}
-    
-//---------------------------------------------------------------------------------------
-    
-void AnimationSystem::Draw( DebugRenderer& rend )
-{
-    for( u32 i = 0; i < m_controllers.Count(); ++i )
-    {
-        AnimController& controller = m_controllers[i];
-        AnimHierarchy* hierarchy = controller.GetHierarchy();
-        
-        hierarchy->Draw( rend );
-    }
-}
-    
-//---------------------------------------------------------------------------------------
-}; //namespace Engine
-//---------------------------------------------------------------------------------------
-
+#include "engine/animation/AnimationSystem.h"
+#include "engine/animation/Skeleton.h"
+#include "engine/animation/AnimPaletteBuffer.h"
+#include "engine/animation/AnimTrace.h"
+#include "engine/animation/AnimRecorder.h"
+#include "engine/animation/AnimJointQuery.h"
+#include "engine/animation/AnimStates.h"
+#include "engine/animation/AnimMotionDatabase.h"
+#include <algorithm>
+#include <atomic>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+#if ANIM_TRACE
+// trace event names of AnimStage values.
+static const char* s_stage_names[AnimStage::Count] = { "Update", "LocalPose", "GlobalPose", "Palette" };
+static const char* s_batch_names[AnimStage::Count] = { "UpdateBatch", "LocalPoseBatch", "GlobalPoseBatch", "PaletteBatch" };
+#endif
+
+//---------------------------------------------------------------------------------------
+
+AnimationSystem::AnimationSystem( u32 max_controller_count )
+: m_controllers(max_controller_count)
+, m_bounds_enabled(false)
+, m_hit_shapes_enabled(false)
+, m_bounds_padding(0.f)
+, m_batch_size(16)
+, m_prune_epsilon(0.f)
+, m_recorder(nullptr)
+, m_memory_budget(0)
+, m_memory_high_water(0)
+, m_instance_memory(0)
+, m_asset_memory(0)
+, m_over_budget(false)
+, m_baking_enabled(false)
+, m_baked_interpolate(false)
+, m_instance_batching(false)
+, m_evaluation_order_dirty(true)
+, m_active_order_dirty(true)
+, m_instance_groups_dirty(true)
+, m_sleeping_enabled(true)
+, m_compaction_interval(0)
+, m_frames_since_compaction(0)
+, m_node_arena(nullptr)
+, m_palette_arena(nullptr)
+, m_pipelined(false)
+, m_frame_in_flight(false)
+, m_frame_requested(false)
+, m_frame_thread_quit(false)
+, m_frame_delta_ms(0.f)
+, m_frame_buffer(nullptr)
+, m_frame_region((u32)-1)
+{
+    m_first_capsule = new u32[max_controller_count];
+    m_first_box = new u32[max_controller_count];
+    
+#if ANIM_STATS
+    m_frame_stats.Reset();
+    
+    for( u32 i = 0; i < AnimStatMaxWorkers; ++i )
+    {
+        m_worker_counters[i].Reset();
+        m_worker_busy_ns[i] = 0;
+    }
+#endif
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimationSystem::~AnimationSystem()
+{
+    if( m_frame_in_flight )
+        EndFrame();
+    
+    if( m_frame_thread.joinable() )
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_frame_mutex );
+            m_frame_thread_quit = true;
+        }
+        
+        m_frame_cv.notify_all();
+        m_frame_thread.join();
+    }
+    
+    m_workers.Stop();
+    
+    delete [] m_first_capsule;
+    delete [] m_first_box;
+    
+    for( size_t i = 0; i < m_joint_queries.size(); ++i )
+        delete m_joint_queries[i];
+    
+    delete [] m_node_arena;
+    delete [] m_palette_arena;
+    
+    for( size_t i = 0; i < m_command_buffers.size(); ++i )
+        delete m_command_buffers[i];
+}
+
+//---------------------------------------------------------------------------------------
+    
+Handle AnimationSystem::CreateController( Skeleton* skeleton, u32 layer_count )
+{
+    ENGINE_ASSERT(!m_frame_in_flight, "controller created during pipelined frame");
+    
+    if( !m_controllers.CanAdd() )
+        return (Handle)-1;
+    
+    Handle h = m_controllers.Add();
+    AnimController& controller = m_controllers.Get(h);
+    controller.Initialize( skeleton, layer_count );
+    controller.SetHandle( h );
+    controller.SetWakeList( &m_wake_list );
+    
+    m_evaluation_order_dirty = true;
+    
+    AnimControllerMemory memory;
+    controller.GetMemoryUsage( memory );
+    controller.m_budget_bytes = memory.total;
+    m_instance_memory += memory.total;
+    
+    AddAssetRef( skeleton, skeleton->GetMemoryUsage() );
+    
+    if( m_memory_budget > 0 )
+    {
+        // layer calls since the last update may have changed memory of other controllers.
+        SyncMemoryTotals();
+        
+        if( GetMemoryTotal() > m_memory_budget )
+        {
+            if( m_memory_budget_callback )
+            {
+                AnimMemoryReport report;
+                CalculateMemory( report );
+                m_memory_budget_callback( report );
+            }
+            
+            m_instance_memory -= controller.m_budget_bytes;
+            ReleaseAssetRef( skeleton );
+            controller.Release();
+            m_controllers.Remove(h);
+            return (Handle)-1;
+        }
+    }
+    
+    m_memory_high_water = std::max( m_memory_high_water, GetMemoryTotal() );
+    
+    if( m_recorder )
+    {
+        m_recorder->RecordCreateController( h, skeleton->GetName(), layer_count );
+        controller.SetRecorder( m_recorder );
+    }
+    
+    return h;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::DestroyController( Handle h )
+{
+    ENGINE_ASSERT(!m_frame_in_flight, "controller destroyed during pipelined frame");
+    
+    if( m_recorder )
+        m_recorder->RecordDestroyController( h );
+    
+    AnimController& controller = m_controllers.Get(h);
+    m_instance_memory -= controller.m_budget_bytes;
+    ReleaseAssetRef( controller.GetSkeleton() );
+    
+    for( u32 l = 0; l < controller.GetLayerCount(); ++l )
+        ReleaseStateRefs( controller.m_budget_states[l] );
+    
+    controller.Release();
+    m_controllers.Remove(h);
+    
+    m_evaluation_order_dirty = true;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool AnimationSystem::HasController( Handle h )
+{
+    return m_controllers.Exists(h);
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimController& AnimationSystem::GetController( Handle h )
+{
+    return m_controllers.Get(h);
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::Update( float delta_ms )
+{
+    ENGINE_ASSERT(!m_frame_in_flight, "Update called during pipelined frame");
+    
+    // palettes, bounds and hit shapes are published by the passes again.
+    m_pipelined = false;
+    
+    BeginUpdate( delta_ms );
+    UpdateControllers( delta_ms );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::BeginUpdate( float delta_ms )
+{
+    // commands belong to the frame they were queued in (recorded before the update).
+    ApplyCommands();
+    
+    if( m_recorder )
+        m_recorder->RecordUpdate( delta_ms );
+    
+#if ANIM_STATS
+    // update starts a new frame.
+    m_frame_stats.Reset();
+    
+    for( u32 i = 0; i < AnimStatMaxWorkers; ++i )
+    {
+        m_worker_counters[i].Reset();
+        m_worker_busy_ns[i] = 0;
+    }
+#endif
+    
+    if( m_compaction_interval > 0 && ++m_frames_since_compaction >= m_compaction_interval )
+        Compact();
+    
+    // controllers woken by layer calls since the last update.
+    for( size_t i = 0; i < m_wake_list.size(); ++i )
+    {
+        if( !m_controllers.Exists( m_wake_list[i] ) )
+            continue;
+        
+        AnimController& controller = m_controllers.Get( m_wake_list[i] );
+        
+        // static controllers are still active, Wake only keeps them from falling asleep on the old pose.
+        if( controller.IsSleeping() )
+            m_active_order_dirty = true;
+        
+        if( controller.IsSleeping() || controller.m_static )
+            controller.Wake();
+    }
+    
+    m_wake_list.clear();
+    
+    // growth through layer calls and commands since the last update.
+    if( m_memory_budget > 0 )
+    {
+        SyncMemoryTotals();
+        CheckMemoryBudget();
+    }
+    
+    UpdateEvaluationOrder();
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::UpdateControllers( float delta_ms )
+{
+#if ANIM_STATS
+    // known on the calling thread, so it goes to frame stats directly (batches may not run at all).
+    m_frame_stats.counters.sleeping_controllers += m_controllers.Count() - (u32)m_active_order.size();
+#endif
+    
+    std::atomic<bool> fell_asleep( false );
+    
+    RunControllerBatches( AnimStage::Update, [&]( u32 begin, u32 end, u32 /*worker*/ )
+    {
+        for( u32 k = begin; k < end; ++k )
+        {
+            AnimController& controller = m_controllers[m_active_order[k]];
+            
+            // static pose has been evaluated with the previous update.
+            if( m_sleeping_enabled && controller.m_static )
+            {
+                controller.Sleep( m_pipelined );
+                fell_asleep = true;
+                continue;
+            }
+            
+            controller.Update( delta_ms );
+        }
+    });
+    
+    if( fell_asleep )
+        m_active_order_dirty = true;
+}
+    
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::BeginFrame( float delta_ms )
+{
+    StartFrame( delta_ms, nullptr );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::BeginFrame( float delta_ms, AnimPaletteBuffer& buffer )
+{
+    ENGINE_ASSERT(buffer.GetFrameCount() > 1, "pipelined frames need at least 2 palette buffer regions");
+    
+    StartFrame( delta_ms, &buffer );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::StartFrame( float delta_ms, AnimPaletteBuffer* buffer )
+{
+    ENGINE_ASSERT(!m_frame_in_flight, "BeginFrame called twice without EndFrame");
+    
+    // results of synchronous passes are the first stable frame.
+    if( !m_pipelined )
+    {
+        m_stable_bounds.CopyFrom( m_bounds );
+        m_stable_hit_shapes.CopyFrom( m_hit_shapes );
+        m_pipelined = true;
+    }
+    
+    // controller set and evaluation order are only changed here, not while the frame is evaluated.
+    BeginUpdate( delta_ms );
+    
+    if( !m_frame_thread.joinable() )
+        m_frame_thread = std::thread( &AnimationSystem::FrameThreadMain, this );
+    
+    {
+        std::lock_guard<std::mutex> lock( m_frame_mutex );
+        m_frame_delta_ms = delta_ms;
+        m_frame_buffer = buffer;
+        m_frame_requested = true;
+    }
+    
+    m_frame_in_flight = true;
+    m_frame_cv.notify_all();
+}
+
+//---------------------------------------------------------------------------------------
+
+u32 AnimationSystem::EndFrame()
+{
+    ENGINE_ASSERT(m_frame_in_flight, "EndFrame called without BeginFrame");
+    
+    {
+        ANIM_TRACE_SCOPE( "WaitFrame", 0, 0 );
+        
+        std::unique_lock<std::mutex> lock( m_frame_mutex );
+        m_frame_cv.wait( lock, [this]{ return !m_frame_requested; } );
+    }
+    
+    m_frame_in_flight = false;
+    
+    // sleeping controllers publish their unchanged (or copied) palette.
+    for( u32 i = 0; i < m_controllers.Count(); ++i )
+        m_controllers[i].PublishPalette();
+    
+    m_stable_bounds.CopyFrom( m_bounds );
+    m_stable_hit_shapes.CopyFrom( m_hit_shapes );
+    
+    return m_frame_buffer ? m_frame_region : (u32)-1;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::FrameThreadMain()
+{
+    std::unique_lock<std::mutex> lock( m_frame_mutex );
+    
+    for(;;)
+    {
+        m_frame_cv.wait( lock, [this]{ return m_frame_requested || m_frame_thread_quit; } );
+        
+        // requested frame is finished before quitting.
+        if( !m_frame_requested )
+            return;
+        
+        lock.unlock();
+        EvaluateFrame();
+        lock.lock();
+        
+        m_frame_requested = false;
+        m_frame_cv.notify_all();
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::EvaluateFrame()
+{
+    ANIM_TRACE_SCOPE( "EvaluateFrame", 0, m_controllers.Count() );
+    
+    UpdateControllers( m_frame_delta_ms );
+    LocalPoseCalculation();
+    GlobalPoseCalculation();
+    
+    if( m_frame_buffer )
+        m_frame_region = MatrixPaletteGeneration( *m_frame_buffer );
+    else
+        MatrixPaletteGeneration();
+}
+
+//---------------------------------------------------------------------------------------
+
+AnimCommandBuffer* AnimationSystem::CreateCommandBuffer()
+{
+    AnimCommandBuffer* buffer = new AnimCommandBuffer( (u16)m_command_buffers.size() );
+    m_command_buffers.push_back( buffer );
+    
+    return buffer;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::ApplyCommands()
+{
+    m_commands.clear();
+    
+    for( size_t i = 0; i < m_command_buffers.size(); ++i )
+    {
+        std::vector<AnimCommand>& commands = m_command_buffers[i]->Flip();
+        m_commands.insert( m_commands.end(), commands.begin(), commands.end() );
+        commands.clear();
+    }
+    
+    if( m_commands.empty() )
+        return;
+    
+    ANIM_TRACE_SCOPE( "ApplyCommands", 0, (u32)m_commands.size() );
+    
+    // controller data is touched once, order does not depend on thread timing.
+    std::sort( m_commands.begin(), m_commands.end(), []( const AnimCommand& a, const AnimCommand& b )
+    {
+        if( a.controller != b.controller )
+            return a.controller < b.controller;
+        if( a.buffer != b.buffer )
+            return a.buffer < b.buffer;
+        
+        return a.sequence < b.sequence;
+    });
+    
+    for( size_t i = 0; i < m_commands.size(); ++i )
+    {
+        const AnimCommand& command = m_commands[i];
+        
+        // controller may have been destroyed after the command was queued.
+        if( !m_controllers.Exists( command.controller ) )
+            continue;
+        
+        AnimController& controller = m_controllers.Get( command.controller );
+        
+        if( command.layer >= controller.GetLayerCount() )
+        {
+            ENGINE_ASSERT(0, "command layer out of bounds");
+            continue;
+        }
+        
+        AnimLayer& layer = controller.GetLayer( command.layer );
+        
+        switch( command.type )
+        {
+            case AnimCommandType::SetStateData:
+                layer.SetStateData( command.state_data );
+                break;
+            case AnimCommandType::Play:
+                layer.Play( command.name, command.value );
+                break;
+            case AnimCommandType::Transition:
+                layer.Transition( command.name );
+                break;
+            case AnimCommandType::Stop:
+                layer.Stop();
+                break;
+            case AnimCommandType::Pause:
+                layer.Pause();
+                break;
+            case AnimCommandType::Resume:
+                layer.Resume();
+                break;
+            case AnimCommandType::SetNodeFactor:
+                layer.SetNodeFactor( command.name, command.value );
+                break;
+            case AnimCommandType::SetBlendFactor:
+                layer.SetBlendFactor( command.value );
+                break;
+            case AnimCommandType::SetLayerType:
+                layer.SetType( (LayerType::Enum)command.layer_type );
+                break;
+            case AnimCommandType::PlayClip:
+                layer.PlayClip( command.clip, command.time_ms, command.value, command.looped );
+                break;
+            default:
+                ENGINE_ASSERT(0, "unsupported command");
+                break;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::LocalPoseCalculation()
+{
+    AssignBakedPalettes();
+    
+    RunControllerBatches( AnimStage::LocalPose, [&]( u32 begin, u32 end, u32 /*worker*/ )
+    {
+        for( u32 k = begin; k < end; ++k )
+        {
+            u32 i = m_active_order[k];
+            
+            if( m_controllers[i].IsBaked() )
+            {
+                ANIM_STAT_ADD(baked_controllers, 1);
+                continue;
+            }
+            
+            // weights are propagated once per frame, pruned subtrees are then skipped for every joint.
+            m_controllers[i].UpdateWeights( m_prune_epsilon );
+            CalculateLocalPose( m_controllers[i] );
+        }
+    });
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::CalculateLocalPose( AnimController& controller )
+{
+    Skeleton* skeleton = controller.GetSkeleton();
+    
+#if ANIM_STATS
+    for( u32 l = 0; l < controller.GetLayerCount(); ++l )
+    {
+        AnimLayer& layer = controller.GetLayer(l);
+        
+        if( layer.Active() )
+        {
+            ANIM_STAT_ADD(trees_evaluated, layer.IsCrossfading() ? 2 : 1);
+            ANIM_STAT_ADD(trees_crossfading, layer.IsCrossfading() ? 1 : 0);
+        }
+    }
+#endif
+    
+    for( u16 j = 0; j < skeleton->GetJointCount(); ++j )
+        CalculateLocalTransformation( controller, j );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::CalculateLocalTransformation( AnimController& controller, u16 joint_idx )
+{
+    AnimationClip::JointPose local_pose;
+    controller.GetJointPose( joint_idx, local_pose );
+    
+    AnimTransformation& node = controller.GetHierarchy()->GetNode(joint_idx);
+    
+    node.SetTranslation( local_pose.translation );
+    node.SetScale( local_pose.scale );
+    node.SetRotation( local_pose.rotation );
+    
+    node.CalculateLocalTransformation();
+}
+
+//---------------------------------------------------------------------------------------
+
+const AnimJointQuery* AnimationSystem::GetJointQuery( const Skeleton* skeleton, const u16* joints, u32 joint_count )
+{
+    for( size_t i = 0; i < m_joint_queries.size(); ++i )
+    {
+        if( m_joint_queries[i]->Matches( skeleton, joints, joint_count ) )
+            return m_joint_queries[i];
+    }
+    
+    AnimJointQuery* query = new AnimJointQuery( skeleton, joints, joint_count );
+    m_joint_queries.push_back( query );
+    
+    return query;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::CalculateQueryJoints( AnimController& controller, const AnimJointQuery& query, Matrix4x4* transforms, const Matrix4x4* world )
+{
+    ENGINE_ASSERT(controller.GetSkeleton() == query.GetSkeleton(), "query created for different skeleton");
+    
+    AnimHierarchy* hierarchy = controller.GetHierarchy();
+    
+    // plan is sorted, so parents are always evaluated before children.
+    for( u32 i = 0; i < query.GetPlanCount(); ++i )
+    {
+        u16 j = query.GetPlanJoint(i);
+        
+        CalculateLocalTransformation( controller, j );
+        
+        AnimTransformation& node = hierarchy->GetNode(j);
+        
+        if( node.GetParentIndex() != AnimTransformation::InvalidIndex )
+            node.CalculateGlobalTransformation( hierarchy->GetNode( node.GetParentIndex() ) );
+        else
+            node.CalculateGlobalTransformation();
+    }
+    
+    for( u32 i = 0; i < query.GetJointCount(); ++i )
+    {
+        const Matrix4x4& model = hierarchy->GetNode( query.GetJoint(i) ).GetWorldTransformation();
+        
+        if( world )
+        {
+            transforms[i] = *world;
+            transforms[i] *= model;
+        }
+        else
+        {
+            transforms[i] = model;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::QueryJoints( Handle h, const AnimJointQuery& query, Matrix4x4* transforms, const Matrix4x4* world )
+{
+    ENGINE_ASSERT(!m_frame_in_flight, "QueryJoints called during pipelined frame");
+    
+    AnimController& controller = m_controllers.Get(h);
+    
+    controller.UpdateWeights( m_prune_epsilon );
+    CalculateQueryJoints( controller, query, transforms, world );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::QueryJoints( const Handle* handles, u32 count, const AnimJointQuery& query, Matrix4x4* transforms, const Matrix4x4* worlds )
+{
+    ENGINE_ASSERT(!m_frame_in_flight, "QueryJoints called during pipelined frame");
+    
+    ANIM_TRACE_SCOPE( "QueryJoints", 0, count );
+    
+    u32 joint_count = query.GetJointCount();
+    
+    m_workers.ParallelFor( count, m_batch_size, [&]( u32 begin, u32 end, u32 /*worker*/ )
+    {
+        for( u32 i = begin; i < end; ++i )
+        {
+            AnimController& controller = m_controllers.Get( handles[i] );
+            
+            controller.UpdateWeights( m_prune_epsilon );
+            CalculateQueryJoints( controller, query, transforms + i * joint_count, worlds ? &worlds[i] : nullptr );
+        }
+    });
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::SearchMotion( const AnimMotionDatabase& database, const float* queries, u32 count, AnimMotionMatch* matches )
+{
+    ENGINE_ASSERT(!m_frame_in_flight, "SearchMotion called during pipelined frame");
+    
+    ANIM_TRACE_SCOPE( "SearchMotion", 0, count );
+    
+    u32 stride = database.GetStride();
+    
+    // single search is much more expensive than a controller update, so every query is a work item.
+    m_workers.ParallelFor( count, 1, [&]( u32 begin, u32 end, u32 /*worker*/ )
+    {
+        for( u32 i = begin; i < end; ++i )
+            database.Search( queries + (size_t)i * stride, matches[i] );
+    });
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::GlobalPoseCalculation()
+{
+    u32 count = m_controllers.Count();
+    
+    if( m_bounds_enabled )
+        m_bounds.SetCount( count );
+    else
+        m_bounds.Clear();
+    
+    // hit shape slots of every controller, so workers write to disjoint ranges.
+    if( m_hit_shapes_enabled )
+    {
+        u32 capsule_count = 0;
+        u32 box_count = 0;
+        
+        for( u32 i = 0; i < count; ++i )
+        {
+            u32 capsules, boxes;
+            AnimHitShapes::CountShapes( *m_controllers[i].GetSkeleton(), capsules, boxes );
+            
+            m_first_capsule[i] = capsule_count;
+            m_first_box[i] = box_count;
+            
+            capsule_count += capsules;
+            box_count += boxes;
+        }
+        
+        m_hit_shapes.SetCount( capsule_count, box_count );
+    }
+    else
+    {
+        m_hit_shapes.Clear();
+    }
+    
+    if( !m_instance_batching )
+    {
+        RunControllerBatches( AnimStage::GlobalPose, [&]( u32 begin, u32 end, u32 /*worker*/ )
+        {
+            for( u32 k = begin; k < end; ++k )
+                CalculateGlobalPose( m_active_order[k], true );
+        });
+        
+        return;
+    }
+    
+    BuildInstanceGroups();
+    
+    u32 group_count = (u32)m_instance_groups.size() - 1;
+    u32 batch_size = std::max( m_batch_size / AnimInstanceBatch::Lanes, 1u );
+    
+    RunBatches( AnimStage::GlobalPose, group_count, batch_size, [&]( u32 begin, u32 end, u32 worker )
+    {
+        for( u32 g = begin; g < end; ++g )
+        {
+            u32 first = m_instance_groups[g];
+            u32 lane_count = m_instance_groups[g + 1] - first;
+            
+            if( lane_count > 1 )
+            {
+                AnimHierarchy* hierarchies[AnimInstanceBatch::Lanes];
+                
+                for( u32 l = 0; l < lane_count; ++l )
+                    hierarchies[l] = m_controllers[m_active_order[first + l]].GetHierarchy();
+                
+                m_instance_batches[worker].CalculateGlobalPose( hierarchies, lane_count );
+                ANIM_STAT_ADD(batched_controllers, lane_count);
+            }
+            
+            for( u32 l = 0; l < lane_count; ++l )
+                CalculateGlobalPose( m_active_order[first + l], lane_count == 1 );
+        }
+    });
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::CalculateGlobalPose( u32 idx, bool calculate_hierarchy )
+{
+    AnimController& controller = m_controllers[idx];
+    AnimHierarchy* hierarchy = controller.GetHierarchy();
+    
+    // baked bounds cover both blended frames.
+    if( controller.IsBaked() )
+    {
+        if( m_bounds_enabled )
+        {
+            u32 lower, upper;
+            float factor;
+            AnimPaletteCache::GetFrames( *controller.m_baked, controller.m_baked_time, lower, upper, factor );
+            
+            m_bounds.SetUnion( idx, controller.GetHandle(), *controller.m_baked->bounds, lower, m_baked_interpolate ? upper : lower, m_bounds_padding );
+        }
+        
+        return;
+    }
+    
+    if( calculate_hierarchy )
+        hierarchy->CalculateGlobalTransformation();
+    
+    // joint matrices are still in cache.
+    if( m_bounds_enabled )
+        m_bounds.Calculate( idx, controller.GetHandle(), *hierarchy, m_bounds_padding );
+    
+    if( m_hit_shapes_enabled )
+        m_hit_shapes.Calculate( m_first_capsule[idx], m_first_box[idx], controller.GetHandle(), *controller.GetSkeleton(), *hierarchy );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::UpdateEvaluationOrder()
+{
+    // bounds and hit shapes of sleeping controllers are kept at controller index, which changes with destruction.
+    if( m_evaluation_order_dirty || m_evaluation_order.size() != m_controllers.Count() )
+    {
+        WakeAll();
+        SortEvaluationOrder();
+    }
+    
+    if( m_active_order_dirty )
+    {
+        m_active_order.clear();
+        
+        for( size_t k = 0; k < m_evaluation_order.size(); ++k )
+        {
+            if( !m_controllers[m_evaluation_order[k]].IsSleeping() )
+                m_active_order.push_back( m_evaluation_order[k] );
+        }
+        
+        m_active_order_dirty = false;
+        m_instance_groups_dirty = true;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::WakeAll()
+{
+    for( u32 i = 0; i < m_controllers.Count(); ++i )
+    {
+        if( m_controllers[i].IsSleeping() )
+            m_controllers[i].Wake();
+    }
+    
+    m_active_order_dirty = true;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::SortEvaluationOrder()
+{
+    struct SortKey
+    {
+        const Skeleton* skeleton;
+        const AnimStates* states;
+        const AnimationClip* clip;
+        u32 idx;
+        
+        bool operator<( const SortKey& rhs ) const
+        {
+            if( skeleton != rhs.skeleton )
+                return skeleton < rhs.skeleton;
+            if( states != rhs.states )
+                return states < rhs.states;
+            if( clip != rhs.clip )
+                return clip < rhs.clip;
+            
+            return idx < rhs.idx;
+        }
+    };
+    
+    u32 count = m_controllers.Count();
+    std::vector<SortKey> keys( count );
+    
+    for( u32 i = 0; i < count; ++i )
+    {
+        AnimController& controller = m_controllers[i];
+        bool has_layer = controller.GetLayerCount() > 0;
+        
+        keys[i].skeleton = controller.GetSkeleton();
+        keys[i].states = has_layer ? controller.GetLayer(0).GetStateData() : nullptr;
+        keys[i].clip = has_layer ? controller.GetLayer(0).GetFirstClip() : nullptr;
+        keys[i].idx = i;
+    }
+    
+    std::sort( keys.begin(), keys.end() );
+    
+    m_evaluation_order.resize( count );
+    
+    for( u32 i = 0; i < count; ++i )
+        m_evaluation_order[i] = keys[i].idx;
+    
+    m_evaluation_order_dirty = false;
+    m_active_order_dirty = true;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::SetSleepingEnabled( bool enabled )
+{
+    m_sleeping_enabled = enabled;
+    
+    if( !enabled )
+        WakeAll();
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::Compact()
+{
+    ENGINE_ASSERT(!m_frame_in_flight, "Compact called during pipelined frame");
+    
+    ANIM_TRACE_SCOPE( "Compact", 0, m_controllers.Count() );
+    
+    // sorting clears the dirty flag, so sleeping controllers are woken here as UpdateEvaluationOrder would
+    // (their bounds and hit shapes are kept at controller index, which changes with destruction).
+    if( m_evaluation_order_dirty || m_evaluation_order.size() != m_controllers.Count() )
+        WakeAll();
+    
+    SortEvaluationOrder();
+    m_frames_since_compaction = 0;
+    
+    u32 node_count = 0;
+    
+    for( u32 i = 0; i < m_controllers.Count(); ++i )
+        node_count += m_controllers[i].GetHierarchy()->GetNodeCount();
+    
+    AnimTransformation* nodes = node_count > 0 ? new AnimTransformation[node_count] : nullptr;
+    Matrix4x4* palettes = node_count > 0 ? new Matrix4x4[node_count] : nullptr;
+    
+    // data of the previous compaction is copied out before its arena is released.
+    u32 offset = 0;
+    
+    for( u32 k = 0; k < m_evaluation_order.size(); ++k )
+    {
+        AnimController& controller = m_controllers[m_evaluation_order[k]];
+        controller.Relocate( nodes + offset, palettes + offset );
+        
+        offset += controller.GetHierarchy()->GetNodeCount();
+    }
+    
+    delete [] m_node_arena;
+    delete [] m_palette_arena;
+    
+    m_node_arena = nodes;
+    m_palette_arena = palettes;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::BuildInstanceGroups()
+{
+    UpdateEvaluationOrder();
+    
+    if( !m_instance_groups_dirty )
+        return;
+    
+    u32 count = (u32)m_active_order.size();
+    m_instance_groups.clear();
+    
+    for( u32 k = 0; k < count; )
+    {
+        AnimController& controller = m_controllers[m_active_order[k]];
+        u32 lane_count = 1;
+        
+        // baked controllers don't evaluate hierarchy.
+        if( !controller.IsBaked() )
+        {
+            while( lane_count < AnimInstanceBatch::Lanes && k + lane_count < count )
+            {
+                AnimController& next = m_controllers[m_active_order[k + lane_count]];
+                
+                if( next.GetSkeleton() != controller.GetSkeleton() || next.IsBaked() )
+                    break;
+                
+                lane_count++;
+            }
+        }
+        
+        m_instance_groups.push_back( k );
+        k += lane_count;
+    }
+    
+    m_instance_groups.push_back( count );
+    m_instance_groups_dirty = false;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::MatrixPaletteGeneration()
+{
+    GeneratePalettes( true );
+}
+
+//---------------------------------------------------------------------------------------
+
+u32 AnimationSystem::MatrixPaletteGeneration( AnimPaletteBuffer& buffer )
+{
+    u32 frame = buffer.NextFrame();
+    
+    UpdateEvaluationOrder();
+    
+    // palette placement is sequential, generation can run in parallel. sleeping controllers keep their own palette.
+    for( u32 k = 0; k < m_active_order.size(); ++k )
+    {
+        AnimController& controller = m_controllers[m_active_order[k]];
+        u32 joint_count = controller.GetHierarchy()->GetNodeCount();
+        
+        u32 offset = 0;
+        Matrix4x4* palette = buffer.Allocate( controller.GetHandle(), joint_count, offset );
+        
+        // buffer too small - fall back to controller's own palette (reported by buffer overflow count).
+        if( !palette )
+        {
+            palette = controller.GetOwnPalette( m_pipelined );
+            offset = (u32)-1;
+        }
+        
+        controller.SetTargetPalette( palette, offset, !m_pipelined );
+    }
+    
+    GeneratePalettes( false );
+    
+    return frame;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::GeneratePalettes( bool own_palette )
+{
+    if( !m_instance_batching )
+    {
+        RunControllerBatches( AnimStage::Palette, [&]( u32 begin, u32 end, u32 /*worker*/ )
+        {
+            for( u32 k = begin; k < end; ++k )
+            {
+                AnimController& controller = m_controllers[m_active_order[k]];
+                
+                if( own_palette )
+                    controller.SetTargetPalette( controller.GetOwnPalette( m_pipelined ), (u32)-1, !m_pipelined );
+                
+                WriteMatrixPalette( controller, controller.GetTargetPalette(), m_baked_interpolate );
+            }
+        });
+        
+        return;
+    }
+    
+    BuildInstanceGroups();
+    
+    u32 group_count = (u32)m_instance_groups.size() - 1;
+    u32 batch_size = std::max( m_batch_size / AnimInstanceBatch::Lanes, 1u );
+    
+    RunBatches( AnimStage::Palette, group_count, batch_size, [&]( u32 begin, u32 end, u32 worker )
+    {
+        for( u32 g = begin; g < end; ++g )
+        {
+            u32 first = m_instance_groups[g];
+            u32 lane_count = m_instance_groups[g + 1] - first;
+            
+            const AnimHierarchy* hierarchies[AnimInstanceBatch::Lanes];
+            Matrix4x4* palettes[AnimInstanceBatch::Lanes];
+            
+            for( u32 l = 0; l < lane_count; ++l )
+            {
+                AnimController& controller = m_controllers[m_active_order[first + l]];
+                
+                if( own_palette )
+                    controller.SetTargetPalette( controller.GetOwnPalette( m_pipelined ), (u32)-1, !m_pipelined );
+                
+                hierarchies[l] = controller.GetHierarchy();
+                palettes[l] = controller.GetTargetPalette();
+            }
+            
+            AnimController& controller = m_controllers[m_active_order[first]];
+            
+            if( lane_count > 1 )
+                m_instance_batches[worker].GenerateMatrixPalettes( hierarchies, lane_count, *controller.GetSkeleton(), palettes );
+            else
+                WriteMatrixPalette( controller, palettes[0], m_baked_interpolate );
+        }
+    });
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::RunControllerBatches( AnimStage::Enum stage, const AnimWorkerPool::RangeFunc& func )
+{
+    UpdateEvaluationOrder();
+    
+    RunBatches( stage, (u32)m_active_order.size(), m_batch_size, func );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::RunBatches( AnimStage::Enum stage, u32 count, u32 batch_size, const AnimWorkerPool::RangeFunc& func )
+{
+    ANIM_TRACE_SCOPE( s_stage_names[stage], 0, count );
+    
+#if ANIM_STATS
+    u64 stage_start = AnimStats::Now();
+#endif
+    
+#if ANIM_STATS || ANIM_TRACE
+    AnimWorkerPool::RangeFunc measured_func = [&]( u32 begin, u32 end, u32 worker )
+    {
+        ANIM_TRACE_SCOPE( s_batch_names[stage], worker, begin );
+        
+#if ANIM_STATS
+        u64 batch_start = AnimStats::Now();
+#endif
+        
+        func( begin, end, worker );
+        
+#if ANIM_STATS
+        // every worker writes only its own slot.
+        AnimStats::FlushThreadCounters( m_worker_counters[worker] );
+        m_worker_busy_ns[worker] += AnimStats::Now() - batch_start;
+#endif
+    };
+    
+    m_workers.ParallelFor( count, batch_size, measured_func );
+#else
+    m_workers.ParallelFor( count, batch_size, func );
+#endif
+    
+#if ANIM_STATS
+    m_frame_stats.stage_ms[stage] += (AnimStats::Now() - stage_start) * 1e-6f;
+#endif
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::SetWorkerCount( u32 worker_count )
+{
+    ENGINE_ASSERT(!m_frame_in_flight, "worker count changed during pipelined frame");
+    
+    if( worker_count > AnimStatMaxWorkers )
+        worker_count = AnimStatMaxWorkers;
+    
+    m_workers.Start( worker_count );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::GetFrameStats( AnimFrameStats& stats ) const
+{
+    stats.Reset();
+    
+#if ANIM_STATS
+    stats = m_frame_stats;
+    stats.worker_count = m_workers.GetWorkerCount();
+    
+    for( u32 i = 0; i < stats.worker_count; ++i )
+    {
+        stats.counters.Add( m_worker_counters[i] );
+        stats.worker_busy_ms[i] = m_worker_busy_ns[i] * 1e-6f;
+    }
+#endif
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::GenerateMatrixPalette( AnimController& controller, Matrix4x4* palette )
+{
+    GenerateMatrixPalette( *controller.GetHierarchy(), *controller.GetSkeleton(), palette );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::GenerateMatrixPalette( const AnimHierarchy& hierarchy, const Skeleton& skeleton, Matrix4x4* palette )
+{
+    // we need inverse matrix of root node's world transformation to calculate model-space palette.
+    Matrix4x4 parentInvMatrix = hierarchy.GetNode(0).GetWorldTransformation();
+    parentInvMatrix.InverseIt();
+    
+    for( u16 j = 0; j < hierarchy.GetNodeCount(); ++j )
+    {
+        // creating skinning palette.
+        // K = (Bj_M)^-1 * Cj_M
+        // palette matrix is inverse bind pose in model-space multiplied by current pose in model-space.
+        
+        // world-space matrix
+        palette[j] = hierarchy.GetNode(j).GetWorldTransformation();
+        
+        // world-space -> model-space
+        palette[j] = parentInvMatrix * palette[j];
+        
+        // skinning palette matrix ( model-space * inverse bind pose )
+        palette[j] *= skeleton.GetInvBindPose(j);
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::WriteMatrixPalette( AnimController& controller, Matrix4x4* palette, bool interpolate )
+{
+    if( controller.IsBaked() )
+        AnimPaletteCache::Sample( *controller.m_baked, controller.m_baked_time, interpolate, palette );
+    else
+        GenerateMatrixPalette( controller, palette );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::EnableBakedPalettes( float frames_per_second, bool interpolate )
+{
+    ENGINE_ASSERT(!m_frame_in_flight, "baking changed during pipelined frame");
+    
+    // baked frames depend on the frame rate.
+    if( frames_per_second != m_palette_cache.GetFrameRate() || frames_per_second <= 0.f )
+        ClearBakedPalettes();
+    
+    m_baking_enabled = frames_per_second > 0.f;
+    m_baked_interpolate = interpolate;
+    
+    if( m_baking_enabled )
+        m_palette_cache.SetFrameRate( frames_per_second );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::ClearBakedPalettes()
+{
+    ENGINE_ASSERT(!m_frame_in_flight, "baked palettes cleared during pipelined frame");
+    
+    // bounds of sleeping controllers may refer to baked frames.
+    WakeAll();
+    
+    for( u32 i = 0; i < m_controllers.Count(); ++i )
+        m_controllers[i].m_baked = nullptr;
+    
+    m_palette_cache.Clear();
+    m_instance_groups_dirty = true;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::AssignBakedPalettes()
+{
+    // hit shapes need joint matrices.
+    bool baking = m_baking_enabled && !m_hit_shapes_enabled;
+    
+    UpdateEvaluationOrder();
+    
+    for( u32 k = 0; k < m_active_order.size(); ++k )
+    {
+        AnimController& controller = m_controllers[m_active_order[k]];
+        bool was_baked = controller.IsBaked();
+        controller.m_baked = nullptr;
+        
+        const AnimationClip* clip = nullptr;
+        
+        if( !baking || !controller.GetBakeableClip( clip, controller.m_baked_time ) || !clip )
+        {
+            // baked controllers form their own instance groups.
+            if( was_baked )
+                m_instance_groups_dirty = true;
+            
+            continue;
+        }
+        
+        Skeleton* skeleton = controller.GetSkeleton();
+        const AnimPaletteCache::Entry* entry = m_palette_cache.Find( skeleton, clip );
+        
+        if( !entry )
+        {
+            AnimPaletteCache::Entry* baked = m_palette_cache.Add( skeleton, clip, controller.GetHierarchy()->GetNodeCount() );
+            BakePalettes( *baked, skeleton );
+            entry = baked;
+        }
+        
+        controller.m_baked = entry;
+        
+        if( !was_baked )
+            m_instance_groups_dirty = true;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::BakePalettes( AnimPaletteCache::Entry& entry, Skeleton* skeleton )
+{
+    ANIM_TRACE_SCOPE( "BakePalettes", 0, entry.frame_count );
+    
+    AnimHierarchy* hierarchy = AnimHierarchy::CreateFromSkeleton( skeleton );
+    
+    for( u32 f = 0; f < entry.frame_count; ++f )
+    {
+        float time_ms = entry.frames_per_ms > 0.f ? f / entry.frames_per_ms : 0.f;
+        
+        for( u16 j = 0; j < hierarchy->GetNodeCount(); ++j )
+        {
+            AnimationClip::JointPose pose;
+            
+            // joints missing in the clip keep identity.
+            if( j < entry.clip->m_skeleton_joint_count && entry.clip->HasJointPose(j) )
+            {
+                entry.clip->GetJointPose( time_ms, j, pose, true );
+            }
+            else
+            {
+                pose.translation = Vec3( 0.f, 0.f, 0.f );
+                pose.rotation = Quaternion( 0.f, 0.f, 0.f, 1.f );
+                pose.scale = 1.f;
+            }
+            
+            AnimTransformation& node = hierarchy->GetNode(j);
+            node.SetTranslation( pose.translation );
+            node.SetScale( pose.scale );
+            node.SetRotation( pose.rotation );
+            node.CalculateLocalTransformation();
+        }
+        
+        hierarchy->CalculateGlobalTransformation();
+        
+        GenerateMatrixPalette( *hierarchy, *skeleton, entry.palettes + (size_t)f * entry.joint_count );
+        entry.bounds->Calculate( f, (Handle)-1, *hierarchy, 0.f );
+    }
+    
+    delete hierarchy;
+}
+    
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::StartRecording( AnimRecorder* recorder )
+{
+    StopRecording();
+    
+    m_recorder = recorder;
+    
+    AnimRecordSettings settings;
+    settings.worker_count = m_workers.GetWorkerCount();
+    settings.batch_size = m_batch_size;
+    settings.prune_epsilon = m_prune_epsilon;
+    settings.baked_frames_per_second = m_baking_enabled ? m_palette_cache.GetFrameRate() : 0.f;
+    settings.baked_interpolate = m_baked_interpolate ? 1 : 0;
+    settings.sleeping_enabled = m_sleeping_enabled ? 1 : 0;
+    settings.instance_batching = m_instance_batching ? 1 : 0;
+    settings.compaction_interval = m_compaction_interval;
+    settings.bounds_enabled = m_bounds_enabled ? 1 : 0;
+    settings.hit_shapes_enabled = m_hit_shapes_enabled ? 1 : 0;
+    settings.bounds_padding = m_bounds_padding;
+    
+    m_recorder->RecordSettings( settings );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::StopRecording()
+{
+    if( !m_recorder )
+        return;
+    
+    for( u32 i = 0; i < m_controllers.Count(); ++i )
+        m_controllers[i].SetRecorder( nullptr );
+    
+    m_recorder = nullptr;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::EnableBounds( bool bounds, bool hit_shapes, float padding )
+{
+    ENGINE_ASSERT(!m_frame_in_flight, "bounds changed during pipelined frame");
+    
+    m_bounds_enabled = bounds;
+    m_hit_shapes_enabled = hit_shapes;
+    m_bounds_padding = padding;
+    
+    m_bounds.Clear();
+    m_hit_shapes.Clear();
+    m_stable_bounds.Clear();
+    m_stable_hit_shapes.Clear();
+    
+    // sleeping controllers have no bounds or hit shapes yet.
+    WakeAll();
+}
+    
+//---------------------------------------------------------------------------------------
+    
+void AnimationSystem::Draw( DebugRenderer& rend )
+{
+    ENGINE_ASSERT(!m_frame_in_flight, "Draw called during pipelined frame");
+    
+    for( u32 i = 0; i < m_controllers.Count(); ++i )
+    {
+        AnimController& controller = m_controllers[i];
+        AnimHierarchy* hierarchy = controller.GetHierarchy();
+        
+        hierarchy->Draw( rend );
+    }
+}
+    
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::CalculateMemory( AnimMemoryReport& report )
+{
+    for( u32 c = 0; c < AnimMemoryCategory::Count; ++c )
+        report.category_bytes[c] = 0;
+    
+    report.assets.clear();
+    report.controllers.resize( m_controllers.Count() );
+    
+    std::vector<const AnimationClip*> clips;
+    
+    for( u32 i = 0; i < m_controllers.Count(); ++i )
+    {
+        AnimController& controller = m_controllers[i];
+        
+        controller.GetMemoryUsage( report.controllers[i] );
+        report.category_bytes[AnimMemoryCategory::Controllers] += report.controllers[i].total;
+        
+        // shared assets are reported once.
+        const Skeleton* skeleton = controller.GetSkeleton();
+        
+        AnimAssetMemory asset;
+        asset.category = AnimMemoryCategory::Skeletons;
+        asset.asset = skeleton;
+        asset.name = skeleton->GetName();
+        asset.bytes = skeleton->GetMemoryUsage();
+        
+        if( std::find_if( report.assets.begin(), report.assets.end(), [&]( const AnimAssetMemory& a ){ return a.asset == skeleton; } ) == report.assets.end() )
+            report.assets.push_back( asset );
+        
+        for( u32 l = 0; l < controller.GetLayerCount(); ++l )
+        {
+            const AnimStates* states = controller.GetLayer(l).GetStateData();
+            
+            if( !states || std::find_if( report.assets.begin(), report.assets.end(), [&]( const AnimAssetMemory& a ){ return a.asset == states; } ) != report.assets.end() )
+                continue;
+            
+            asset.category = AnimMemoryCategory::States;
+            asset.asset = states;
+            asset.name = 0;
+            asset.bytes = states->GetMemoryUsage();
+            report.assets.push_back( asset );
+            
+            states->CollectClips( clips );
+        }
+    }
+    
+    // clips may be shared by several state data.
+    std::sort( clips.begin(), clips.end() );
+    clips.erase( std::unique( clips.begin(), clips.end() ), clips.end() );
+    
+    for( size_t i = 0; i < clips.size(); ++i )
+    {
+        AnimAssetMemory asset;
+        asset.category = AnimMemoryCategory::Clips;
+        asset.asset = clips[i];
+        asset.name = clips[i]->GetName();
+        asset.bytes = clips[i]->GetMemoryUsage();
+        report.assets.push_back( asset );
+    }
+    
+    for( size_t i = 0; i < report.assets.size(); ++i )
+        report.category_bytes[report.assets[i].category] += report.assets[i].bytes;
+    
+    report.category_bytes[AnimMemoryCategory::BakedPalettes] = m_palette_cache.GetMemoryUsage();
+    
+    report.total = 0;
+    
+    for( u32 c = 0; c < AnimMemoryCategory::Count; ++c )
+        report.total += report.category_bytes[c];
+    
+    report.high_water = std::max( m_memory_high_water, report.total );
+    report.budget = m_memory_budget;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::SyncMemoryTotals()
+{
+    for( u32 i = 0; i < m_controllers.Count(); ++i )
+    {
+        AnimController& controller = m_controllers[i];
+        
+        for( u32 l = 0; l < controller.GetLayerCount(); ++l )
+        {
+            const AnimStates* states = controller.GetLayer(l).GetStateData();
+            
+            if( states == controller.m_budget_states[l] )
+                continue;
+            
+            AddStateRefs( states );
+            ReleaseStateRefs( controller.m_budget_states[l] );
+            controller.m_budget_states[l] = states;
+        }
+        
+        AnimControllerMemory memory;
+        controller.GetMemoryUsage( memory );
+        
+        m_instance_memory = m_instance_memory - controller.m_budget_bytes + memory.total;
+        controller.m_budget_bytes = memory.total;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+size_t AnimationSystem::GetMemoryTotal() const
+{
+    return m_instance_memory + m_asset_memory + m_palette_cache.GetMemoryUsage();
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::CheckMemoryBudget()
+{
+    size_t total = GetMemoryTotal();
+    bool over_budget = m_memory_budget > 0 && total > m_memory_budget;
+    
+    m_memory_high_water = std::max( m_memory_high_water, total );
+    
+    // reported once per crossing, not every frame the total stays over budget.
+    if( over_budget && !m_over_budget && m_memory_budget_callback )
+    {
+        AnimMemoryReport report;
+        CalculateMemory( report );
+        m_memory_budget_callback( report );
+    }
+    
+    m_over_budget = over_budget;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::AddAssetRef( const void* asset, size_t bytes )
+{
+    for( size_t i = 0; i < m_asset_refs.size(); ++i )
+    {
+        if( m_asset_refs[i].asset == asset )
+        {
+            ++m_asset_refs[i].refs;
+            return;
+        }
+    }
+    
+    AnimAssetRef ref;
+    ref.asset = asset;
+    ref.refs = 1;
+    ref.bytes = bytes;
+    m_asset_refs.push_back( ref );
+    
+    m_asset_memory += bytes;
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::ReleaseAssetRef( const void* asset )
+{
+    for( size_t i = 0; i < m_asset_refs.size(); ++i )
+    {
+        if( m_asset_refs[i].asset != asset )
+            continue;
+        
+        if( --m_asset_refs[i].refs == 0 )
+        {
+            m_asset_memory -= m_asset_refs[i].bytes;
+            m_asset_refs[i] = m_asset_refs.back();
+            m_asset_refs.pop_back();
+        }
+        
+        return;
+    }
+    
+    ENGINE_ASSERT(0, "asset is not referenced");
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::AddStateRefs( const AnimStates* states )
+{
+    if( !states )
+        return;
+    
+    AddAssetRef( states, states->GetMemoryUsage() );
+    
+    std::vector<const AnimationClip*> clips;
+    states->CollectClips( clips );
+    
+    for( size_t i = 0; i < clips.size(); ++i )
+        AddAssetRef( clips[i], clips[i]->GetMemoryUsage() );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::ReleaseStateRefs( const AnimStates* states )
+{
+    if( !states )
+        return;
+    
+    ReleaseAssetRef( states );
+    
+    std::vector<const AnimationClip*> clips;
+    states->CollectClips( clips );
+    
+    for( size_t i = 0; i < clips.size(); ++i )
+        ReleaseAssetRef( clips[i] );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::GetMemoryReport( AnimMemoryReport& report )
+{
+    CalculateMemory( report );
+    
+    m_memory_high_water = report.high_water;
+    
+    if( m_memory_budget > 0 && report.total > m_memory_budget && m_memory_budget_callback )
+        m_memory_budget_callback( report );
+}
+
+//---------------------------------------------------------------------------------------
+
+void AnimationSystem::SetMemoryBudget( size_t bytes, const AnimMemoryBudgetFunc& callback )
+{
+    m_memory_budget = bytes;
+    m_memory_budget_callback = callback;
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
+
@@ -1,46 +1,424 @@
-#pragma once
-
-#include "engine/core/Types.h"
-#include "engine/core/ObjectArray.h"
-#include "engine/animation/AnimController.h"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-
-class Skeleton;
-    
-class AnimationSystem
-{
-public:
-    AnimationSystem( u32 max_controller_count );
-    
-    Handle CreateController( Skeleton* skeleton, u32 layer_count );
-    void DestroyController( Handle h );
-    bool HasController( Handle h );
-    
-    AnimController& GetController( Handle h );
-    
-public:
-    // updates animation controllers timer.
-    void Update( float delta_ms );
-    
-    // calculates skeleton local transformation matrices.
-    void LocalPoseCalculation();
-    
-    // calculates skeleton global transformation matrices.
-    void GlobalPoseCalculation();
-    
-    // creates matrix palettes for all animation controllers.
-    void MatrixPaletteGeneration();
-    
-    // renders animated skeletal poses.
-    void Draw( DebugRenderer& rend );
-    
-private:
-    ObjectArray<AnimController> m_controllers;
-};
-
-//---------------------------------------------------------------------------------------
-}
-//---------------------------------------------------------------------------------------
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/core/ObjectArray.h"
+#include "engine/animation/AnimController.h"
+#include "engine/animation/AnimBounds.h"
+#include "engine/animation/AnimStats.h"
+#include "engine/animation/AnimWorkerPool.h"
+#include "engine/animation/AnimMemory.h"
+#include "engine/animation/AnimPaletteCache.h"
+#include "engine/animation/AnimInstanceBatch.h"
+#include "engine/animation/AnimCommandBuffer.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class Skeleton;
+class AnimPaletteBuffer;
+class AnimRecorder;
+class AnimJointQuery;
+class AnimMotionDatabase;
+struct AnimMotionMatch;
+    
+class AnimationSystem
+{
+public:
+    AnimationSystem( u32 max_controller_count );
+    ~AnimationSystem();
+    
+    Handle CreateController( Skeleton* skeleton, u32 layer_count );
+    void DestroyController( Handle h );
+    bool HasController( Handle h );
+    
+    AnimController& GetController( Handle h );
+    
+    // creates buffer for a thread queueing layer calls (owned by the system). buffers have to be created before
+    // threads use them. queued commands are applied at the start of Update sorted by controller, commands of
+    // a controller in buffer creation order and then in queue order.
+    AnimCommandBuffer* CreateCommandBuffer();
+    
+public:
+    // applies queued commands and updates animation controllers timer.
+    void Update( float delta_ms );
+    
+    // calculates skeleton local transformation matrices.
+    void LocalPoseCalculation();
+    
+    // calculates skeleton global transformation matrices.
+    // bounds and hit shapes are generated as part of this pass if enabled.
+    void GlobalPoseCalculation();
+    
+    // creates matrix palettes for all animation controllers.
+    void MatrixPaletteGeneration();
+    
+    // creates matrix palettes directly in the next frame region of caller-owned buffer.
+    // returns index of the written frame region (offset table is available in the buffer). controllers whose
+    // palette did not fit use their own palette (offset -1), buffer GetOverflowCount of the region is non-zero then.
+    u32 MatrixPaletteGeneration( AnimPaletteBuffer& buffer );
+    
+    // renders animated skeletal poses.
+    void Draw( DebugRenderer& rend );
+    
+public:
+    // pipelined frame. applies queued commands and starts Update and all pose and palette passes on a frame thread
+    // driving the workers, then returns. skinning palettes, bounds and hit shapes published by the previous EndFrame
+    // stay valid until the next EndFrame, so they can be consumed while the frame is evaluated. while the frame is
+    // in flight layer calls have to be queued in command buffers, and controllers can't be created, destroyed,
+    // drawn or queried.
+    void BeginFrame( float delta_ms );
+    
+    // pipelined frame writing palettes into the next frame region of caller-owned buffer (needs at least
+    // 2 frame regions).
+    void BeginFrame( float delta_ms, AnimPaletteBuffer& buffer );
+    
+    // waits for the frame started by BeginFrame and publishes its palettes, bounds and hit shapes.
+    // returns palette buffer frame region the palettes were written to ((u32)-1 if no buffer was used).
+    u32 EndFrame();
+    
+    inline bool IsFrameInFlight() const { return m_frame_in_flight; }
+    
+public:
+    // enables per-controller bounds and per-joint hit shapes generation. padding enlarges bounds around joints.
+    void EnableBounds( bool bounds, bool hit_shapes, float padding );
+    
+    // per-controller bounds from the last global pose pass (last finished frame if pipelined).
+    inline const AnimBounds& GetBounds() const { return m_pipelined ? m_stable_bounds : m_bounds; }
+    
+    // world-space hit shapes from the last global pose pass (last finished frame if pipelined).
+    inline const AnimHitShapes& GetHitShapes() const { return m_pipelined ? m_stable_hit_shapes : m_hit_shapes; }
+    
+public:
+    // controllers playing a single looped clip (see AnimController::SetBakingAllowed) use palettes baked
+    // at frames_per_second on first use, skipping local pose and hierarchy evaluation. palettes are blended
+    // between baked frames if interpolate is set. 0 frame rate disables baking and clears the cache.
+    // hierarchy of baked controllers is not updated and baking is not used while hit shapes are enabled.
+    void EnableBakedPalettes( float frames_per_second, bool interpolate );
+    
+    // releases baked palettes. has to be called before clips or skeletons used by the cache are unloaded.
+    void ClearBakedPalettes();
+    
+    inline const AnimPaletteCache& GetPaletteCache() const { return m_palette_cache; }
+    
+public:
+    // returns cached evaluation plan for a joint set (created on first request, owned by the system).
+    const AnimJointQuery* GetJointQuery( const Skeleton* skeleton, const u16* joints, u32 joint_count );
+    
+    // samples only query joints and their ancestors and writes model-space transforms of query joints
+    // (world-space if world is not null). does not need local/global pose passes, intended for headless servers.
+    void QueryJoints( Handle h, const AnimJointQuery& query, Matrix4x4* transforms, const Matrix4x4* world = nullptr );
+    
+    // QueryJoints for many controllers spread across workers. transforms has count * query joint count
+    // matrices, worlds (optional) has count matrices.
+    void QueryJoints( const Handle* handles, u32 count, const AnimJointQuery& query, Matrix4x4* transforms, const Matrix4x4* worlds = nullptr );
+    
+    // searches motion database for many characters spread across workers. queries has count * database
+    // stride floats, matches has count entries.
+    void SearchMotion( const AnimMotionDatabase& database, const float* queries, u32 count, AnimMotionMatch* matches );
+    
+public:
+    // runs frame stages on worker_count threads (including calling thread). 1 by default.
+    void SetWorkerCount( u32 worker_count );
+    
+    // number of controllers in a single work item.
+    inline void SetBatchSize( u32 batch_size ) { m_batch_size = batch_size > 0 ? batch_size : 1; }
+    
+    // blend tree subtrees and layers with effective weight <= epsilon are not evaluated. 0 by default
+    // (only exact endpoint weights are pruned).
+    inline void SetPruneEpsilon( float epsilon ) { m_prune_epsilon = epsilon; }
+    
+    // global pose and palette passes evaluate controllers sharing a skeleton in lockstep, AnimInstanceBatch::Lanes
+    // controllers at a time (controllers are grouped by skeleton automatically). disabled by default.
+    inline void SetInstanceBatching( bool enabled ) { m_instance_batching = enabled; }
+    
+    // controllers are evaluated sorted by skeleton, state data and first clip of layer 0, so similar controllers
+    // run back to back. every interval_frames updates (0 disables it, default) the order is sorted again and
+    // controller hierarchies and palettes are moved to contiguous memory in evaluation order. handles are not affected.
+    inline void SetCompactionInterval( u32 interval_frames ) { m_compaction_interval = interval_frames; }
+    
+    // sorts evaluation order and relocates controller data immediately.
+    void Compact();
+    
+    // controllers whose pose stopped changing (all layers inactive, paused or clamped at the end of non looped
+    // clips) fall asleep after one more evaluation. they are skipped by all frame stages and keep their last
+    // palette (own palette, offset -1 in palette buffer) until any layer call wakes them. enabled by default.
+    void SetSleepingEnabled( bool enabled );
+    
+    // statistics of current frame (frame starts with Update or BeginFrame, pipelined frames have to be finished
+    // with EndFrame). zeroed if compiled without ANIM_STATS.
+    void GetFrameStats( AnimFrameStats& stats ) const;
+    
+public:
+    // memory of live controllers and of clips, skeletons and state data they reference (shared assets
+    // are counted once). updates high-water mark and calls budget callback if total exceeds the budget.
+    void GetMemoryReport( AnimMemoryReport& report );
+    
+    // hard memory budget in bytes (0 disables it). CreateController fails (after calling the callback)
+    // if the new controller would exceed the budget. growth of live controllers (state data, blend trees,
+    // baked palettes) cannot be refused, it is checked at the beginning of every update and the callback is
+    // called once per crossing of the budget. checks use running totals of controller and asset memory,
+    // a full report is calculated only for the callback.
+    void SetMemoryBudget( size_t bytes, const AnimMemoryBudgetFunc& callback );
+    
+    // highest total of memory reports and budget checks of accepted controllers.
+    inline size_t GetMemoryHighWater() const { return m_memory_high_water; }
+    
+public:
+    // records controller creation, layer calls and updates until StopRecording is called. current system
+    // settings are stored in the log header. controllers existing before the call and settings changed while
+    // recording are not part of the log.
+    void StartRecording( AnimRecorder* recorder );
+    
+    void StopRecording();
+    
+private:
+    // applies commands of all command buffers.
+    void ApplyCommands();
+    
+    // serial part of Update (commands, recording, compaction, waking).
+    void BeginUpdate( float delta_ms );
+    
+    // updates active controllers on workers.
+    void UpdateControllers( float delta_ms );
+    
+    // starts pipelined frame evaluation (buffer is optional).
+    void StartFrame( float delta_ms, AnimPaletteBuffer* buffer );
+    
+    // evaluates pipelined frames requested by StartFrame.
+    void FrameThreadMain();
+    
+    // all frame stages of a pipelined frame.
+    void EvaluateFrame();
+    
+    // runs func over all controllers in batches, measuring stage time if stats are enabled.
+    void RunControllerBatches( AnimStage::Enum stage, const AnimWorkerPool::RangeFunc& func );
+    
+    // runs func over [0, count) in batch_size ranges, measuring stage time if stats are enabled.
+    void RunBatches( AnimStage::Enum stage, u32 count, u32 batch_size, const AnimWorkerPool::RangeFunc& func );
+    
+    // sorts evaluation order if controllers were created or destroyed and rebuilds active order.
+    void UpdateEvaluationOrder();
+    
+    // wakes all sleeping controllers.
+    void WakeAll();
+    
+    // sorts controllers by skeleton, state data and first clip of layer 0.
+    void SortEvaluationOrder();
+    
+    // splits evaluation order into instance groups of up to AnimInstanceBatch::Lanes controllers sharing a skeleton.
+    // baked controllers form single controller groups. groups are kept until m_instance_groups_dirty is set.
+    void BuildInstanceGroups();
+    
+    // global transformations, bounds and hit shapes of a single controller. hierarchy is not
+    // recalculated if calculate_hierarchy is false (already done by instance batch).
+    void CalculateGlobalPose( u32 idx, bool calculate_hierarchy );
+    
+    // writes palettes of all controllers. own_palette redirects output to controller's own palette first.
+    void GeneratePalettes( bool own_palette );
+    
+    // samples layers and calculates local transformations of controller hierarchy.
+    static void CalculateLocalPose( AnimController& controller );
+    
+    // samples layers and calculates local transformation of a single joint.
+    static void CalculateLocalTransformation( AnimController& controller, u16 joint_idx );
+    
+    // evaluates query plan joints of a single controller.
+    static void CalculateQueryJoints( AnimController& controller, const AnimJointQuery& query, Matrix4x4* transforms, const Matrix4x4* world );
+    
+    // K = (Bj_M)^-1 * Cj_M for all controller joints.
+    static void GenerateMatrixPalette( AnimController& controller, Matrix4x4* palette );
+    
+    static void GenerateMatrixPalette( const AnimHierarchy& hierarchy, const Skeleton& skeleton, Matrix4x4* palette );
+    
+    // selects cache entries of baked controllers, baking missing (skeleton, clip) pairs.
+    void AssignBakedPalettes();
+    
+    // samples entry clip at every baked frame and stores palettes and bounds.
+    static void BakePalettes( AnimPaletteCache::Entry& entry, Skeleton* skeleton );
+    
+    // writes controller palette, from cache if baked.
+    static void WriteMatrixPalette( AnimController& controller, Matrix4x4* palette, bool interpolate );
+    
+    // fills memory report without updating high-water mark.
+    void CalculateMemory( AnimMemoryReport& report );
+    
+    // updates running memory totals with changes of live controllers since the last call (layer state data,
+    // blend trees, events).
+    void SyncMemoryTotals();
+    
+    // running total of controllers, referenced assets and baked palettes.
+    size_t GetMemoryTotal() const;
+    
+    // updates high-water mark and calls budget callback if running total went over the budget.
+    void CheckMemoryBudget();
+    
+    // reference counting of shared assets in running totals. first reference adds asset bytes, last one removes them.
+    void AddAssetRef( const void* asset, size_t bytes );
+    void ReleaseAssetRef( const void* asset );
+    
+    // references of state data and clips its states play (null is ignored).
+    void AddStateRefs( const AnimStates* states );
+    void ReleaseStateRefs( const AnimStates* states );
+    
+private:
+    ObjectArray<AnimController> m_controllers;
+    
+    // per-controller bounds.
+    AnimBounds m_bounds;
+    
+    // per-joint hit shapes.
+    AnimHitShapes m_hit_shapes;
+    
+    // bounds and hit shapes of the last finished pipelined frame.
+    AnimBounds m_stable_bounds;
+    AnimHitShapes m_stable_hit_shapes;
+    
+    // bounds generation enabled.
+    bool m_bounds_enabled;
+    
+    // hit shapes generation enabled.
+    bool m_hit_shapes_enabled;
+    
+    // bounds padding around the joints.
+    float m_bounds_padding;
+    
+    // first capsule/box of every controller in m_hit_shapes (controller order).
+    u32* m_first_capsule;
+    u32* m_first_box;
+    
+    // threads running controller batches.
+    AnimWorkerPool m_workers;
+    
+    // number of controllers in a single work item.
+    u32 m_batch_size;
+    
+    // weight below which subtrees and layers are pruned.
+    float m_prune_epsilon;
+    
+    // records externally driven calls (null if not recording).
+    AnimRecorder* m_recorder;
+    
+    // cached joint query plans.
+    std::vector<AnimJointQuery*> m_joint_queries;
+    
+    // memory budget in bytes (0 if disabled).
+    size_t m_memory_budget;
+    
+    // called when memory budget is exceeded.
+    AnimMemoryBudgetFunc m_memory_budget_callback;
+    
+    // highest reported memory total.
+    size_t m_memory_high_water;
+    
+    // memory of live controllers, updated on creation, destruction and budget checks.
+    size_t m_instance_memory;
+    
+    // skeletons, state data and clips referenced by live controllers (shared assets are counted once).
+    size_t m_asset_memory;
+    
+    // reference counts of assets in m_asset_memory.
+    std::vector<AnimAssetRef> m_asset_refs;
+    
+    // running total was over budget at the last check.
+    bool m_over_budget;
+    
+    // palettes of looped clips.
+    AnimPaletteCache m_palette_cache;
+    
+    // baked palettes are used.
+    bool m_baking_enabled;
+    
+    // baked palettes are blended between frames.
+    bool m_baked_interpolate;
+    
+    // global pose and palette passes run in instance batches.
+    bool m_instance_batching;
+    
+    // controller indices in evaluation order (sorted by skeleton, state data and clip).
+    std::vector<u32> m_evaluation_order;
+    
+    // m_evaluation_order has to be rebuilt (controllers were created or destroyed).
+    bool m_evaluation_order_dirty;
+    
+    // m_evaluation_order without sleeping controllers. all frame stages iterate it.
+    std::vector<u32> m_active_order;
+    
+    // m_active_order has to be rebuilt (controllers fell asleep or woke up).
+    bool m_active_order_dirty;
+    
+    // controllers may fall asleep.
+    bool m_sleeping_enabled;
+    
+    // handles of sleeping controllers woken by layer calls since the last update.
+    AnimWakeList m_wake_list;
+    
+    // buffers of threads queueing layer calls.
+    std::vector<AnimCommandBuffer*> m_command_buffers;
+    
+    // commands of all buffers being applied.
+    std::vector<AnimCommand> m_commands;
+    
+    // updates between compactions (0 if disabled).
+    u32 m_compaction_interval;
+    
+    u32 m_frames_since_compaction;
+    
+    // hierarchy nodes and palettes of controllers relocated by the last compaction.
+    AnimTransformation* m_node_arena;
+    Matrix4x4* m_palette_arena;
+    
+    // first m_active_order entry of every instance group followed by controller count.
+    std::vector<u32> m_instance_groups;
+    
+    // instance groups have to be rebuilt (active order or baked state of a controller changed).
+    bool m_instance_groups_dirty;
+    
+    // scratch memory of every worker.
+    AnimInstanceBatch m_instance_batches[AnimStatMaxWorkers];
+    
+    // frames are evaluated by BeginFrame/EndFrame. palettes, bounds and hit shapes are published by EndFrame.
+    bool m_pipelined;
+    
+    // BeginFrame was called without matching EndFrame.
+    bool m_frame_in_flight;
+    
+    // evaluates pipelined frames (started on first BeginFrame).
+    std::thread m_frame_thread;
+    
+    std::mutex m_frame_mutex;
+    
+    // signaled when a frame is requested and when it is finished.
+    std::condition_variable m_frame_cv;
+    
+    // frame waiting for or under evaluation on the frame thread.
+    bool m_frame_requested;
+    
+    bool m_frame_thread_quit;
+    
+    // parameters of the requested frame.
+    float m_frame_delta_ms;
+    AnimPaletteBuffer* m_frame_buffer;
+    
+    // palette buffer frame region written by the last pipelined frame.
+    u32 m_frame_region;
+    
+#if ANIM_STATS
+    // stage times of current frame.
+    AnimFrameStats m_frame_stats;
+    
+    // counters flushed by workers, merged on request.
+    AnimStatCounters m_worker_counters[AnimStatMaxWorkers];
+    
+    // busy time of every worker in current frame.
+    u64 m_worker_busy_ns[AnimStatMaxWorkers];
+#endif
+};
+
+//---------------------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------------------
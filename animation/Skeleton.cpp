@@ -1,64 +1,93 @@
-#include "engine/animation/Skeleton.h"
-#include "engine/renderer/DebugRenderer.h"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-    
-Skeleton::Skeleton()
-: m_name(0)
-, m_joint_count(0)
-, m_joints(nullptr)
-{
-    
-}
-    
-//---------------------------------------------------------------------------------------
-    
-void Skeleton::FixPointers()
-{
-    m_joints = (SkeletonJoint*)( (u8*)this + (int)m_joints + sizeof(Skeleton) );
-}
-
-//---------------------------------------------------------------------------------------
-
-void Skeleton::BreakPointers()
-{
-    m_joints = (SkeletonJoint*)( (u8*)m_joints - (int)this - sizeof(Skeleton) );
-}
-    
-//---------------------------------------------------------------------------------------
-
-void Skeleton::Draw( DebugRenderer& rend )
-{
-    ColorRGBA color = ColorRGBA::Green;
-    
-    for( u32 i = 0; i < m_joint_count; ++i )
-    {
-        SkeletonJoint& joint = m_joints[i];
-        
-        Matrix4x4 bind_pose = joint.GetInvBindPose();
-        bind_pose.InverseIt();
-        
-        Vec4 pos = bind_pose * Vec4(0.f, 0.f, 0.f, 1.f);
-        rend.AddAxis(bind_pose, 0.5f);
-        
-        // draw parent-child connection (if applicable).
-        if( joint.GetParentIndex() != (u32)-1 && joint.GetParentIndex() < m_joint_count )
-        {
-            SkeletonJoint& parent = m_joints[joint.GetParentIndex()];
-            
-            Matrix4x4 parent_bind_pose = parent.GetInvBindPose();
-            parent_bind_pose.InverseIt();
-            
-            Vec4 parent_pos = parent_bind_pose * Vec4(0.f, 0.f, 0.f, 1.f);
-            
-            rend.AddLine(Vec3(pos.x, pos.y, pos.z), Vec3(parent_pos.x, parent_pos.y, parent_pos.z), color);
-        }
-    }
-}
-    
-//---------------------------------------------------------------------------------------
-}; //namespace Engine
-//---------------------------------------------------------------------------------------
-
+#include "engine/animation/Skeleton.h"
+#include "engine/renderer/DebugRenderer.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+    
+Skeleton::Skeleton()
+: m_magic(Magic)
+, m_version(Version)
+, m_name(0)
+, m_joint_count(0)
+, m_joints(nullptr)
+, m_hit_shape_count(0)
+, m_hit_shapes(nullptr)
+, m_mirror_axis(MirrorAxis::X)
+, m_mirror_joints(nullptr)
+{
+    
+}
+    
+//---------------------------------------------------------------------------------------
+    
+void Skeleton::FixPointers()
+{
+    m_joints = (SkeletonJoint*)( (u8*)this + (size_t)m_joints + sizeof(Skeleton) );
+    
+    if( m_hit_shape_count > 0 )
+        m_hit_shapes = (SkeletonHitShape*)( (u8*)this + (size_t)m_hit_shapes + sizeof(Skeleton) );
+    else
+        m_hit_shapes = nullptr;
+    
+    if( m_mirror_joints )
+        m_mirror_joints = (u16*)( (u8*)this + (size_t)m_mirror_joints + sizeof(Skeleton) );
+}
+
+//---------------------------------------------------------------------------------------
+
+void Skeleton::BreakPointers()
+{
+    m_joints = (SkeletonJoint*)( (u8*)m_joints - (size_t)this - sizeof(Skeleton) );
+    
+    if( m_hit_shape_count > 0 )
+        m_hit_shapes = (SkeletonHitShape*)( (u8*)m_hit_shapes - (size_t)this - sizeof(Skeleton) );
+    
+    if( m_mirror_joints )
+        m_mirror_joints = (u16*)( (u8*)m_mirror_joints - (size_t)this - sizeof(Skeleton) );
+}
+    
+//---------------------------------------------------------------------------------------
+
+size_t Skeleton::GetMemoryUsage() const
+{
+    size_t mirror_size = m_mirror_joints ? m_joint_count * sizeof(u16) : 0;
+    
+    return sizeof(Skeleton) + m_joint_count * sizeof(SkeletonJoint) + m_hit_shape_count * sizeof(SkeletonHitShape) + mirror_size;
+}
+
+//---------------------------------------------------------------------------------------
+
+void Skeleton::Draw( DebugRenderer& rend )
+{
+    ColorRGBA color = ColorRGBA::Green;
+    
+    for( u32 i = 0; i < m_joint_count; ++i )
+    {
+        SkeletonJoint& joint = m_joints[i];
+        
+        Matrix4x4 bind_pose = joint.GetInvBindPose();
+        bind_pose.InverseIt();
+        
+        Vec4 pos = bind_pose * Vec4(0.f, 0.f, 0.f, 1.f);
+        rend.AddAxis(bind_pose, 0.5f);
+        
+        // draw parent-child connection (if applicable).
+        if( joint.GetParentIndex() != (u32)-1 && joint.GetParentIndex() < m_joint_count )
+        {
+            SkeletonJoint& parent = m_joints[joint.GetParentIndex()];
+            
+            Matrix4x4 parent_bind_pose = parent.GetInvBindPose();
+            parent_bind_pose.InverseIt();
+            
+            Vec4 parent_pos = parent_bind_pose * Vec4(0.f, 0.f, 0.f, 1.f);
+            
+            rend.AddLine(Vec3(pos.x, pos.y, pos.z), Vec3(parent_pos.x, parent_pos.y, parent_pos.z), color);
+        }
+    }
+}
+    
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
+
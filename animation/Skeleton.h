@@ -1,98 +1,211 @@
-#pragma once
-
-#include "engine/core/StringId.h"
-#include "engine/math/Matrix4x4.h"
-
-//---------------------------------------------------------------------------------------
-namespace Engine{
-//---------------------------------------------------------------------------------------
-
-class DebugRenderer;
-    
-class SkeletonJoint
-{
-public:
-    SkeletonJoint();
-    SkeletonJoint(StringId name, u8 parentIndex, const Matrix4x4& invBindPose);
-    
-    inline const Matrix4x4& GetInvBindPose() const { return m_inv_bind_pose; }
-    
-    inline StringId GetName() const { return m_name; }
-    
-    inline u32 GetParentIndex() const { return m_parent_index; }
-    
-private:
-    // joints name.
-    StringId m_name;
-    
-    // index of parent joint in skeleton joints array in Skeleton class.
-    u32 m_parent_index;
-    
-    // used to produce skinning matrix which is K = Joints Inverse Bind Pose (Model Space) * Joints Current Pose (Model Space)
-    Matrix4x4 m_inv_bind_pose;
-};
-    
-//---------------------------------------------------------------------------------------
-    
-class Skeleton
-{
-public:
-	Skeleton();
-
-	void BreakPointers();
-	void FixPointers();
-    
-	inline StringId GetName() const;
-    
-	inline u32 GetJointCount() const;
-    
-	inline const SkeletonJoint& GetJoint(u32 idx) const;
-    
-	inline const Matrix4x4& GetInvBindPose(u32 idx) const;
-    
-    void Draw( DebugRenderer& rend );
-    
-private:
-    // skeleton name.
-	StringId m_name;
-    
-    // number of joints in skeleton.
-	u32 m_joint_count;
-    
-    // skeleton joint array.
-	SkeletonJoint* m_joints;
-};
-
-//---------------------------------------------------------------------------------------
-
-inline StringId Skeleton::GetName() const
-{
-    return m_name;
-}
-
-//---------------------------------------------------------------------------------------
-
-inline u32 Skeleton::GetJointCount() const
-{
-    return m_joint_count;
-}
-
-//---------------------------------------------------------------------------------------
-
-inline const SkeletonJoint& Skeleton::GetJoint(u32 idx) const
-{
-    ENGINE_ASSERT(idx < m_joint_count, "index out of bounds");
-    return m_joints[idx];
-}
-
-//---------------------------------------------------------------------------------------
-
-inline const Matrix4x4& Skeleton::GetInvBindPose(u32 idx) const
-{
-    ENGINE_ASSERT(idx < m_joint_count, "index out of bounds");
-    return m_joints[idx].GetInvBindPose();
-}
-    
-//---------------------------------------------------------------------------------------
-} // namespace Engine
+#pragma once
+
+#include "engine/core/StringId.h"
+#include "engine/math/Matrix4x4.h"
+#include "engine/math/Vec3.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+class DebugRenderer;
+    
+class SkeletonJoint
+{
+public:
+    SkeletonJoint();
+    SkeletonJoint(StringId name, u8 parentIndex, const Matrix4x4& invBindPose);
+    
+    inline const Matrix4x4& GetInvBindPose() const { return m_inv_bind_pose; }
+    
+    inline StringId GetName() const { return m_name; }
+    
+    inline u32 GetParentIndex() const { return m_parent_index; }
+    
+    friend class AnimSkeletonCooker;
+private:
+    // joints name.
+    StringId m_name;
+    
+    // index of parent joint in skeleton joints array in Skeleton class.
+    u32 m_parent_index;
+    
+    // used to produce skinning matrix which is K = Joints Inverse Bind Pose (Model Space) * Joints Current Pose (Model Space)
+    Matrix4x4 m_inv_bind_pose;
+};
+    
+//---------------------------------------------------------------------------------------
+
+// enumerates hit shape types attached to skeleton joints.
+namespace HitShapeType{
+    enum Enum{
+        Capsule,
+        Box
+    };
+}
+    
+// hit shape defined in joint space. used to generate per-joint hit volumes from animated pose.
+struct SkeletonHitShape
+{
+    // type of shape.
+    HitShapeType::Enum type;
+    
+    // joint the shape is attached to.
+    u32 joint_index;
+    
+    // capsule segment start point or box center.
+    Vec3 point_a;
+    
+    // capsule segment end point.
+    Vec3 point_b;
+    
+    // capsule radius.
+    float radius;
+    
+    // box half extents along joint space axes.
+    Vec3 half_extents;
+};
+    
+//---------------------------------------------------------------------------------------
+
+// enumerates model space axes perpendicular to skeleton mirror plane.
+namespace MirrorAxis{
+    enum Enum{
+        X,
+        Y,
+        Z
+    };
+}
+    
+//---------------------------------------------------------------------------------------
+    
+class Skeleton
+{
+public:
+    // 'ANSK'
+    static const u32 Magic = 0x4b534e41;
+    
+    // bumped whenever header or array layout changes, blobs of other versions have to be re-cooked.
+    static const u32 Version = 1;
+    
+public:
+	Skeleton();
+
+	void BreakPointers();
+	void FixPointers();
+    
+    // true if blob was written with current header layout (checked before FixPointers).
+    inline bool IsCurrentVersion() const { return m_magic == Magic && m_version == Version; }
+    
+	inline StringId GetName() const;
+    
+	inline u32 GetJointCount() const;
+    
+	inline const SkeletonJoint& GetJoint(u32 idx) const;
+    
+	inline const Matrix4x4& GetInvBindPose(u32 idx) const;
+    
+    inline u32 GetHitShapeCount() const;
+    
+    inline const SkeletonHitShape& GetHitShape(u32 idx) const;
+    
+    // true if skeleton stores mirror table (mirrored animations can be played).
+    inline bool HasMirrorTable() const { return m_mirror_joints != nullptr; }
+    
+    // left/right counterpart of the joint (joint itself for joints on the mirror plane).
+    inline u32 GetMirrorJoint(u32 idx) const;
+    
+    // mirror plane normal. counterpart joint frames are expected to be reflections of each other.
+    inline MirrorAxis::Enum GetMirrorAxis() const { return m_mirror_axis; }
+    
+    void Draw( DebugRenderer& rend );
+    
+    // bytes of skeleton block (header, joints, hit shapes and mirror table).
+    size_t GetMemoryUsage() const;
+    
+    friend class AnimSkeletonCooker;
+private:
+    // Skeleton::Magic.
+    u32 m_magic;
+    
+    // Skeleton::Version the blob was written with.
+    u32 m_version;
+    
+    // skeleton name.
+	StringId m_name;
+    
+    // number of joints in skeleton.
+	u32 m_joint_count;
+    
+    // skeleton joint array.
+	SkeletonJoint* m_joints;
+    
+    // number of joint hit shapes.
+    u32 m_hit_shape_count;
+    
+    // joint hit shape array (null if there are no hit shapes).
+    SkeletonHitShape* m_hit_shapes;
+    
+    // mirror plane of the skeleton. valid if there is mirror table.
+    MirrorAxis::Enum m_mirror_axis;
+    
+    // joint count sized counterpart array (null if skeleton is not mirrorable).
+    u16* m_mirror_joints;
+};
+
+//---------------------------------------------------------------------------------------
+
+inline StringId Skeleton::GetName() const
+{
+    return m_name;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline u32 Skeleton::GetJointCount() const
+{
+    return m_joint_count;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline const SkeletonJoint& Skeleton::GetJoint(u32 idx) const
+{
+    ENGINE_ASSERT(idx < m_joint_count, "index out of bounds");
+    return m_joints[idx];
+}
+
+//---------------------------------------------------------------------------------------
+
+inline const Matrix4x4& Skeleton::GetInvBindPose(u32 idx) const
+{
+    ENGINE_ASSERT(idx < m_joint_count, "index out of bounds");
+    return m_joints[idx].GetInvBindPose();
+}
+
+//---------------------------------------------------------------------------------------
+
+inline u32 Skeleton::GetHitShapeCount() const
+{
+    return m_hit_shape_count;
+}
+
+//---------------------------------------------------------------------------------------
+
+inline const SkeletonHitShape& Skeleton::GetHitShape(u32 idx) const
+{
+    ENGINE_ASSERT(idx < m_hit_shape_count, "index out of bounds");
+    return m_hit_shapes[idx];
+}
+
+//---------------------------------------------------------------------------------------
+
+inline u32 Skeleton::GetMirrorJoint(u32 idx) const
+{
+    ENGINE_ASSERT(idx < m_joint_count, "index out of bounds");
+    return m_mirror_joints ? m_mirror_joints[idx] : idx;
+}
+    
+//---------------------------------------------------------------------------------------
+} // namespace Engine
 //---------------------------------------------------------------------------------------
\ No newline at end of file
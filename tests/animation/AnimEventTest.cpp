@@ -0,0 +1,134 @@
+#include "AnimTest.h"
+#include "engine/animation/Animation.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// one second looped clip (10 frames at 10 fps) with events at 100, 300, 500, 700 and 900 ms.
+static AnimationClip* CreateEventClip()
+{
+    AnimationClip* clip = CreateTestClip( 1, 10, 10.f, 0.f, 5 );
+    
+    for( u32 i = 0; i < 5; ++i )
+    {
+        clip->m_events[i].time_ms = 100.f + 200.f * (float)i;
+        clip->m_events[i].name = COMPUTE_SID("event") + i;
+    }
+    
+    return clip;
+}
+
+//---------------------------------------------------------------------------------------
+
+// true if events collected between two global times are exactly the expected ones, in order.
+static bool CollectsEvents( Animation& animation, float prev_global_time_ms, float global_time_ms, const float* expected_ms, u32 expected_count )
+{
+    AnimEventBuffer events;
+    animation.CollectEvents( prev_global_time_ms, global_time_ms, 1.f, 0, events );
+    
+    bool match = events.GetCount() == expected_count;
+    
+    for( u32 i = 0; match && i < expected_count; ++i )
+        match = fabsf( events.Get(i).time_ms - expected_ms[i] ) < 0.01f;
+    
+    if( !match )
+    {
+        printf( "    events (%.1f, %.1f]:", prev_global_time_ms, global_time_ms );
+        
+        for( u32 i = 0; i < events.GetCount(); ++i )
+            printf( " %.1f", events.Get(i).time_ms );
+        
+        printf( "\n" );
+    }
+    
+    return match;
+}
+
+//---------------------------------------------------------------------------------------
+
+ANIM_TEST( EventsReversePlayback )
+{
+    AnimationClip* clip = CreateEventClip();
+    Animation animation( clip, 0.f, true, -1.f );
+    
+    // local time runs 0 -> 750 (wrapping backwards) -> 450 -> 50.
+    const float first[] = { 900.f };
+    const float second[] = { 700.f, 500.f };
+    const float third[] = { 300.f, 100.f };
+    
+    ANIM_CHECK( CollectsEvents( animation, 0.f, 250.f, first, 1 ) );
+    ANIM_CHECK( CollectsEvents( animation, 250.f, 550.f, second, 2 ) );
+    ANIM_CHECK( CollectsEvents( animation, 550.f, 950.f, third, 2 ) );
+    
+    AnimClipCooker::Free( clip );
+}
+
+//---------------------------------------------------------------------------------------
+
+ANIM_TEST( EventsDirectionFlip )
+{
+    AnimationClip* clip = CreateEventClip();
+    Animation animation( clip, 0.f, true, 1.f );
+    
+    const float forward[] = { 100.f, 300.f };
+    ANIM_CHECK( CollectsEvents( animation, 0.f, 300.f, forward, 2 ) );
+    
+    // reverse at local time 300, event at the turning point has been fired already.
+    animation.SetPlaybackRate( -1.f );
+    animation.RewindStartTime( -600.f );
+    ANIM_CHECK( animation.GetLocalAnimationTime( 300.f ) == 300.f );
+    
+    ANIM_CHECK( CollectsEvents( animation, 300.f, 400.f, nullptr, 0 ) );
+    
+    const float backward[] = { 100.f };
+    ANIM_CHECK( CollectsEvents( animation, 400.f, 600.f, backward, 1 ) );
+    
+    // and forward again at local time 0 (start time stays), passing the same event again.
+    animation.SetPlaybackRate( 1.f );
+    ANIM_CHECK( animation.GetLocalAnimationTime( 600.f ) == 0.f );
+    
+    const float forward_again[] = { 100.f };
+    ANIM_CHECK( CollectsEvents( animation, 600.f, 750.f, forward_again, 1 ) );
+    
+    AnimClipCooker::Free( clip );
+}
+
+//---------------------------------------------------------------------------------------
+
+ANIM_TEST( EventsWrapLongerThanClip )
+{
+    AnimationClip* clip = CreateEventClip();
+    
+    // 1.5 cycles in one update fire every event once, starting after the previous time.
+    Animation animation( clip, 0.f, true, 1.f );
+    
+    const float first[] = { 100.f };
+    const float cycle[] = { 300.f, 500.f, 700.f, 900.f, 100.f };
+    const float after[] = { 900.f };
+    
+    ANIM_CHECK( CollectsEvents( animation, 0.f, 200.f, first, 1 ) );
+    ANIM_CHECK( CollectsEvents( animation, 200.f, 1700.f, cycle, 5 ) );
+    
+    // cursor continues from the end of the long update.
+    ANIM_CHECK( CollectsEvents( animation, 1700.f, 1800.f, nullptr, 0 ) );
+    ANIM_CHECK( CollectsEvents( animation, 1800.f, 2000.f, after, 1 ) );
+    
+    // same backwards.
+    Animation reverse( clip, 0.f, true, -1.f );
+    
+    const float reverse_first[] = { 900.f };
+    const float reverse_cycle[] = { 700.f, 500.f, 300.f, 100.f, 900.f };
+    const float reverse_after[] = { 100.f };
+    
+    ANIM_CHECK( CollectsEvents( reverse, 0.f, 200.f, reverse_first, 1 ) );
+    ANIM_CHECK( CollectsEvents( reverse, 200.f, 1700.f, reverse_cycle, 5 ) );
+    ANIM_CHECK( CollectsEvents( reverse, 1700.f, 1800.f, nullptr, 0 ) );
+    ANIM_CHECK( CollectsEvents( reverse, 1800.f, 2000.f, reverse_after, 1 ) );
+    
+    AnimClipCooker::Free( clip );
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "AnimTest.h"
+#include "engine/animation/AnimationSystem.h"
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// controller creation is refused once running totals exceed the budget.
+ANIM_TEST( MemoryBudgetRefusesController )
+{
+    Skeleton* skeleton = CreateTestSkeleton( 8 );
+    AnimationSystem system( 8 );
+    
+    Handle first = system.CreateController( skeleton, 1 );
+    
+    AnimMemoryReport report;
+    system.GetMemoryReport( report );
+    
+    // skeleton is counted from the first controller on.
+    ANIM_CHECK( report.category_bytes[AnimMemoryCategory::Skeletons] == skeleton->GetMemoryUsage() );
+    
+    u32 callback_count = 0;
+    size_t callback_total = 0;
+    
+    // room for the first controller only.
+    system.SetMemoryBudget( report.total, [&]( const AnimMemoryReport& r ){ ++callback_count; callback_total = r.total; } );
+    
+    ANIM_CHECK( system.CreateController( skeleton, 1 ) == (Handle)-1 );
+    ANIM_CHECK( callback_count == 1 );
+    ANIM_CHECK( callback_total > report.total );
+    
+    // refused controller is not counted.
+    AnimMemoryReport after;
+    system.GetMemoryReport( after );
+    ANIM_CHECK( after.total == report.total );
+    ANIM_CHECK( after.controllers.size() == 1 );
+    
+    // destroying the first controller releases its memory and the skeleton.
+    system.DestroyController( first );
+    
+    Handle second = system.CreateController( skeleton, 1 );
+    ANIM_CHECK( second != (Handle)-1 );
+    ANIM_CHECK( callback_count == 1 );
+    
+    system.DestroyController( second );
+    AnimSkeletonCooker::Free( skeleton );
+}
+
+//---------------------------------------------------------------------------------------
+
+// growth of a live controller is reported once at the next update, and counted by later creations.
+ANIM_TEST( MemoryBudgetReportsGrowth )
+{
+    Skeleton* skeleton = CreateTestSkeleton( 8 );
+    AnimationClip* clip = CreateTestClip( 8, 30, 30.f, 0.1f, 0 );
+    AnimationSystem system( 8 );
+    
+    Handle h = system.CreateController( skeleton, 2 );
+    
+    AnimMemoryReport report;
+    system.GetMemoryReport( report );
+    
+    u32 callback_count = 0;
+    system.SetMemoryBudget( report.total, [&]( const AnimMemoryReport& ){ ++callback_count; } );
+    
+    // layer trees are allocated on first play.
+    system.GetController( h ).GetLayer(0).PlayClip( clip, 0.f, 0.f, true );
+    ANIM_CHECK( callback_count == 0 );
+    
+    system.Update( 16.f );
+    ANIM_CHECK( callback_count == 1 );
+    
+    // not reported again while the total stays over budget.
+    system.Update( 16.f );
+    ANIM_CHECK( callback_count == 1 );
+    
+    AnimMemoryReport grown;
+    system.GetMemoryReport( grown );
+    ANIM_CHECK( grown.total > report.total );
+    ANIM_CHECK( grown.high_water == grown.total );
+    
+    // budget with room for the grown controller only.
+    system.SetMemoryBudget( grown.total, [&]( const AnimMemoryReport& ){ ++callback_count; } );
+    ANIM_CHECK( system.CreateController( skeleton, 2 ) == (Handle)-1 );
+    
+    system.DestroyController( h );
+    AnimClipCooker::Free( clip );
+    AnimSkeletonCooker::Free( skeleton );
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "AnimTest.h"
+#include "engine/animation/AnimReplication.h"
+#include "engine/animation/AnimationSystem.h"
+#include <vector>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// local poses of all controller joints at the current layer clocks.
+static void GetPoses( AnimController& controller, std::vector<AnimationClip::JointPose>& poses )
+{
+    controller.UpdateWeights( 0.f );
+    poses.resize( controller.GetSkeleton()->GetJointCount() );
+    
+    for( u32 j = 0; j < poses.size(); ++j )
+        controller.GetJointPose( (u16)j, poses[j] );
+}
+
+//---------------------------------------------------------------------------------------
+
+// true if poses match within quantization of times and fp16 factors.
+static bool PosesMatch( const std::vector<AnimationClip::JointPose>& a, const std::vector<AnimationClip::JointPose>& b, float tolerance )
+{
+    if( a.size() != b.size() )
+        return false;
+    
+    for( size_t j = 0; j < a.size(); ++j )
+    {
+        const Quaternion& qa = a[j].rotation;
+        const Quaternion& qb = b[j].rotation;
+        float dot = qa.x * qb.x + qa.y * qb.y + qa.z * qb.z + qa.w * qb.w;
+        
+        // q and -q are the same rotation.
+        if( fabsf( dot ) < 1.f - tolerance )
+            return false;
+        
+        if( fabsf( a[j].translation.x - b[j].translation.x ) > tolerance
+           || fabsf( a[j].translation.y - b[j].translation.y ) > tolerance
+           || fabsf( a[j].translation.z - b[j].translation.z ) > tolerance
+           || fabsf( a[j].scale - b[j].scale ) > tolerance )
+            return false;
+    }
+    
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+// full snapshot and a delta against it are written, read and applied on a client controller.
+ANIM_TEST( ReplicationRoundTrip )
+{
+    Skeleton* skeleton = CreateTestSkeleton( 4 );
+    AnimationClip* walk = CreateTestClip( 4, 30, 30.f, 0.05f, 0 );
+    AnimationClip* turn = CreateTestClip( 4, 20, 30.f, -0.08f, 0 );
+    turn->m_name = COMPUTE_SID("turn");
+    
+    AnimationSystem server_system( 1 );
+    AnimationSystem client_system( 1 );
+    AnimController& server = server_system.GetController( server_system.CreateController( skeleton, 2 ) );
+    AnimController& client = client_system.GetController( client_system.CreateController( skeleton, 2 ) );
+    
+    AnimReplication replication;
+    replication.RegisterClip( walk );
+    replication.RegisterClip( turn );
+    
+    // base layer walks, second layer blends a turn on top.
+    server.GetLayer(0).PlayClip( walk, 0.f, 0.f, true );
+    server.GetLayer(1).PlayClip( turn, 100.f, 0.f, true );
+    server.GetLayer(1).SetBlendFactor( 0.35f );
+    
+    for( u32 i = 0; i < 5; ++i )
+        server_system.Update( 16.7f );
+    
+    AnimNetSnapshot full;
+    AnimReplication::Capture( server, 1, full );
+    
+    std::vector<AnimationClip::JointPose> server_full_poses;
+    GetPoses( server, server_full_poses );
+    
+    u8 full_data[512];
+    AnimBitWriter full_writer( full_data, sizeof(full_data) );
+    AnimReplication::Write( full, nullptr, full_writer );
+    full_writer.Flush();
+    ANIM_CHECK( !full_writer.IsOverflow() );
+    
+    // base layer cross-fades to the turn.
+    server.GetLayer(0).PlayClip( turn, 0.f, 200.f, false );
+    
+    for( u32 i = 0; i < 3; ++i )
+        server_system.Update( 16.7f );
+    
+    AnimNetSnapshot delta;
+    AnimReplication::Capture( server, 2, delta );
+    ANIM_CHECK( server.GetLayer(0).IsCrossfading() );
+    
+    std::vector<AnimationClip::JointPose> server_delta_poses;
+    GetPoses( server, server_delta_poses );
+    
+    u8 delta_data[512];
+    AnimBitWriter delta_writer( delta_data, sizeof(delta_data) );
+    AnimReplication::Write( delta, &full, delta_writer );
+    delta_writer.Flush();
+    ANIM_CHECK( !delta_writer.IsOverflow() );
+    
+    // client decodes full snapshot without baseline.
+    u16 baseline_sequence = 0;
+    ANIM_CHECK( !AnimReplication::PeekBaseline( full_data, full_writer.GetByteCount(), baseline_sequence ) );
+    
+    AnimNetSnapshot client_full;
+    AnimBitReader full_reader( full_data, full_writer.GetByteCount() );
+    ANIM_CHECK( AnimReplication::Read( full_reader, nullptr, client_full ) );
+    ANIM_CHECK( client_full.sequence == 1 );
+    ANIM_CHECK( replication.Apply( client_full, client ) );
+    
+    std::vector<AnimationClip::JointPose> client_poses;
+    GetPoses( client, client_poses );
+    ANIM_CHECK( PosesMatch( server_full_poses, client_poses, 5e-3f ) );
+    
+    // and the delta against the decoded full snapshot.
+    ANIM_CHECK( AnimReplication::PeekBaseline( delta_data, delta_writer.GetByteCount(), baseline_sequence ) );
+    ANIM_CHECK( baseline_sequence == 1 );
+    
+    AnimNetSnapshot client_delta;
+    AnimBitReader delta_reader( delta_data, delta_writer.GetByteCount() );
+    ANIM_CHECK( AnimReplication::Read( delta_reader, &client_full, client_delta ) );
+    ANIM_CHECK( client_delta.sequence == 2 );
+    ANIM_CHECK( replication.Apply( client_delta, client ) );
+    ANIM_CHECK( client.GetLayer(0).IsCrossfading() );
+    
+    GetPoses( client, client_poses );
+    ANIM_CHECK( PosesMatch( server_delta_poses, client_poses, 5e-3f ) );
+    
+    // pose changed between the snapshots, so the match above comes from the delta.
+    ANIM_CHECK( !PosesMatch( server_full_poses, server_delta_poses, 5e-3f ) );
+    
+    AnimClipCooker::Free( turn );
+    AnimClipCooker::Free( walk );
+    AnimSkeletonCooker::Free( skeleton );
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "AnimTest.h"
+#include "engine/animation/AnimSkinning.h"
+#include <vector>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// simd kernels (avx2 blocks of 8 vertices, sse remainder) match the portable kernel, including
+// vertices whose blended matrix collapses the normal.
+ANIM_TEST( SkinningSimdMatchesScalar )
+{
+    const u32 joint_count = 5;
+    const u32 vertex_count = 37;
+    
+    // rotations around z with translation. last joint is degenerate (collapses normals below the
+    // renormalization threshold).
+    Matrix4x4 palette[joint_count];
+    
+    for( u32 j = 0; j < joint_count; ++j )
+    {
+        float* m = palette[j].matrix;
+        
+        for( u32 e = 0; e < 16; ++e )
+            m[e] = 0.f;
+        
+        if( j == joint_count - 1 )
+        {
+            m[0] = m[5] = m[10] = 1e-14f;
+            m[15] = 1.f;
+            continue;
+        }
+        
+        float angle = 0.7f * (float)j;
+        m[0] = cosf( angle ); m[1] = -sinf( angle ); m[3] = (float)j;
+        m[4] = sinf( angle ); m[5] = cosf( angle ); m[7] = 0.5f * (float)j;
+        m[10] = 1.f; m[11] = -(float)j;
+        m[15] = 1.f;
+    }
+    
+    std::vector<float> in_streams[6];
+    std::vector<u16> joints[4];
+    std::vector<float> weights[4];
+    
+    for( u32 v = 0; v < vertex_count; ++v )
+    {
+        float t = (float)v;
+        
+        in_streams[0].push_back( sinf( t ) );
+        in_streams[1].push_back( cosf( 1.3f * t ) );
+        in_streams[2].push_back( 0.1f * t );
+        
+        float nx = sinf( 0.5f * t ), ny = cosf( 0.5f * t ), nz = 0.3f;
+        float len = sqrtf( nx * nx + ny * ny + nz * nz );
+        in_streams[3].push_back( nx / len );
+        in_streams[4].push_back( ny / len );
+        in_streams[5].push_back( nz / len );
+        
+        // every 9th vertex is fully bound to the degenerate joint.
+        bool degenerate = v % 9 == 4;
+        float total = 0.f;
+        
+        for( u32 k = 0; k < 4; ++k )
+        {
+            joints[k].push_back( degenerate ? (u16)(joint_count - 1) : (u16)((v + k) % (joint_count - 1)) );
+            weights[k].push_back( 1.f + (float)((v * 7 + k * 3) % 5) );
+            total += weights[k].back();
+        }
+        
+        for( u32 k = 0; k < 4; ++k )
+            weights[k].back() /= total;
+    }
+    
+    SkinningInput input;
+    
+    for( u32 i = 0; i < 3; ++i )
+    {
+        input.position[i] = in_streams[i].data();
+        input.normal[i] = in_streams[3 + i].data();
+    }
+    
+    for( u32 k = 0; k < 4; ++k )
+    {
+        input.joints[k] = joints[k].data();
+        input.weights[k] = weights[k].data();
+    }
+    
+    input.influence_count = 4;
+    input.vertex_count = vertex_count;
+    
+    std::vector<float> simd_streams[6];
+    std::vector<float> scalar_streams[6];
+    SkinningOutput simd_output;
+    SkinningOutput scalar_output;
+    
+    for( u32 i = 0; i < 6; ++i )
+    {
+        simd_streams[i].resize( vertex_count, -1.f );
+        scalar_streams[i].resize( vertex_count, -1.f );
+    }
+    
+    for( u32 i = 0; i < 3; ++i )
+    {
+        simd_output.position[i] = simd_streams[i].data();
+        simd_output.normal[i] = simd_streams[3 + i].data();
+        scalar_output.position[i] = scalar_streams[i].data();
+        scalar_output.normal[i] = scalar_streams[3 + i].data();
+    }
+    
+    AnimSkinning::SkinVertices( palette, input, simd_output, 0, vertex_count );
+    AnimSkinning::SkinVerticesScalar( palette, input, scalar_output, 0, vertex_count );
+    
+    for( u32 i = 0; i < 6; ++i )
+    {
+        for( u32 v = 0; v < vertex_count; ++v )
+            ANIM_CHECK_NEAR( simd_streams[i][v], scalar_streams[i][v], 1e-5f );
+    }
+    
+    // degenerate vertices get zero normals from every kernel.
+    for( u32 v = 4; v < vertex_count; v += 9 )
+    {
+        for( u32 i = 3; i < 6; ++i )
+            ANIM_CHECK( simd_streams[i][v] == 0.f );
+    }
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "engine/core/Types.h"
+#include "engine/core/StringId.h"
+#include "engine/animation/AnimSkeletonCooker.h"
+#include "engine/animation/AnimClipCooker.h"
+#include <stdio.h>
+#include <math.h>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+// registered test. tests register themselves with ANIM_TEST and are run by tests/animation/main.cpp.
+struct AnimTest
+{
+    typedef void (*Func)( bool& passed );
+    
+    AnimTest( const char* name, Func func );
+    
+    const char* name;
+    Func func;
+    
+    // next registered test (registration order is not defined across files).
+    AnimTest* next;
+    
+    static AnimTest* s_first;
+};
+
+//---------------------------------------------------------------------------------------
+
+#define ANIM_TEST( test_name ) \
+    static void test_name( bool& anim_test_passed ); \
+    static Engine::AnimTest s_anim_test_##test_name( #test_name, test_name ); \
+    static void test_name( bool& anim_test_passed )
+
+// failed checks are reported and mark the test as failed, the test keeps running.
+#define ANIM_CHECK( condition ) \
+    do{ if( !(condition) ){ printf( "%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition ); anim_test_passed = false; } }while(0)
+
+#define ANIM_CHECK_NEAR( a, b, epsilon ) \
+    do{ float anim_a = (float)(a), anim_b = (float)(b); \
+        if( !(fabsf( anim_a - anim_b ) <= (epsilon)) ){ printf( "%s(%d): check failed: %s == %s (%f != %f)\n", __FILE__, __LINE__, #a, #b, anim_a, anim_b ); anim_test_passed = false; } }while(0)
+
+//---------------------------------------------------------------------------------------
+
+// joint chain, every joint one unit above its parent. released with AnimSkeletonCooker::Free.
+inline Skeleton* CreateTestSkeleton( u32 joint_count )
+{
+    Skeleton* skeleton = AnimSkeletonCooker::Allocate( COMPUTE_SID("test_skeleton"), joint_count, 0, false );
+    
+    for( u32 i = 0; i < joint_count; ++i )
+    {
+        // row-major, translation in the last column.
+        Matrix4x4 inv_bind_pose;
+        
+        for( u32 e = 0; e < 16; ++e )
+            inv_bind_pose.matrix[e] = (e % 5 == 0) ? 1.f : 0.f;
+        
+        inv_bind_pose.matrix[7] = -(float)i;
+        
+        AnimSkeletonCooker::SetJoint( *skeleton, i, COMPUTE_SID("joint") + i, i == 0 ? (u32)-1 : i - 1, inv_bind_pose );
+    }
+    
+    return skeleton;
+}
+
+//---------------------------------------------------------------------------------------
+
+// dense clip animating all joints. joints rotate around y by angle_step per frame and move along x.
+// released with AnimClipCooker::Free.
+inline AnimationClip* CreateTestClip( u32 joint_count, u32 frame_count, float frames_per_second, float angle_step, u32 event_count )
+{
+    AnimationClip* clip = AnimClipCooker::Allocate( (s16)joint_count, (s16)joint_count, frame_count, event_count, 0 );
+    
+    clip->m_name = COMPUTE_SID("test_clip");
+    clip->m_frames_per_ms = frames_per_second * 0.001f;
+    
+    for( u32 j = 0; j < joint_count; ++j )
+        clip->m_joint_remap[j] = (s16)j;
+    
+    for( u32 f = 0; f < frame_count; ++f )
+    {
+        for( u32 j = 0; j < joint_count; ++j )
+        {
+            AnimationClip::JointPose& pose = clip->m_joint_poses[f * joint_count + j];
+            float half_angle = 0.5f * angle_step * (float)f * (float)(j + 1);
+            
+            pose.rotation.x = 0.f;
+            pose.rotation.y = sinf( half_angle );
+            pose.rotation.z = 0.f;
+            pose.rotation.w = cosf( half_angle );
+            pose.translation.x = 0.1f * (float)f;
+            pose.translation.y = j == 0 ? 0.f : 1.f;
+            pose.translation.z = 0.f;
+            pose.scale = 1.f;
+        }
+    }
+    
+    return clip;
+}
+
+//---------------------------------------------------------------------------------------
+} // namespace Engine
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "AnimTest.h"
+#include <string.h>
+
+//---------------------------------------------------------------------------------------
+namespace Engine{
+//---------------------------------------------------------------------------------------
+
+AnimTest* AnimTest::s_first = nullptr;
+
+//---------------------------------------------------------------------------------------
+
+AnimTest::AnimTest( const char* test_name, Func test_func )
+: name(test_name)
+, func(test_func)
+, next(s_first)
+{
+    s_first = this;
+}
+
+//---------------------------------------------------------------------------------------
+}; //namespace Engine
+//---------------------------------------------------------------------------------------
+
+// AnimationTests [test name]
+//   runs all registered tests (or the single named one). returns number of failed tests.
+int main( int argc, char** argv )
+{
+    int failed = 0;
+    int run = 0;
+    
+    for( Engine::AnimTest* test = Engine::AnimTest::s_first; test; test = test->next )
+    {
+        if( argc > 1 && strcmp( argv[1], test->name ) != 0 )
+            continue;
+        
+        bool passed = true;
+        test->func( passed );
+        
+        printf( "%s %s\n", passed ? "[ OK ]  " : "[FAIL]  ", test->name );
+        
+        failed += passed ? 0 : 1;
+        ++run;
+    }
+    
+    printf( "%d of %d tests failed\n", failed, run );
+    
+    return failed;
+}
\ No newline at end of file
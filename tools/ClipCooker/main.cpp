@@ -0,0 +1,207 @@
+#include "engine/animation/AnimClipCooker.h"
+#include "engine/animation/AnimWorkerPool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <dirent.h>
+#endif
+
+//---------------------------------------------------------------------------------------
+
+// M_PI is not available on every compiler without extra defines.
+static const float DegreesToRadians = 3.14159265358979f / 180.f;
+
+//---------------------------------------------------------------------------------------
+
+// ClipCooker <input dir> <output dir> [options]
+//   -fps <n>          resample to n frames per second.
+//   -loop             clips are played looped (resampling keeps looped duration).
+//   -additive <clip>  bake additive clips against reference clip.
+//   -frame <n>        use single reference frame instead of whole reference clip.
+//   -curves <t> <r>   fit hermite curves with max translation error t and rotation error r (degrees).
+//   -threads <n>      worker count (default: hardware concurrency).
+//   -ext <ext>        clip file extension (default: .clip).
+static void PrintUsage()
+{
+    printf( "usage: ClipCooker <input dir> <output dir> [-fps n] [-loop] [-additive reference_clip] [-frame n] [-curves translation_error rotation_error] [-threads n] [-ext .clip]\n" );
+}
+
+//---------------------------------------------------------------------------------------
+
+static bool HasExtension( const char* name, const char* ext )
+{
+    size_t name_length = strlen( name );
+    size_t ext_length = strlen( ext );
+    
+    return name_length > ext_length && !strcmp( name + name_length - ext_length, ext );
+}
+
+//---------------------------------------------------------------------------------------
+
+// names of directory entries (without path). returns false if directory can't be opened.
+static bool ListFiles( const char* dir_path, std::vector<std::string>& names )
+{
+#if defined(_WIN32)
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA( (std::string(dir_path) + "/*").c_str(), &data );
+    
+    if( find == INVALID_HANDLE_VALUE )
+        return false;
+    
+    do
+    {
+        names.push_back( data.cFileName );
+    }
+    while( FindNextFileA( find, &data ) );
+    
+    FindClose( find );
+#else
+    DIR* dir = opendir( dir_path );
+    
+    if( !dir )
+        return false;
+    
+    while( dirent* entry = readdir( dir ) )
+        names.push_back( entry->d_name );
+    
+    closedir( dir );
+#endif
+    
+    return true;
+}
+
+//---------------------------------------------------------------------------------------
+
+int main( int argc, char** argv )
+{
+    using namespace Engine;
+    
+    if( argc < 3 )
+    {
+        PrintUsage();
+        return 1;
+    }
+    
+    const char* input_dir = argv[1];
+    const char* output_dir = argv[2];
+    const char* reference_path = nullptr;
+    const char* extension = ".clip";
+    
+    ClipCookSettings settings;
+    u32 worker_count = std::thread::hardware_concurrency();
+    
+    for( int i = 3; i < argc; ++i )
+    {
+        bool has_value = i + 1 < argc;
+        
+        if( !strcmp(argv[i], "-fps") && has_value )
+            settings.frames_per_second = (float)atof( argv[++i] );
+        else if( !strcmp(argv[i], "-loop") )
+            settings.looped = true;
+        else if( !strcmp(argv[i], "-additive") && has_value )
+            reference_path = argv[++i];
+        else if( !strcmp(argv[i], "-frame") && has_value )
+            settings.reference_frame = atoi( argv[++i] );
+        else if( !strcmp(argv[i], "-curves") && i + 2 < argc )
+        {
+            settings.curve_translation_error = (float)atof( argv[++i] );
+            settings.curve_rotation_error = (float)atof( argv[++i] ) * DegreesToRadians;
+        }
+        else if( !strcmp(argv[i], "-threads") && has_value )
+            worker_count = (u32)atoi( argv[++i] );
+        else if( !strcmp(argv[i], "-ext") && has_value )
+            extension = argv[++i];
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    
+    // reference clip is shared by all jobs (read only).
+    AnimationClip* reference = nullptr;
+    
+    if( reference_path )
+    {
+        reference = AnimClipCooker::Load( reference_path );
+        
+        if( !reference )
+        {
+            printf( "failed to load reference clip %s\n", reference_path );
+            return 1;
+        }
+        
+        // additive baking needs dense reference frames.
+        if( reference->HasCurves() )
+        {
+            AnimationClip* decoded = AnimClipCooker::Decode( *reference );
+            AnimClipCooker::Free( reference );
+            reference = decoded;
+        }
+        
+        settings.reference = reference;
+    }
+    
+    // gather clips.
+    std::vector<std::string> sources;
+    std::vector<std::string> outputs;
+    
+    std::vector<std::string> names;
+    
+    if( !ListFiles( input_dir, names ) )
+    {
+        printf( "failed to open %s\n", input_dir );
+        AnimClipCooker::Free( reference );
+        return 1;
+    }
+    
+    for( size_t i = 0; i < names.size(); ++i )
+    {
+        if( HasExtension( names[i].c_str(), extension ) )
+        {
+            sources.push_back( std::string(input_dir) + "/" + names[i] );
+            outputs.push_back( std::string(output_dir) + "/" + names[i] );
+        }
+    }
+    
+    std::vector<ClipCookJob> jobs( sources.size() );
+    
+    for( size_t i = 0; i < jobs.size(); ++i )
+    {
+        jobs[i].source_path = sources[i].c_str();
+        jobs[i].output_path = outputs[i].c_str();
+        jobs[i].result = ClipCookResult::Ok;
+    }
+    
+    AnimWorkerPool pool;
+    pool.Start( worker_count > 0 ? worker_count : 1 );
+    
+    if( !jobs.empty() )
+        AnimClipCooker::CookBatch( &jobs[0], (u32)jobs.size(), settings, pool );
+    
+    pool.Stop();
+    
+    u32 failed = 0;
+    
+    for( size_t i = 0; i < jobs.size(); ++i )
+    {
+        if( jobs[i].result != ClipCookResult::Ok )
+        {
+            printf( "%s: %s\n", jobs[i].source_path, AnimClipCooker::GetResultName( jobs[i].result ) );
+            failed++;
+        }
+    }
+    
+    printf( "cooked %u/%u clips\n", (u32)jobs.size() - failed, (u32)jobs.size() );
+    
+    AnimClipCooker::Free( reference );
+    return failed > 0 ? 1 : 0;
+}
\ No newline at end of file